@@ -0,0 +1,331 @@
+#!/usr/bin/env python3
+
+# Generates decoders that fill GNOME Twitch's data structs straight from
+# a GtJsonScanner, without building a JsonNode tree first.
+#
+# Usage: gen-json-decoders.py SCHEMA OUTPUT.c OUTPUT.h
+#
+# The schema is line based, '#' starts a comment:
+#
+#   include HEADER
+#       Header to include in the generated header.
+#
+#   decoder NAME STRUCT PREFIX
+#       Generates 'STRUCT* gt_json_decode_NAME(GtJsonScanner*)', which
+#       allocates with PREFIX_new() and frees with PREFIX_free(). It's
+#       followed by indented lines, one per member:
+#
+#       MEMBER TYPE FIELD
+#           Reads MEMBER into data->FIELD. MEMBER can be a path into
+#           nested objects like 'preview.large'. TYPE is one of 'id'
+#           (integer or string, kept as a string), 'string', 'int',
+#           'time' (utils_parse_time_iso_8601) or 'timeval'
+#           (g_time_val_from_iso8601).
+#
+#       MEMBER @DECODER
+#           Reads the object in MEMBER into the same struct with the
+#           members of DECODER.
+#
+#       = FIELD VALUE
+#           Sets data->FIELD to VALUE once the object is read.
+#
+#   page NAME MEMBER DECODER
+#       Generates 'GList* gt_json_decode_NAME_page(data, length, error)',
+#       which decodes the array in MEMBER of a page of results.
+
+import sys
+from collections import OrderedDict
+
+TYPES = {
+    'id': ('gchar*', 'gt_json_scanner_read_id', 'g_free'),
+    'string': ('gchar*', 'gt_json_scanner_read_string', 'g_free'),
+    'int': ('gint64', 'gt_json_scanner_read_int', None),
+    'time': ('GDateTime*', 'gt_json_scanner_read_time', 'g_date_time_unref'),
+    'timeval': ('GDateTime*', 'gt_json_scanner_read_timeval', 'g_date_time_unref'),
+}
+
+MAX_MEMBERS = 64
+
+
+class SchemaError(Exception):
+    pass
+
+
+class Member:
+    def __init__(self, path, type_, field, bit):
+        self.path = path
+        self.type = type_
+        self.field = field
+        self.bit = bit
+
+
+class Decoder:
+    def __init__(self, name, struct, prefix):
+        self.name = name
+        self.struct = struct
+        self.prefix = prefix
+        self.members = []
+        self.constants = []
+
+    def tree(self):
+        # Nested dicts keyed by member name, with Members as leaves
+        root = OrderedDict()
+        for member in self.members:
+            node = root
+            for part in member.path[:-1]:
+                node = node.setdefault(part, OrderedDict())
+                if not isinstance(node, OrderedDict):
+                    raise SchemaError('{}: {} is both a value and an object'.format(self.name, part))
+            if member.path[-1] in node:
+                raise SchemaError('{}: duplicate member {}'.format(self.name, '.'.join(member.path)))
+            node[member.path[-1]] = member
+        return root
+
+
+def parse_schema(path):
+    includes = []
+    decoders = OrderedDict()
+    pages = []
+    decoder = None
+
+    with open(path, encoding='utf-8') as f:
+        for lineno, line in enumerate(f, 1):
+            line = line.split('#', 1)[0].rstrip()
+            if not line:
+                continue
+
+            words = line.split()
+            indented = line[0].isspace()
+
+            try:
+                if indented:
+                    if decoder is None:
+                        raise SchemaError('member outside of a decoder')
+                    if words[0] == '=':
+                        if len(words) != 3:
+                            raise SchemaError('expected "= FIELD VALUE"')
+                        decoder.constants.append((words[1], words[2]))
+                        continue
+                    if len(decoder.members) >= MAX_MEMBERS:
+                        raise SchemaError('more than {} members'.format(MAX_MEMBERS))
+                    if len(words) == 2 and words[1].startswith('@'):
+                        ref = decoders.get(words[1][1:])
+                        if ref is None:
+                            raise SchemaError('unknown decoder {}'.format(words[1]))
+                        if ref.struct != decoder.struct:
+                            raise SchemaError('{} doesn\'t decode a {}'.format(words[1], decoder.struct))
+                        type_ = ref
+                        field = None
+                    elif len(words) == 3:
+                        if words[1] not in TYPES:
+                            raise SchemaError('unknown type {}'.format(words[1]))
+                        type_ = words[1]
+                        field = words[2]
+                    else:
+                        raise SchemaError('expected "MEMBER TYPE FIELD" or "MEMBER @DECODER"')
+                    decoder.members.append(Member(words[0].split('.'), type_, field,
+                                                  len(decoder.members)))
+                    continue
+
+                decoder = None
+
+                if words[0] == 'include' and len(words) == 2:
+                    includes.append(words[1])
+                elif words[0] == 'decoder' and len(words) == 4:
+                    if words[1] in decoders:
+                        raise SchemaError('duplicate decoder {}'.format(words[1]))
+                    decoder = Decoder(*words[1:])
+                    decoders[decoder.name] = decoder
+                elif words[0] == 'page' and len(words) == 4:
+                    if words[3] not in decoders:
+                        raise SchemaError('unknown decoder {}'.format(words[3]))
+                    pages.append((words[1], words[2], decoders[words[3]]))
+                else:
+                    raise SchemaError('unknown statement "{}"'.format(line.strip()))
+            except SchemaError as e:
+                raise SchemaError('{}:{}: {}'.format(path, lineno, e))
+
+    for decoder in decoders.values():
+        if not decoder.members:
+            raise SchemaError('{}: decoder {} has no members'.format(path, decoder.name))
+        decoder.tree()
+
+    return includes, decoders, pages
+
+
+def c_string(s):
+    return '"' + s.replace('\\', '\\\\').replace('"', '\\"') + '"'
+
+
+def emit_object(out, decoder, node, indent):
+    pad = ' ' * indent
+
+    out.append(pad + 'if (!gt_json_scanner_begin_object(scanner))')
+    out.append(pad + '    return FALSE;')
+    out.append('')
+    out.append(pad + 'while (gt_json_scanner_next_member(scanner))')
+    out.append(pad + '{')
+    out.append(pad + '    switch (scanner->name->len)')
+    out.append(pad + '    {')
+
+    by_length = OrderedDict()
+    for name in node:
+        by_length.setdefault(len(name.encode('utf-8')), []).append(name)
+
+    for length in sorted(by_length):
+        out.append(pad + '        case {}:'.format(length))
+        for name in by_length[length]:
+            child = node[name]
+            out.append(pad + '            if (memcmp(scanner->name->str, {}, {}) == 0)'.format(
+                c_string(name), length))
+            out.append(pad + '            {')
+            inner = indent + 16
+            ipad = ' ' * inner
+            if isinstance(child, OrderedDict):
+                emit_object(out, decoder, child, inner)
+            elif isinstance(child.type, Decoder):
+                out.append(ipad + 'if (!fill_{}(scanner, data))'.format(child.type.name))
+                out.append(ipad + '    return FALSE;')
+                out.append(ipad + 'seen |= G_GUINT64_CONSTANT(1) << {};'.format(child.bit))
+            else:
+                _, read, free = TYPES[child.type]
+                if free:
+                    out.append(ipad + 'g_clear_pointer(&data->{}, {});'.format(child.field, free))
+                out.append(ipad + 'data->{} = {}(scanner);'.format(child.field, read))
+                out.append(ipad + 'seen |= G_GUINT64_CONSTANT(1) << {};'.format(child.bit))
+            out.append(ipad + 'continue;')
+            out.append(pad + '            }')
+        out.append(pad + '            break;')
+
+    out.append(pad + '    }')
+    out.append('')
+    out.append(pad + '    gt_json_scanner_skip(scanner);')
+    out.append(pad + '}')
+    out.append('')
+    out.append(pad + 'if (gt_json_scanner_failed(scanner))')
+    out.append(pad + '    return FALSE;')
+
+
+def emit_c(includes, decoders, pages, header):
+    out = []
+    out.append('/* Generated by gen-json-decoders.py, do not edit */')
+    out.append('')
+    out.append('#include <string.h>')
+    out.append('#include "{}"'.format(header))
+    out.append('')
+    out.append('static gboolean')
+    out.append('check_members(GtJsonScanner* scanner, const gchar* what,')
+    out.append('    guint64 seen, const gchar** members, guint n_members)')
+    out.append('{')
+    out.append('    for (guint i = 0; i < n_members; i++)')
+    out.append('    {')
+    out.append('        if (!(seen & (G_GUINT64_CONSTANT(1) << i)))')
+    out.append('        {')
+    out.append('            gt_json_scanner_set_error(scanner,')
+    out.append('                "Couldn\'t parse %s from JSON because: Missing member \'%s\'",')
+    out.append('                what, members[i]);')
+    out.append('            return FALSE;')
+    out.append('        }')
+    out.append('    }')
+    out.append('')
+    out.append('    return TRUE;')
+    out.append('}')
+
+    for decoder in decoders.values():
+        out.append('')
+        out.append('static const gchar* {}_members[] ='.format(decoder.name))
+        out.append('{')
+        for member in decoder.members:
+            out.append('    {},'.format(c_string('.'.join(member.path))))
+        out.append('};')
+        out.append('')
+        out.append('static gboolean')
+        out.append('fill_{}(GtJsonScanner* scanner, {}* data)'.format(decoder.name, decoder.struct))
+        out.append('{')
+        out.append('    guint64 seen = 0;')
+        out.append('')
+        emit_object(out, decoder, decoder.tree(), 4)
+        out.append('')
+        out.append('    return check_members(scanner, {}, seen, {}_members, G_N_ELEMENTS({}_members));'.format(
+            c_string(decoder.name.replace('_', ' ')), decoder.name, decoder.name))
+        out.append('}')
+        out.append('')
+        out.append('{}*'.format(decoder.struct))
+        out.append('gt_json_decode_{}(GtJsonScanner* scanner)'.format(decoder.name))
+        out.append('{')
+        out.append('    g_autoptr({}) data = {}_new();'.format(decoder.struct, decoder.prefix))
+        out.append('')
+        out.append('    if (!fill_{}(scanner, data))'.format(decoder.name))
+        out.append('        return NULL;')
+        out.append('')
+        for field, value in decoder.constants:
+            out.append('    data->{} = {};'.format(field, value))
+        if decoder.constants:
+            out.append('')
+        out.append('    return g_steal_pointer(&data);')
+        out.append('}')
+
+    for name, member, decoder in pages:
+        out.append('')
+        out.append('GList*')
+        out.append('gt_json_decode_{}_page(const gchar* data, gsize length, GError** error)'.format(name))
+        out.append('{')
+        out.append('    return gt_json_decode_page(data, length, {},'.format(c_string(member)))
+        out.append('        (GtJsonDecodeFunc) gt_json_decode_{}, (GDestroyNotify) {}_free, error);'.format(
+            decoder.name, decoder.prefix))
+        out.append('}')
+
+    out.append('')
+    return '\n'.join(out)
+
+
+def emit_h(includes, decoders, pages, guard):
+    out = []
+    out.append('/* Generated by gen-json-decoders.py, do not edit */')
+    out.append('')
+    out.append('#ifndef {}'.format(guard))
+    out.append('#define {}'.format(guard))
+    out.append('')
+    out.append('#include "gt-json-scanner.h"')
+    for include in includes:
+        out.append('#include "{}"'.format(include))
+    out.append('')
+    out.append('G_BEGIN_DECLS')
+    out.append('')
+    for decoder in decoders.values():
+        out.append('{}* gt_json_decode_{}(GtJsonScanner* scanner);'.format(decoder.struct, decoder.name))
+    out.append('')
+    for name, member, decoder in pages:
+        out.append('GList* gt_json_decode_{}_page(const gchar* data, gsize length, GError** error);'.format(name))
+    out.append('')
+    out.append('G_END_DECLS')
+    out.append('')
+    out.append('#endif')
+    out.append('')
+    return '\n'.join(out)
+
+
+def main():
+    if len(sys.argv) != 4:
+        sys.stderr.write('Usage: {} SCHEMA OUTPUT.c OUTPUT.h\n'.format(sys.argv[0]))
+        sys.exit(1)
+
+    schema, out_c, out_h = sys.argv[1:]
+
+    try:
+        includes, decoders, pages = parse_schema(schema)
+    except SchemaError as e:
+        sys.stderr.write('{}\n'.format(e))
+        sys.exit(1)
+
+    header = out_h.replace('\\', '/').rsplit('/', 1)[-1]
+    guard = header.upper().replace('-', '_').replace('.', '_')
+
+    with open(out_c, 'w', encoding='utf-8') as f:
+        f.write(emit_c(includes, decoders, pages, header))
+    with open(out_h, 'w', encoding='utf-8') as f:
+        f.write(emit_h(includes, decoders, pages, guard))
+
+
+if __name__ == '__main__':
+    main()
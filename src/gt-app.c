@@ -375,6 +375,9 @@ startup(GApplication* app)
     self->fav_mgr = gt_follows_manager_new();
     self->twitch = gt_twitch_new();
 
+    g_settings_bind(self->settings, "chat-image-cache-size",
+        self->twitch, "image-cache-size", G_SETTINGS_BIND_GET);
+
     init_dirs();
 
     g_action_map_add_action_entries(G_ACTION_MAP(self),
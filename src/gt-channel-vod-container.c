@@ -22,6 +22,7 @@
 #include "gt-vod-container-child.h"
 #include "gt-win.h"
 #include "gt-http.h"
+#include "gt-json-decoders.h"
 #include "utils.h"
 #include <json-glib/json-glib.h>
 #include <gtk/gtk.h>
@@ -37,7 +38,6 @@
 typedef struct
 {
     gchar* channel_id;
-    JsonParser* json_parser;
     GCancellable* cancel;
 } GtChannelVODContainerPrivate;
 
@@ -94,7 +94,7 @@ static void
 process_json_cb(GObject* source,
     GAsyncResult* res, gpointer udata)
 {
-    RETURN_IF_FAIL(JSON_IS_PARSER(source));
+    RETURN_IF_FAIL(G_IS_MEMORY_OUTPUT_STREAM(source));
     RETURN_IF_FAIL(G_IS_ASYNC_RESULT(res));
     RETURN_IF_FAIL(udata != NULL);
 
@@ -107,12 +107,11 @@ process_json_cb(GObject* source,
         return;
     }
 
-    GtChannelVODContainerPrivate* priv = gt_channel_vod_container_get_instance_private(self);
-    g_autoptr(JsonReader) reader = NULL;
+    g_autoptr(GBytes) bytes = NULL;
     g_autoptr(GtGameList) items = NULL;
     g_autoptr(GError) err = NULL;
 
-    json_parser_load_from_stream_finish(priv->json_parser, res, &err);
+    g_output_stream_splice_finish(G_OUTPUT_STREAM(source), res, &err);
 
     if (g_error_matches(err, G_IO_ERROR, G_IO_ERROR_CANCELLED))
     {
@@ -126,45 +125,19 @@ process_json_cb(GObject* source,
         return;
     }
 
-    reader = json_reader_new(json_parser_get_root(priv->json_parser));
+    bytes = g_memory_output_stream_steal_as_bytes(G_MEMORY_OUTPUT_STREAM(source));
 
-    if (!json_reader_read_member(reader, "videos"))
-    {
-        WARNING("Unable to process JSON because: %s",
-            json_reader_get_error(reader)->message);
-        gt_item_container_show_error(GT_ITEM_CONTAINER(self),
-            json_reader_get_error(reader));
-        return;
-    }
+    items = gt_json_decode_videos_page(g_bytes_get_data(bytes, NULL), g_bytes_get_size(bytes), &err);
 
-    for (gint i = 0; i < json_reader_count_elements(reader); i++)
+    if (err)
     {
-        g_autoptr(GtVODData) data = NULL;
-
-        if (!json_reader_read_element(reader, i))
-        {
-            WARNING("Unable to process JSON because: %s",
-                json_reader_get_error(reader)->message);
-            gt_item_container_show_error(GT_ITEM_CONTAINER(self),
-                json_reader_get_error(reader));
-            return;
-        }
-
-        data = utils_parse_vod_from_json(reader, &err);
-
-        if (err)
-        {
-            WARNING("Unable to process JSON because: %s", err->message);
-            gt_item_container_show_error(GT_ITEM_CONTAINER(self), err);
-            return;
-        }
-
-        items = g_list_append(items, gt_vod_new(g_steal_pointer(&data)));
-
-        json_reader_end_element(reader);
+        WARNING("Unable to process JSON because: %s", err->message);
+        gt_item_container_show_error(GT_ITEM_CONTAINER(self), err);
+        return;
     }
 
-    json_reader_end_member(reader);
+    for (GList* l = items; l != NULL; l = l->next)
+        l->data = gt_vod_new(l->data);
 
     gt_item_container_append_items(GT_ITEM_CONTAINER(self), g_steal_pointer(&items));
     gt_item_container_set_fetching_items(GT_ITEM_CONTAINER(self), FALSE);
@@ -184,6 +157,7 @@ handle_response_cb(GtHTTP* http,
     if (!self) {TRACE("Unreffed while waiting"); return;}
 
     GtChannelVODContainerPrivate* priv = gt_channel_vod_container_get_instance_private(self);
+    g_autoptr(GOutputStream) output = NULL;
     GInputStream* istream = res; /* NOTE: Owned by GtHTTP */
 
     if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
@@ -200,8 +174,11 @@ handle_response_cb(GtHTTP* http,
 
     RETURN_IF_FAIL(G_IS_INPUT_STREAM(res));
 
-    json_parser_load_from_stream_async(priv->json_parser, res,
-        priv->cancel, process_json_cb, g_steal_pointer(&ref));
+    output = g_memory_output_stream_new_resizable();
+
+    g_output_stream_splice_async(output, G_INPUT_STREAM(res),
+        G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE | G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+        G_PRIORITY_DEFAULT, priv->cancel, process_json_cb, g_steal_pointer(&ref));
 }
 
 static void
@@ -285,5 +262,4 @@ gt_channel_vod_container_init(GtChannelVODContainer* self)
 
     priv->channel_id = NULL;
     priv->cancel = NULL;
-    priv->json_parser = json_parser_new();
 }
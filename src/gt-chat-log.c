@@ -0,0 +1,895 @@
+/*
+ *  This file is part of GNOME Twitch - 'Enjoy Twitch on your GNU/Linux desktop'
+ *  Copyright © 2017 Vincent Szolnoky <vinszent@vinszent.com>
+ *
+ *  GNOME Twitch is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GNOME Twitch is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNOME Twitch. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* NOTE: Each channel has an append only log of records and a sparse
+ * index next to it. Both start with a 16 byte header holding a magic
+ * and the format version, all integers are little endian.
+ *
+ * A record is a 32 byte header followed by the user id, nick, display
+ * name, colour and message, each with a terminating NUL so they can be
+ * used straight from the mapped file, and then the emote ranges:
+ *
+ *   0  u32 size of the record after this field
+ *   4  i64 timestamp in microseconds since the epoch
+ *   12 u32 flags
+ *   16 u16 user id, nick, display name and colour lengths
+ *   24 u16 number of emotes
+ *   26 u16 reserved
+ *   28 u32 message length
+ *
+ * An emote range is its i64 id followed by the u32 offsets of its
+ * first and last character. Every INDEX_INTERVAL records the index
+ * gets an entry with the timestamp, offset and number of that record.
+ *
+ * Records are encoded on the calling thread into a pending buffer that
+ * a writer thread swaps out and writes in one go, so appending never
+ * waits on the disk. The log is only synced every SYNC_INTERVAL, a
+ * crash can cut it short but never leaves anything but a partial
+ * record at the end, which is dropped the next time it's opened.
+ *
+ * Only one GtChatLog records a channel at a time, it holds an
+ * exclusive lock on the log for as long as it's open. Anyone else
+ * opening it gets G_IO_ERROR_BUSY and can still read the history, the
+ * log is never truncated while another instance holds it */
+
+#include "gt-chat-log.h"
+#include "utils.h"
+#include <glib/gstdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+
+#define TAG "GtChatLog"
+#include "gnome-twitch/gt-log.h"
+
+#define LOG_MAGIC "GTCHATLG"
+#define INDEX_MAGIC "GTCHATIX"
+#define FORMAT_VERSION 1
+
+#define FILE_HEADER_SIZE 16
+#define RECORD_HEADER_SIZE 32
+#define EMOTE_SIZE 16
+#define INDEX_ENTRY_SIZE 24
+
+#define INDEX_INTERVAL 64 // In records
+#define FLUSH_SIZE (64*1024) // Pending bytes after which the writer is woken early
+#define FLUSH_INTERVAL G_TIME_SPAN_SECOND
+#define SYNC_INTERVAL (5*G_TIME_SPAN_SECOND)
+
+typedef struct
+{
+    gchar* path;
+    gint fd;
+    gint index_fd;
+
+    GThread* thread;
+    GMutex mutex;
+    GCond cond;
+    GByteArray* pending;
+    gboolean stop;
+
+    /* NOTE: Only touched by the writer thread once it's started */
+    GByteArray* batch;
+    GByteArray* entries;
+    guint64 offset;
+    guint64 count;
+    gboolean failed;
+} GtChatLogPrivate;
+
+struct _GtChatLogReader
+{
+    GMappedFile* log;
+    GMappedFile* index;
+    const guint8* data;
+    gsize size;
+    const guint8* entries;
+    guint n_entries;
+    gsize pos;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE(GtChatLog, gt_chat_log, G_TYPE_OBJECT)
+
+static inline void
+put_u16(guint8* p, guint16 v)
+{
+    v = GUINT16_TO_LE(v);
+    memcpy(p, &v, sizeof(v));
+}
+
+static inline void
+put_u32(guint8* p, guint32 v)
+{
+    v = GUINT32_TO_LE(v);
+    memcpy(p, &v, sizeof(v));
+}
+
+static inline void
+put_u64(guint8* p, guint64 v)
+{
+    v = GUINT64_TO_LE(v);
+    memcpy(p, &v, sizeof(v));
+}
+
+static inline guint16
+get_u16(const guint8* p)
+{
+    guint16 v;
+
+    memcpy(&v, p, sizeof(v));
+
+    return GUINT16_FROM_LE(v);
+}
+
+static inline guint32
+get_u32(const guint8* p)
+{
+    guint32 v;
+
+    memcpy(&v, p, sizeof(v));
+
+    return GUINT32_FROM_LE(v);
+}
+
+static inline guint64
+get_u64(const guint8* p)
+{
+    guint64 v;
+
+    memcpy(&v, p, sizeof(v));
+
+    return GUINT64_FROM_LE(v);
+}
+
+static void
+make_header(guint8* header, const gchar* magic)
+{
+    memset(header, 0, FILE_HEADER_SIZE);
+    memcpy(header, magic, 8);
+    put_u32(header + 8, FORMAT_VERSION);
+}
+
+static gboolean
+check_header(const guint8* header, const gchar* magic)
+{
+    return memcmp(header, magic, 8) == 0 && get_u32(header + 8) == FORMAT_VERSION;
+}
+
+static void
+append_entry(GByteArray* entries, gint64 timestamp, guint64 offset, guint64 count)
+{
+    guint8 entry[INDEX_ENTRY_SIZE];
+
+    put_u64(entry, timestamp);
+    put_u64(entry + 8, offset);
+    put_u64(entry + 16, count);
+
+    g_byte_array_append(entries, entry, INDEX_ENTRY_SIZE);
+}
+
+static gchar*
+log_directory()
+{
+    return g_build_filename(g_get_user_data_dir(), "gnome-twitch", "chat-logs", NULL);
+}
+
+static gboolean
+write_all(gint fd, const guint8* data, gsize len)
+{
+    while (len > 0)
+    {
+        gssize n = write(fd, data, len);
+
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            return FALSE;
+        }
+
+        data += n;
+        len -= n;
+    }
+
+    return TRUE;
+}
+
+static gboolean
+read_all(gint fd, guint8* data, gsize len)
+{
+    while (len > 0)
+    {
+        gssize n = read(fd, data, len);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+        else if (n <= 0)
+            return FALSE;
+
+        data += n;
+        len -= n;
+    }
+
+    return TRUE;
+}
+
+/* NOTE: Returns the size of the record at pos including its size
+ * field, or 0 if it's cut short or malformed. Only the size is checked
+ * if record is NULL */
+static gsize
+parse_record(const guint8* data, gsize size, gsize pos, GtChatLogRecord* record)
+{
+    const guint8* p = data + pos;
+    const gchar** fields[4];
+    const gchar* str;
+    guint16 lens[4];
+    guint16 n_emotes;
+    guint32 msg_len;
+    gsize len;
+
+    if (pos > size || size - pos < RECORD_HEADER_SIZE)
+        return 0;
+
+    len = (gsize) get_u32(p) + 4;
+
+    if (len < RECORD_HEADER_SIZE || len > size - pos)
+        return 0;
+
+    if (!record)
+        return len;
+
+    for (gint i = 0; i < 4; i++)
+        lens[i] = get_u16(p + 16 + 2*i);
+
+    n_emotes = get_u16(p + 24);
+    msg_len = get_u32(p + 28);
+
+    if (len != RECORD_HEADER_SIZE + (gsize) lens[0] + lens[1] + lens[2] + lens[3] +
+        msg_len + 5 + (gsize) n_emotes*EMOTE_SIZE)
+    {
+        return 0;
+    }
+
+    fields[0] = &record->user_id;
+    fields[1] = &record->nick;
+    fields[2] = &record->display_name;
+    fields[3] = &record->colour;
+
+    str = (const gchar*) p + RECORD_HEADER_SIZE;
+
+    for (gint i = 0; i < 4; i++)
+    {
+        if (str[lens[i]] != '\0')
+            return 0;
+
+        *fields[i] = str;
+        str += lens[i] + 1;
+    }
+
+    if (str[msg_len] != '\0')
+        return 0;
+
+    record->msg = str;
+    record->timestamp = get_u64(p + 4);
+    record->flags = get_u32(p + 12);
+    record->n_emotes = n_emotes;
+    record->emotes = (const guint8*) str + msg_len + 1;
+
+    return len;
+}
+
+/* NOTE: Picks up where the log left off. Index entries pointing past
+ * the end of the log are dropped, the records after the last entry are
+ * walked to find the end of the last whole record, anything after it is
+ * truncated, and entries the writer didn't get to are added again */
+static gboolean
+recover(GtChatLog* self, GError** error)
+{
+    GtChatLogPrivate* priv = gt_chat_log_get_instance_private(self);
+    g_autoptr(GByteArray) entries = g_byte_array_new();
+    guint8 header[FILE_HEADER_SIZE];
+    guint8 buf[RECORD_HEADER_SIZE];
+    gboolean indexed = FALSE;
+    goffset size, index_size, pos;
+    guint64 n_entries;
+    gint code;
+
+    if ((size = lseek(priv->fd, 0, SEEK_END)) < 0 ||
+        (index_size = lseek(priv->index_fd, 0, SEEK_END)) < 0)
+    {
+        goto io_error;
+    }
+
+    if (size == 0)
+    {
+        make_header(header, LOG_MAGIC);
+
+        if (!write_all(priv->fd, header, FILE_HEADER_SIZE))
+            goto io_error;
+
+        size = FILE_HEADER_SIZE;
+        index_size = 0;
+    }
+    else if (size < FILE_HEADER_SIZE || lseek(priv->fd, 0, SEEK_SET) != 0 ||
+        !read_all(priv->fd, header, FILE_HEADER_SIZE) || !check_header(header, LOG_MAGIC))
+    {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+            "File '%s' is not a chat log", priv->path);
+
+        return FALSE;
+    }
+
+    /* NOTE: The index can always be rebuilt, start it over if it's unusable */
+    if (index_size < FILE_HEADER_SIZE || lseek(priv->index_fd, 0, SEEK_SET) != 0 ||
+        !read_all(priv->index_fd, header, FILE_HEADER_SIZE) || !check_header(header, INDEX_MAGIC))
+    {
+        make_header(header, INDEX_MAGIC);
+
+        if (ftruncate(priv->index_fd, 0) != 0 || lseek(priv->index_fd, 0, SEEK_SET) != 0 ||
+            !write_all(priv->index_fd, header, FILE_HEADER_SIZE))
+        {
+            goto io_error;
+        }
+
+        index_size = FILE_HEADER_SIZE;
+    }
+
+    n_entries = (index_size - FILE_HEADER_SIZE) / INDEX_ENTRY_SIZE;
+    pos = FILE_HEADER_SIZE;
+    priv->count = 0;
+
+    for (; n_entries > 0; n_entries--)
+    {
+        guint8 entry[INDEX_ENTRY_SIZE];
+
+        if (lseek(priv->index_fd, FILE_HEADER_SIZE + (n_entries - 1)*INDEX_ENTRY_SIZE, SEEK_SET) < 0 ||
+            !read_all(priv->index_fd, entry, INDEX_ENTRY_SIZE))
+        {
+            goto io_error;
+        }
+
+        if (get_u64(entry + 8) < (guint64) size)
+        {
+            pos = get_u64(entry + 8);
+            priv->count = get_u64(entry + 16);
+            indexed = TRUE;
+            break;
+        }
+    }
+
+    if (lseek(priv->fd, pos, SEEK_SET) != pos)
+        goto io_error;
+
+    while (size - pos >= RECORD_HEADER_SIZE)
+    {
+        gsize len;
+
+        if (!read_all(priv->fd, buf, RECORD_HEADER_SIZE))
+            goto io_error;
+
+        len = (gsize) get_u32(buf) + 4;
+
+        if (len < RECORD_HEADER_SIZE || len > (gsize) (size - pos))
+            break;
+
+        if (priv->count % INDEX_INTERVAL == 0 && !indexed)
+            append_entry(entries, get_u64(buf + 4), pos, priv->count);
+
+        indexed = FALSE;
+
+        priv->count++;
+        pos += len;
+
+        if (lseek(priv->fd, pos, SEEK_SET) != pos)
+            goto io_error;
+    }
+
+    /* NOTE: The record of the last entry didn't make it, the writer
+     * adds the entry again once it does */
+    if (indexed)
+        n_entries--;
+
+    if (pos < size)
+    {
+        WARNINGF("Dropping '%" G_GINT64_FORMAT "' bytes of partial records from the end of chat log '%s'",
+            (gint64) (size - pos), priv->path);
+
+        if (ftruncate(priv->fd, pos) != 0)
+            goto io_error;
+    }
+
+    if (ftruncate(priv->index_fd, FILE_HEADER_SIZE + n_entries*INDEX_ENTRY_SIZE) != 0 ||
+        lseek(priv->index_fd, 0, SEEK_END) < 0 ||
+        !write_all(priv->index_fd, entries->data, entries->len))
+    {
+        goto io_error;
+    }
+
+    priv->offset = pos;
+
+    return TRUE;
+
+io_error:
+    code = errno;
+
+    g_set_error(error, G_IO_ERROR, g_io_error_from_errno(code),
+        "Unable to open chat log '%s' because: %s", priv->path, g_strerror(code));
+
+    return FALSE;
+}
+
+static void
+write_batch(GtChatLog* self)
+{
+    GtChatLogPrivate* priv = gt_chat_log_get_instance_private(self);
+    GByteArray* batch = priv->batch;
+
+    if (priv->failed)
+        return;
+
+    for (gsize pos = 0; pos < batch->len; pos += get_u32(batch->data + pos) + 4)
+    {
+        if (priv->count % INDEX_INTERVAL == 0)
+            append_entry(priv->entries, get_u64(batch->data + pos + 4), priv->offset + pos, priv->count);
+
+        priv->count++;
+    }
+
+    /* NOTE: The log is written first so the index never points past it */
+    if (!write_all(priv->fd, batch->data, batch->len) ||
+        !write_all(priv->index_fd, priv->entries->data, priv->entries->len))
+    {
+        WARNINGF("Unable to write to chat log '%s' because: %s",
+            priv->path, g_strerror(errno));
+
+        priv->failed = TRUE;
+    }
+
+    priv->offset += batch->len;
+
+    g_byte_array_set_size(priv->entries, 0);
+}
+
+static gpointer
+writer_thread_func(GtChatLog* self)
+{
+    GtChatLogPrivate* priv = gt_chat_log_get_instance_private(self);
+    gint64 synced = g_get_monotonic_time();
+    gboolean dirty = FALSE;
+    gboolean stop = FALSE;
+
+    while (!stop)
+    {
+        gint64 deadline = g_get_monotonic_time() + FLUSH_INTERVAL;
+        GByteArray* tmp;
+
+        g_mutex_lock(&priv->mutex);
+
+        while (priv->pending->len < FLUSH_SIZE && !priv->stop)
+        {
+            if (!g_cond_wait_until(&priv->cond, &priv->mutex, deadline))
+                break;
+        }
+
+        tmp = priv->batch;
+        priv->batch = priv->pending;
+        priv->pending = tmp;
+        stop = priv->stop;
+
+        g_mutex_unlock(&priv->mutex);
+
+        if (priv->batch->len > 0)
+        {
+            write_batch(self);
+            g_byte_array_set_size(priv->batch, 0);
+
+            dirty = TRUE;
+        }
+
+        if (dirty && !priv->failed && (stop || g_get_monotonic_time() - synced >= SYNC_INTERVAL))
+        {
+            if (g_fsync(priv->fd) != 0 || g_fsync(priv->index_fd) != 0)
+                WARNINGF("Unable to sync chat log '%s' because: %s", priv->path, g_strerror(errno));
+
+            synced = g_get_monotonic_time();
+            dirty = FALSE;
+        }
+    }
+
+    return NULL;
+}
+
+static void
+dispose(GObject* obj)
+{
+    GtChatLog* self = GT_CHAT_LOG(obj);
+    GtChatLogPrivate* priv = gt_chat_log_get_instance_private(self);
+
+    /* NOTE: Whatever is still pending is written and synced before
+     * the writer exits */
+    if (priv->thread)
+    {
+        g_mutex_lock(&priv->mutex);
+        priv->stop = TRUE;
+        g_cond_signal(&priv->cond);
+        g_mutex_unlock(&priv->mutex);
+
+        g_thread_join(priv->thread);
+        priv->thread = NULL;
+    }
+
+    G_OBJECT_CLASS(gt_chat_log_parent_class)->dispose(obj);
+}
+
+static void
+finalise(GObject* obj)
+{
+    GtChatLog* self = GT_CHAT_LOG(obj);
+    GtChatLogPrivate* priv = gt_chat_log_get_instance_private(self);
+
+    if (priv->fd >= 0)
+        g_close(priv->fd, NULL);
+
+    if (priv->index_fd >= 0)
+        g_close(priv->index_fd, NULL);
+
+    g_byte_array_free(priv->pending, TRUE);
+    g_byte_array_free(priv->batch, TRUE);
+    g_byte_array_free(priv->entries, TRUE);
+    g_free(priv->path);
+    g_mutex_clear(&priv->mutex);
+    g_cond_clear(&priv->cond);
+
+    G_OBJECT_CLASS(gt_chat_log_parent_class)->finalize(obj);
+}
+
+static void
+gt_chat_log_class_init(GtChatLogClass* klass)
+{
+    G_OBJECT_CLASS(klass)->dispose = dispose;
+    G_OBJECT_CLASS(klass)->finalize = finalise;
+}
+
+static void
+gt_chat_log_init(GtChatLog* self)
+{
+    GtChatLogPrivate* priv = gt_chat_log_get_instance_private(self);
+
+    priv->fd = -1;
+    priv->index_fd = -1;
+    priv->pending = g_byte_array_new();
+    priv->batch = g_byte_array_new();
+    priv->entries = g_byte_array_new();
+
+    g_mutex_init(&priv->mutex);
+    g_cond_init(&priv->cond);
+}
+
+/* NOTE: Opens the log of the channel for appending, creating it if it
+ * doesn't exist yet. Fails with G_IO_ERROR_BUSY if it's already being
+ * recorded */
+GtChatLog*
+gt_chat_log_new(const gchar* channel, GError** error)
+{
+    g_assert_false(utils_str_empty(channel));
+
+    g_autoptr(GtChatLog) self = g_object_new(GT_TYPE_CHAT_LOG, NULL);
+    GtChatLogPrivate* priv = gt_chat_log_get_instance_private(self);
+    g_autofree gchar* dir = log_directory();
+    g_autofree gchar* filename = NULL;
+    g_autofree gchar* index_path = NULL;
+    gint code;
+
+    filename = g_strdup_printf("%s.log", channel);
+    priv->path = g_build_filename(dir, filename, NULL);
+    index_path = g_strdup_printf("%s.idx", priv->path);
+
+    if (g_mkdir_with_parents(dir, 0700) != 0 ||
+        (priv->fd = g_open(priv->path, O_RDWR | O_CREAT, 0600)) < 0 ||
+        (priv->index_fd = g_open(index_path, O_RDWR | O_CREAT, 0600)) < 0)
+    {
+        code = errno;
+
+        g_set_error(error, G_IO_ERROR, g_io_error_from_errno(code),
+            "Unable to open chat log '%s' because: %s", priv->path, g_strerror(code));
+
+        return NULL;
+    }
+
+    /* NOTE: The index is only ever touched by whoever holds the lock
+     * on the log */
+    if (flock(priv->fd, LOCK_EX | LOCK_NB) != 0)
+    {
+        code = errno;
+
+        if (code == EWOULDBLOCK)
+        {
+            g_set_error(error, G_IO_ERROR, G_IO_ERROR_BUSY,
+                "Chat log '%s' is already being recorded", priv->path);
+        }
+        else
+        {
+            g_set_error(error, G_IO_ERROR, g_io_error_from_errno(code),
+                "Unable to lock chat log '%s' because: %s", priv->path, g_strerror(code));
+        }
+
+        return NULL;
+    }
+
+    if (!recover(self, error))
+        return NULL;
+
+    DEBUGF("Opened chat log '%s' with '%" G_GUINT64_FORMAT "' records", priv->path, priv->count);
+
+    priv->thread = g_thread_new("gnome-twitch-chat-log", (GThreadFunc) writer_thread_func, self);
+
+    return g_steal_pointer(&self);
+}
+
+/* NOTE: Strings may be NULL, they are stored as empty strings */
+void
+gt_chat_log_append(GtChatLog* self, gint64 timestamp, guint32 flags,
+    const gchar* user_id, const gchar* nick, const gchar* display_name,
+    const gchar* colour, const gchar* msg, GList* emotes)
+{
+    g_assert(GT_IS_CHAT_LOG(self));
+
+    GtChatLogPrivate* priv = gt_chat_log_get_instance_private(self);
+    const gchar* fields[] = {user_id, nick, display_name, colour};
+    guint8 header[RECORD_HEADER_SIZE] = {0};
+    gsize lens[4];
+    gsize msg_len = msg ? strlen(msg) : 0;
+    guint n_emotes = MIN(g_list_length(emotes), G_MAXUINT16);
+    gsize size = RECORD_HEADER_SIZE + msg_len + 5 + n_emotes*EMOTE_SIZE;
+    GList* l = emotes;
+
+    for (gint i = 0; i < 4; i++)
+    {
+        lens[i] = fields[i] ? MIN(strlen(fields[i]), G_MAXUINT16) : 0;
+        size += lens[i];
+    }
+
+    put_u32(header, size - 4);
+    put_u64(header + 4, timestamp);
+    put_u32(header + 12, flags);
+
+    for (gint i = 0; i < 4; i++)
+        put_u16(header + 16 + 2*i, lens[i]);
+
+    put_u16(header + 24, n_emotes);
+    put_u32(header + 28, msg_len);
+
+    g_mutex_lock(&priv->mutex);
+
+    g_byte_array_append(priv->pending, header, RECORD_HEADER_SIZE);
+
+    for (gint i = 0; i < 4; i++)
+    {
+        if (lens[i] > 0)
+            g_byte_array_append(priv->pending, (const guint8*) fields[i], lens[i]);
+
+        g_byte_array_append(priv->pending, (const guint8*) "", 1);
+    }
+
+    if (msg_len > 0)
+        g_byte_array_append(priv->pending, (const guint8*) msg, msg_len);
+
+    g_byte_array_append(priv->pending, (const guint8*) "", 1);
+
+    for (guint i = 0; i < n_emotes; i++, l = l->next)
+    {
+        GtChatEmote* emote = l->data;
+        guint8 range[EMOTE_SIZE];
+
+        put_u64(range, emote->id);
+        put_u32(range + 8, emote->start);
+        put_u32(range + 12, emote->end);
+
+        g_byte_array_append(priv->pending, range, EMOTE_SIZE);
+    }
+
+    if (priv->pending->len >= FLUSH_SIZE)
+        g_cond_signal(&priv->cond);
+
+    g_mutex_unlock(&priv->mutex);
+}
+
+/* NOTE: Maps the log of the channel for reading, starting at the
+ * first record. Returns NULL with a G_FILE_ERROR_NOENT error if the
+ * channel has no log */
+GtChatLogReader*
+gt_chat_log_reader_new(const gchar* channel, GError** error)
+{
+    g_assert_false(utils_str_empty(channel));
+
+    g_autoptr(GtChatLogReader) reader = g_new0(GtChatLogReader, 1);
+    g_autofree gchar* dir = log_directory();
+    g_autofree gchar* filename = g_strdup_printf("%s.log", channel);
+    g_autofree gchar* path = g_build_filename(dir, filename, NULL);
+    g_autofree gchar* index_path = g_strdup_printf("%s.idx", path);
+
+    if (!(reader->log = g_mapped_file_new(path, FALSE, error)))
+        return NULL;
+
+    reader->data = (const guint8*) g_mapped_file_get_contents(reader->log);
+    reader->size = g_mapped_file_get_length(reader->log);
+
+    if (reader->size < FILE_HEADER_SIZE || !check_header(reader->data, LOG_MAGIC))
+    {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+            "File '%s' is not a chat log", path);
+
+        return NULL;
+    }
+
+    reader->pos = FILE_HEADER_SIZE;
+
+    /* NOTE: Without a usable index seeking falls back to walking the log */
+    if ((reader->index = g_mapped_file_new(index_path, FALSE, NULL)) &&
+        g_mapped_file_get_length(reader->index) >= FILE_HEADER_SIZE &&
+        check_header((const guint8*) g_mapped_file_get_contents(reader->index), INDEX_MAGIC))
+    {
+        reader->entries = (const guint8*) g_mapped_file_get_contents(reader->index) + FILE_HEADER_SIZE;
+        reader->n_entries = (g_mapped_file_get_length(reader->index) - FILE_HEADER_SIZE) / INDEX_ENTRY_SIZE;
+
+        /* NOTE: The log could have been written to after the index was
+         * mapped, but never the other way around */
+        while (reader->n_entries > 0 &&
+            get_u64(reader->entries + (reader->n_entries - 1)*INDEX_ENTRY_SIZE + 8) >= reader->size)
+        {
+            reader->n_entries--;
+        }
+    }
+
+    return g_steal_pointer(&reader);
+}
+
+void
+gt_chat_log_reader_free(GtChatLogReader* reader)
+{
+    g_assert_nonnull(reader);
+
+    g_clear_pointer(&reader->log, g_mapped_file_unref);
+    g_clear_pointer(&reader->index, g_mapped_file_unref);
+    g_free(reader);
+}
+
+/* NOTE: Returns the last entry whose field at offset is at most value,
+ * or -1 if the first one is already past it */
+static gint
+find_entry(GtChatLogReader* reader, gsize offset, guint64 value)
+{
+    guint lo = 0;
+    guint hi = reader->n_entries;
+
+    while (lo < hi)
+    {
+        guint mid = lo + (hi - lo) / 2;
+
+        if (get_u64(reader->entries + mid*INDEX_ENTRY_SIZE + offset) <= value)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return (gint) lo - 1;
+}
+
+/* NOTE: Moves to the first record at or after timestamp */
+void
+gt_chat_log_reader_seek_time(GtChatLogReader* reader, gint64 timestamp)
+{
+    g_assert_nonnull(reader);
+
+    gint entry = find_entry(reader, 0, timestamp > 0 ? timestamp - 1 : 0);
+    gsize len;
+
+    reader->pos = entry < 0 ? FILE_HEADER_SIZE :
+        get_u64(reader->entries + entry*INDEX_ENTRY_SIZE + 8);
+
+    while ((len = parse_record(reader->data, reader->size, reader->pos, NULL)) > 0 &&
+        (gint64) get_u64(reader->data + reader->pos + 4) < timestamp)
+    {
+        reader->pos += len;
+    }
+}
+
+/* NOTE: Moves to the record count records before the end of the log */
+void
+gt_chat_log_reader_seek_tail(GtChatLogReader* reader, guint count)
+{
+    g_assert_nonnull(reader);
+
+    guint64 total = 0;
+    guint64 target;
+    gint entry;
+    gsize pos = FILE_HEADER_SIZE;
+    gsize len;
+
+    if (reader->n_entries > 0)
+    {
+        const guint8* last = reader->entries + (reader->n_entries - 1)*INDEX_ENTRY_SIZE;
+
+        pos = get_u64(last + 8);
+        total = get_u64(last + 16);
+    }
+
+    for (; (len = parse_record(reader->data, reader->size, pos, NULL)) > 0; pos += len)
+        total++;
+
+    target = total > count ? total - count : 0;
+    entry = find_entry(reader, 16, target);
+
+    if (entry < 0)
+    {
+        reader->pos = FILE_HEADER_SIZE;
+        total = 0;
+    }
+    else
+    {
+        reader->pos = get_u64(reader->entries + entry*INDEX_ENTRY_SIZE + 8);
+        total = get_u64(reader->entries + entry*INDEX_ENTRY_SIZE + 16);
+    }
+
+    for (; total < target && (len = parse_record(reader->data, reader->size, reader->pos, NULL)) > 0; total++)
+        reader->pos += len;
+}
+
+/* NOTE: Returns FALSE at the end of the log or at a record that
+ * couldn't be read */
+gboolean
+gt_chat_log_reader_next(GtChatLogReader* reader, GtChatLogRecord* record)
+{
+    g_assert_nonnull(reader);
+    g_assert_nonnull(record);
+
+    gsize len = parse_record(reader->data, reader->size, reader->pos, record);
+
+    if (len == 0)
+        return FALSE;
+
+    reader->pos += len;
+
+    return TRUE;
+}
+
+/* NOTE: Returns the emote ranges of the record as a list of
+ * GtChatEmote, free with gt_chat_emote_list_free */
+GList*
+gt_chat_log_record_get_emotes(const GtChatLogRecord* record)
+{
+    g_assert_nonnull(record);
+
+    GList* ret = NULL;
+
+    for (guint i = record->n_emotes; i > 0; i--)
+    {
+        const guint8* range = record->emotes + (i - 1)*EMOTE_SIZE;
+        GtChatEmote* emote = gt_chat_emote_new();
+
+        emote->id = get_u64(range);
+        emote->start = get_u32(range + 8);
+        emote->end = get_u32(range + 12);
+
+        ret = g_list_prepend(ret, emote);
+    }
+
+    return ret;
+}
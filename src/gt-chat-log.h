@@ -0,0 +1,66 @@
+/*
+ *  This file is part of GNOME Twitch - 'Enjoy Twitch on your GNU/Linux desktop'
+ *  Copyright © 2017 Vincent Szolnoky <vinszent@vinszent.com>
+ *
+ *  GNOME Twitch is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GNOME Twitch is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNOME Twitch. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GT_CHAT_LOG_H
+#define GT_CHAT_LOG_H
+
+#include <glib-object.h>
+#include "gt-twitch.h"
+
+G_BEGIN_DECLS
+
+#define GT_TYPE_CHAT_LOG gt_chat_log_get_type()
+
+G_DECLARE_FINAL_TYPE(GtChatLog, gt_chat_log, GT, CHAT_LOG, GObject);
+
+struct _GtChatLog
+{
+    GObject parent_instance;
+};
+
+/* NOTE: The strings point into the mapped log and are only valid as
+ * long as the reader they were read from */
+typedef struct
+{
+    gint64 timestamp; // In microseconds since the epoch
+    guint32 flags; // User modes of the sender
+    const gchar* user_id;
+    const gchar* nick;
+    const gchar* display_name;
+    const gchar* colour;
+    const gchar* msg;
+    guint n_emotes;
+    const guint8* emotes;
+} GtChatLogRecord;
+
+typedef struct _GtChatLogReader GtChatLogReader;
+
+GtChatLog*       gt_chat_log_new(const gchar* channel, GError** error);
+void             gt_chat_log_append(GtChatLog* self, gint64 timestamp, guint32 flags, const gchar* user_id, const gchar* nick, const gchar* display_name, const gchar* colour, const gchar* msg, GList* emotes);
+GtChatLogReader* gt_chat_log_reader_new(const gchar* channel, GError** error);
+void             gt_chat_log_reader_free(GtChatLogReader* reader);
+void             gt_chat_log_reader_seek_time(GtChatLogReader* reader, gint64 timestamp);
+void             gt_chat_log_reader_seek_tail(GtChatLogReader* reader, guint count);
+gboolean         gt_chat_log_reader_next(GtChatLogReader* reader, GtChatLogRecord* record);
+GList*           gt_chat_log_record_get_emotes(const GtChatLogRecord* record);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(GtChatLogReader, gt_chat_log_reader_free);
+
+G_END_DECLS
+
+#endif
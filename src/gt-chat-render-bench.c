@@ -0,0 +1,247 @@
+/*
+ *  This file is part of GNOME Twitch - 'Enjoy Twitch on your GNU/Linux desktop'
+ *  Copyright © 2017 Vincent Szolnoky <vinszent@vinszent.com>
+ *
+ *  GNOME Twitch is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GNOME Twitch is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNOME Twitch. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* NOTE: Appends synthetic chat messages to a GtChatView the way
+ * GtChat does, splitting them into runs first, and lays out and draws
+ * the view after every frame's worth of them. Laying out is done by
+ * reallocating the view while it's scrolled to the bottom, which goes
+ * through the same path as the commit on the next frame without
+ * waiting for the frame clock. Reports the time per message spent
+ * appending and the time per frame spent laying out and drawing.
+ *
+ * Needs a display. Emotes are all the same one and are laid out as
+ * placeholders, resolving them queues a single fetch in the
+ * background that isn't waited for */
+
+#include <gtk/gtk.h>
+#include <string.h>
+#include <stdlib.h>
+#include <locale.h>
+#include "gt-app.h"
+#include "gt-chat.h"
+#include "gt-chat-view.h"
+
+GtApp* main_app;
+gchar* ORIGINAL_LOCALE;
+
+static gint length = 500;
+static gint count = 2000;
+static gint per_frame = 10;
+static gint emote_every = 40;
+static gint url_every = 150;
+static gint width = 340;
+static gint height = 600;
+
+static GOptionEntry options[] =
+{
+    {"length", 'l', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &length, "Length of each message in characters", "N"},
+    {"count", 'c', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &count, "Number of messages to append", "N"},
+    {"per-frame", 'f', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &per_frame, "Messages appended between layouts", "N"},
+    {"emote-every", 'e', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &emote_every, "Characters between emotes, 0 for none", "N"},
+    {"url-every", 'u', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &url_every, "Characters between urls, 0 for none", "N"},
+    {"width", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &width, "Width of the view in pixels", "N"},
+    {"height", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &height, "Height of the view in pixels", "N"},
+    {NULL}
+};
+
+static const gchar* words[] =
+{
+    "that", "was", "close", "gg", "räksmörgås", "again", "what", "just", "happened", "ありがとう",
+};
+
+typedef struct
+{
+    gchar* text;
+    GList* emotes;
+} BenchMessage;
+
+static void
+bench_message_free(BenchMessage* msg)
+{
+    g_list_free_full(msg->emotes, g_free);
+    g_free(msg->text);
+    g_free(msg);
+}
+
+static BenchMessage*
+bench_message_new(GRand* rand)
+{
+    BenchMessage* msg = g_new0(BenchMessage, 1);
+    GString* text = g_string_new(NULL);
+    glong chars = 0;
+    glong next_emote = emote_every > 0 ? emote_every : G_MAXLONG;
+    glong next_url = url_every > 0 ? url_every : G_MAXLONG;
+
+    while (chars < length)
+    {
+        const gchar* word;
+        GtChatEmote* emote = NULL;
+
+        if (chars >= next_url)
+        {
+            word = "https://www.twitch.tv/videos/123456789?t=1h2m3s";
+            next_url += url_every;
+        }
+        else if (chars >= next_emote)
+        {
+            emote = g_new0(GtChatEmote, 1);
+            emote->id = 25;
+            emote->start = chars;
+            emote->end = chars + strlen("Kappa") - 1;
+            msg->emotes = g_list_append(msg->emotes, emote);
+
+            word = "Kappa";
+            next_emote += emote_every;
+        }
+        else
+            word = words[g_rand_int_range(rand, 0, G_N_ELEMENTS(words))];
+
+        g_string_append(text, word);
+        g_string_append_c(text, ' ');
+        chars += g_utf8_strlen(word, -1) + 1;
+    }
+
+    msg->text = g_string_free(text, FALSE);
+
+    return msg;
+}
+
+static void
+log_cb(const gchar* domain, GLogLevelFlags level,
+    const gchar* msg, gpointer udata)
+{
+    if (level <= G_LOG_LEVEL_WARNING)
+        g_printerr("%s\n", msg);
+}
+
+gint
+main(int argc, char** argv)
+{
+    g_autoptr(GOptionContext) ctx = NULL;
+    g_autoptr(GError) err = NULL;
+    g_autoptr(GPtrArray) msgs = NULL;
+    g_autoptr(GRegex) url_regex = NULL;
+    g_autoptr(GArray) runs = NULL;
+    g_autoptr(GRand) rand = NULL;
+    cairo_surface_t* surface;
+    cairo_t* cr;
+    GtkWidget* window;
+    GtkWidget* view;
+    GtkAllocation alloc;
+    gint64 append_time = 0;
+    gint64 layout_time = 0;
+    gint64 draw_time = 0;
+    guint frames = 0;
+
+    ctx = g_option_context_new("- append chat messages to a chat view");
+    g_option_context_add_main_entries(ctx, options, NULL);
+    g_option_context_add_group(ctx, gtk_get_option_group(FALSE));
+
+    if (!g_option_context_parse(ctx, &argc, &argv, &err))
+    {
+        g_printerr("%s\n", err->message);
+
+        return EXIT_FAILURE;
+    }
+
+    /* NOTE: Keep the benchmark away from the user's settings */
+    g_setenv("GSETTINGS_BACKEND", "memory", TRUE);
+
+    if (!gtk_init_check(&argc, &argv))
+    {
+        g_printerr("Unable to open a display\n");
+
+        return EXIT_FAILURE;
+    }
+
+    count = MAX(count, 1);
+    length = MAX(length, 1);
+    per_frame = MAX(per_frame, 1);
+
+    g_log_set_default_handler((GLogFunc) log_cb, NULL);
+
+    ORIGINAL_LOCALE = g_strdup(setlocale(LC_NUMERIC, NULL));
+
+    main_app = gt_app_new();
+    main_app->twitch = gt_twitch_new();
+
+    /* NOTE: Same pattern as GtChat */
+    url_regex = g_regex_new("(https?://([-\\w\\.]+)+(:\\d+)?(/([\\w/_\\.]*(\\?\\S+)?)?)?)",
+                            G_REGEX_OPTIMIZE, 0, NULL);
+    runs = g_array_new(FALSE, FALSE, sizeof(GtChatRun));
+    rand = g_rand_new_with_seed(42);
+    msgs = g_ptr_array_new_with_free_func((GDestroyNotify) bench_message_free);
+
+    for (gint i = 0; i < count; i++)
+        g_ptr_array_add(msgs, bench_message_new(rand));
+
+    window = gtk_offscreen_window_new();
+    view = GTK_WIDGET(gt_chat_view_new());
+    gtk_container_add(GTK_CONTAINER(window), view);
+    gtk_window_set_default_size(GTK_WINDOW(window), width, height);
+    gtk_widget_show_all(window);
+
+    gtk_widget_get_allocation(view, &alloc);
+
+    surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, MAX(alloc.width, 1), MAX(alloc.height, 1));
+    cr = cairo_create(surface);
+
+    g_print("Appending %d messages of %d characters, %d per frame, to a %dx%d view\n",
+        count, length, per_frame, alloc.width, alloc.height);
+
+    for (guint i = 0; i < msgs->len; )
+    {
+        gint64 start = g_get_monotonic_time();
+
+        for (gint j = 0; j < per_frame && i < msgs->len; j++, i++)
+        {
+            BenchMessage* msg = msgs->pdata[i];
+
+            g_array_set_size(runs, 0);
+            gt_chat_split_runs(runs, msg->text, url_regex, msg->emotes);
+
+            gt_chat_view_append_message(GT_CHAT_VIEW(view), "Bench", "bench", "1",
+                "#8A2BE2", NULL, runs);
+        }
+
+        append_time += g_get_monotonic_time() - start;
+        start = g_get_monotonic_time();
+
+        gtk_widget_size_allocate(view, &alloc);
+
+        layout_time += g_get_monotonic_time() - start;
+        start = g_get_monotonic_time();
+
+        gtk_widget_draw(view, cr);
+
+        draw_time += g_get_monotonic_time() - start;
+        frames++;
+    }
+
+    g_print("\n");
+    g_print("Append:             %.1f us/msg\n", (gdouble) append_time / count);
+    g_print("Layout:             %.1f us/frame\n", (gdouble) layout_time / frames);
+    g_print("Draw:               %.1f us/frame\n", (gdouble) draw_time / frames);
+    g_print("Lines kept:         %u\n", gt_chat_view_get_line_count(GT_CHAT_VIEW(view)));
+
+    cairo_destroy(cr);
+    cairo_surface_destroy(surface);
+    gtk_widget_destroy(window);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,2013 @@
+/*
+ *  This file is part of GNOME Twitch - 'Enjoy Twitch on your GNU/Linux desktop'
+ *  Copyright © 2017 Vincent Szolnoky <vinszent@vinszent.com>
+ *
+ *  GNOME Twitch is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GNOME Twitch is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNOME Twitch. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* NOTE: Chat lines are kept in a ring and only the lines on screen
+ * have a PangoLayout. The height of every line is kept in a Fenwick
+ * tree indexed by ring slot so finding the line at a scroll offset
+ * and the total height are logarithmic in the scrollback. Lines that
+ * have never been on screen are given an estimated height, as are
+ * lines laid out at a previous width until they're shown again, so
+ * resizing and appending never lay out more than a page of lines.
+ * Appending only adds to the ring, laying out and scrolling is done
+ * once per frame from a tick callback.
+ *
+ * Searching goes through an inverted index from casefolded words,
+ * nicks and user ids to the serials of the lines they are in. Each
+ * line keeps the postings it was added to so they can be pruned when
+ * it's dropped, which is always from the front of the postings
+ *
+ * The selection is kept as a serial and byte index at either end so
+ * it stays on the same text as lines are appended and laid out again,
+ * only the lines between the ends are walked when it's copied */
+
+#include "gt-chat-view.h"
+#include "gt-app.h"
+#include "utils.h"
+#include <glib/gi18n.h>
+#include <string.h>
+
+#define TAG "GtChatView"
+#include "gnome-twitch/gt-log.h"
+
+#define DEFAULT_SCROLLBACK 10000
+#define MIN_SCROLLBACK 100
+#define MAX_SCROLLBACK 100000
+
+#define LINE_MARGIN 3 // Left and right of each line, in pixels
+#define LINE_SPACING 2 // Above and below each line, in pixels
+
+#define COMMIT_STATS_INTERVAL 600 // In commits, roughly every 10s at 60fps
+
+#define COLOUR_CACHE_SIZE 256
+
+#define SEARCH_MATCH_CSS_CLASS "search-match"
+#define SELECTION_CSS_CLASS "selection"
+
+#define EMOTE_PLACEHOLDER_SIZE 28
+#define BADGE_PLACEHOLDER_SIZE 18
+
+#define OBJECT_REPLACEMENT_CHAR "\xef\xbf\xbc"
+
+typedef struct
+{
+    guint index; // Of the object replacement character standing in for the image
+    gint id; // Emote id, unused for badges
+    GtChatBadge* badge; // Owned by GtTwitch, NULL for emotes
+    GdkPixbuf* pixbuf; // At the widget's scale factor
+    gchar* code; // What the emote was typed as so it can be copied, NULL for badges
+} ChatImage;
+
+/* NOTE: End of the selection, a byte index into the line's text */
+typedef struct
+{
+    guint64 serial;
+    guint index;
+} ChatPosition;
+
+/* NOTE: Entry in the url index, a byte range of a line */
+typedef struct
+{
+    guint64 serial; // Of the line
+    guint start;
+    guint end;
+    gchar* url;
+} ChatUrl;
+
+typedef struct
+{
+    gchar* name;
+    PangoColor colour;
+    gboolean valid;
+} ChatColour;
+
+/* NOTE: Entry in the search index, serials before head belong to
+ * lines that have been dropped and are compacted away once they make
+ * up half of the entry */
+typedef struct
+{
+    gchar* token;
+    GArray* serials;
+    guint head;
+} ChatPosting;
+
+typedef struct
+{
+    guint64 serial;
+    gchar* text;
+    guint sender_start;
+    guint sender_end;
+    PangoColor colour;
+    gboolean has_colour;
+    gboolean notice;
+    gboolean unresolved; // Laid out with placeholders
+    gboolean has_urls;
+    GArray* images;
+    ChatPosting** postings;
+    guint n_postings;
+    gint height;
+    PangoLayout* layout;
+    guint generation;
+} ChatLine;
+
+typedef struct
+{
+    GtkAdjustment* hadjustment;
+    GtkAdjustment* vadjustment;
+    guint hscroll_policy : 1;
+    guint vscroll_policy : 1;
+
+    ChatLine* lines;
+    gint* tree;
+    guint capacity;
+    guint head;
+    guint len;
+    gint64 total_height;
+    guint64 serial;
+    gint estimate;
+    gint layout_width;
+
+    /* NOTE: Lines that have a layout, those not stamped with the
+     * current generation when validating are released */
+    GPtrArray* visible;
+    GPtrArray* spare;
+    guint generation;
+    gboolean validating;
+
+    /* NOTE: Lines appended since the last frame, they are committed
+     * together from the tick callback */
+    guint commit_tick;
+    guint staged_lines;
+    gint staged_evicted;
+    gboolean staged_scroll;
+
+    guint64 commits;
+    guint64 committed_lines;
+    gint64 commit_time;
+
+    /* NOTE: Urls of all lines in line order, entries before urls_head
+     * belong to lines that have been dropped and are compacted away
+     * once they make up half of the index */
+    GArray* urls;
+    guint urls_head;
+
+    /* NOTE: Search index keyed by token, the tokens searched for and
+     * the serial of the line currently matched, 0 if none */
+    GHashTable* index;
+    GPtrArray* line_postings;
+    GString* token;
+    GPtrArray* search_tokens;
+    guint64 match_serial;
+
+    /* NOTE: Where the selection was started and where it was dragged
+     * to, there's no selection when they're the same */
+    ChatPosition sel_anchor;
+    ChatPosition sel_cursor;
+    gboolean selecting;
+    GtkWidget* menu;
+    GtkWidget* copy_item;
+
+    /* NOTE: Parsed sender colours, most recently used first */
+    GHashTable* colour_table;
+    GQueue* colour_lru;
+
+    GString* scratch;
+} GtChatViewPrivate;
+
+typedef struct
+{
+    GtChatViewPrivate* priv;
+    ChatLine* line;
+} IndexData;
+
+typedef void (*TokenFunc)(const gchar* token, gsize len, gpointer udata);
+
+G_DEFINE_TYPE_WITH_CODE(GtChatView, gt_chat_view, GTK_TYPE_WIDGET,
+    G_ADD_PRIVATE(GtChatView)
+    G_IMPLEMENT_INTERFACE(GTK_TYPE_SCROLLABLE, NULL));
+
+enum
+{
+    PROP_0,
+    PROP_SCROLLBACK,
+    PROP_HADJUSTMENT,
+    PROP_VADJUSTMENT,
+    PROP_HSCROLL_POLICY,
+    PROP_VSCROLL_POLICY,
+    NUM_PROPS
+};
+
+static GParamSpec* props[NUM_PROPS];
+
+static void validate(GtChatView* self);
+
+static void
+tree_add(GtChatViewPrivate* priv, guint slot, gint delta)
+{
+    for (guint i = slot + 1; i <= priv->capacity; i += i & -i)
+        priv->tree[i] += delta;
+}
+
+/* NOTE: Sum of the heights in slots [0, n) */
+static gint64
+tree_sum(GtChatViewPrivate* priv, guint n)
+{
+    gint64 ret = 0;
+
+    for (guint i = n; i > 0; i -= i & -i)
+        ret += priv->tree[i];
+
+    return ret;
+}
+
+static inline ChatLine*
+line_at(GtChatViewPrivate* priv, guint n)
+{
+    return &priv->lines[(priv->head + n) % priv->capacity];
+}
+
+/* NOTE: Height of the first n lines, i.e. the offset of line n */
+static gint64
+line_offset(GtChatViewPrivate* priv, guint n)
+{
+    guint end = priv->head + n;
+
+    if (end <= priv->capacity)
+        return tree_sum(priv, end) - tree_sum(priv, priv->head);
+
+    return tree_sum(priv, priv->capacity) - tree_sum(priv, priv->head) + tree_sum(priv, end - priv->capacity);
+}
+
+/* NOTE: Returns the line covering offset y, which is clamped to the
+ * first and last line */
+static guint
+find_line(GtChatViewPrivate* priv, gdouble y, gint64* top)
+{
+    guint lo = 0;
+    guint hi = priv->len;
+
+    g_assert_cmpuint(priv->len, >, 0);
+
+    while (hi - lo > 1)
+    {
+        guint mid = lo + (hi - lo) / 2;
+
+        if (line_offset(priv, mid) <= y)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    *top = line_offset(priv, lo);
+
+    return lo;
+}
+
+static void
+set_line_height(GtChatViewPrivate* priv, ChatLine* line, gint height)
+{
+    tree_add(priv, line - priv->lines, height - line->height);
+    priv->total_height += height - line->height;
+    line->height = height;
+}
+
+static void
+chat_line_clear(ChatLine* line)
+{
+    g_free(line->text);
+
+    if (line->images)
+    {
+        for (guint i = 0; i < line->images->len; i++)
+        {
+            ChatImage* image = &g_array_index(line->images, ChatImage, i);
+
+            g_clear_object(&image->pixbuf);
+            g_free(image->code);
+        }
+
+        g_array_free(line->images, TRUE);
+    }
+
+    g_free(line->postings);
+    g_clear_object(&line->layout);
+
+    memset(line, 0, sizeof(ChatLine));
+}
+
+/* NOTE: Drops the urls of lines up to and including serial */
+static void
+prune_urls(GtChatViewPrivate* priv, guint64 serial)
+{
+    while (priv->urls_head < priv->urls->len)
+    {
+        ChatUrl* url = &g_array_index(priv->urls, ChatUrl, priv->urls_head);
+
+        if (url->serial > serial)
+            break;
+
+        g_free(url->url);
+        priv->urls_head++;
+    }
+
+    if (priv->urls_head == priv->urls->len)
+    {
+        g_array_set_size(priv->urls, 0);
+        priv->urls_head = 0;
+    }
+    else if (priv->urls_head > priv->urls->len / 2)
+    {
+        g_array_remove_range(priv->urls, 0, priv->urls_head);
+        priv->urls_head = 0;
+    }
+}
+
+/* NOTE: Returns the index of the first url of the line */
+static guint
+find_urls(GtChatViewPrivate* priv, ChatLine* line)
+{
+    guint lo = priv->urls_head;
+    guint hi = priv->urls->len;
+
+    while (lo < hi)
+    {
+        guint mid = lo + (hi - lo) / 2;
+
+        if (g_array_index(priv->urls, ChatUrl, mid).serial < line->serial)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+static void
+chat_posting_free(ChatPosting* posting)
+{
+    g_free(posting->token);
+    g_array_free(posting->serials, TRUE);
+    g_free(posting);
+}
+
+static void
+index_token(GtChatViewPrivate* priv, ChatLine* line, const gchar* token, gsize len)
+{
+    ChatPosting* posting;
+
+    g_string_truncate(priv->token, 0);
+    g_string_append_len(priv->token, token, len);
+
+    posting = g_hash_table_lookup(priv->index, priv->token->str);
+
+    if (!posting)
+    {
+        posting = g_new(ChatPosting, 1);
+        posting->token = g_strndup(token, len);
+        posting->serials = g_array_new(FALSE, FALSE, sizeof(guint64));
+        posting->head = 0;
+
+        g_hash_table_insert(priv->index, posting->token, posting);
+    }
+    else if (g_array_index(posting->serials, guint64, posting->serials->len - 1) == line->serial)
+        return;
+
+    g_array_append_val(posting->serials, line->serial);
+    g_ptr_array_add(priv->line_postings, posting);
+}
+
+/* NOTE: Calls func with every word of text after casefolding it, a
+ * word being a run of letters, digits, marks and underscores */
+static void
+foreach_token(const gchar* text, TokenFunc func, gpointer udata)
+{
+    g_autofree gchar* folded = g_utf8_casefold(text, -1);
+    const gchar* start = NULL;
+
+    for (const gchar* c = folded; ; c = g_utf8_next_char(c))
+    {
+        gunichar ch = g_utf8_get_char(c);
+        gboolean word = ch == '_' || g_unichar_isalnum(ch) || g_unichar_ismark(ch);
+
+        if (word && !start)
+            start = c;
+        else if (!word && start)
+        {
+            func(start, c - start, udata);
+            start = NULL;
+        }
+
+        if (ch == 0)
+            break;
+    }
+}
+
+static void
+index_token_cb(const gchar* token, gsize len, IndexData* data)
+{
+    index_token(data->priv, data->line, token, len);
+}
+
+static void
+index_line(GtChatViewPrivate* priv, ChatLine* line, const gchar* nick, const gchar* user_id)
+{
+    IndexData data = {priv, line};
+
+    g_ptr_array_set_size(priv->line_postings, 0);
+
+    foreach_token(line->text, (TokenFunc) index_token_cb, &data);
+
+    if (nick)
+        foreach_token(nick, (TokenFunc) index_token_cb, &data);
+
+    if (user_id)
+        foreach_token(user_id, (TokenFunc) index_token_cb, &data);
+
+    line->n_postings = priv->line_postings->len;
+    line->postings = g_new(ChatPosting*, line->n_postings);
+    memcpy(line->postings, priv->line_postings->pdata, line->n_postings*sizeof(ChatPosting*));
+}
+
+/* NOTE: Lines are dropped oldest first, so the line is always at the
+ * head of its postings */
+static void
+unindex_line(GtChatViewPrivate* priv, ChatLine* line)
+{
+    for (guint i = 0; i < line->n_postings; i++)
+    {
+        ChatPosting* posting = line->postings[i];
+
+        g_assert_cmpuint(g_array_index(posting->serials, guint64, posting->head), ==, line->serial);
+
+        posting->head++;
+
+        if (posting->head == posting->serials->len)
+            g_hash_table_remove(priv->index, posting->token);
+        else if (posting->head > posting->serials->len / 2)
+        {
+            g_array_remove_range(posting->serials, 0, posting->head);
+            posting->head = 0;
+        }
+    }
+
+    g_clear_pointer(&line->postings, g_free);
+    line->n_postings = 0;
+}
+
+/* NOTE: Returns the index of the first serial not before serial */
+static guint
+posting_find(ChatPosting* posting, guint64 serial)
+{
+    guint lo = posting->head;
+    guint hi = posting->serials->len;
+
+    while (lo < hi)
+    {
+        guint mid = lo + (hi - lo) / 2;
+
+        if (g_array_index(posting->serials, guint64, mid) < serial)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+static gboolean
+posting_contains(ChatPosting* posting, guint64 serial)
+{
+    guint i = posting_find(posting, serial);
+
+    return i < posting->serials->len && g_array_index(posting->serials, guint64, i) == serial;
+}
+
+static gint
+posting_compare(ChatPosting** a, ChatPosting** b)
+{
+    return ((*a)->serials->len - (*a)->head) - ((*b)->serials->len - (*b)->head);
+}
+
+static void
+add_search_token_cb(const gchar* token, gsize len, GPtrArray* tokens)
+{
+    g_ptr_array_add(tokens, g_strndup(token, len));
+}
+
+static void
+chat_colour_free(ChatColour* colour)
+{
+    g_free(colour->name);
+    g_free(colour);
+}
+
+static gboolean
+lookup_colour(GtChatViewPrivate* priv, const gchar* name, PangoColor* colour)
+{
+    GList* link = g_hash_table_lookup(priv->colour_table, name);
+    ChatColour* entry;
+
+    if (link)
+        g_queue_unlink(priv->colour_lru, link);
+    else
+    {
+        entry = g_new(ChatColour, 1);
+        entry->name = g_strdup(name);
+        entry->valid = pango_color_parse(&entry->colour, name);
+
+        link = g_list_alloc();
+        link->data = entry;
+
+        g_hash_table_insert(priv->colour_table, entry->name, link);
+
+        if (g_queue_get_length(priv->colour_lru) >= COLOUR_CACHE_SIZE)
+        {
+            GList* last = g_queue_pop_tail_link(priv->colour_lru);
+
+            g_hash_table_remove(priv->colour_table, ((ChatColour*) last->data)->name);
+            chat_colour_free(last->data);
+            g_list_free_1(last);
+        }
+    }
+
+    g_queue_push_head_link(priv->colour_lru, link);
+
+    entry = link->data;
+    *colour = entry->colour;
+
+    return entry->valid;
+}
+
+static void
+release_layouts(GtChatView* self)
+{
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+
+    for (guint i = 0; i < priv->visible->len; i++)
+        g_clear_object(&((ChatLine*) priv->visible->pdata[i])->layout);
+
+    g_ptr_array_set_size(priv->visible, 0);
+}
+
+/* NOTE: The surface of an image is made once and kept on its pixbuf
+ * so drawing doesn't convert it every frame. It carries the scale
+ * the pixbuf was fetched at so that it's painted at its logical size
+ * on HiDPI screens without being resampled */
+static cairo_surface_t*
+image_surface(GdkPixbuf* pixbuf, gint scale)
+{
+    static GQuark quarks[GT_CHAT_IMAGE_MAX_SCALE] = {0};
+    cairo_surface_t* surface;
+    GQuark quark;
+
+    if (G_UNLIKELY(!quarks[0]))
+    {
+        quarks[0] = g_quark_from_static_string("gt-chat-view-surface-1");
+        quarks[1] = g_quark_from_static_string("gt-chat-view-surface-2");
+        quarks[2] = g_quark_from_static_string("gt-chat-view-surface-3");
+    }
+
+    quark = quarks[CLAMP(scale, 1, GT_CHAT_IMAGE_MAX_SCALE) - 1];
+    surface = g_object_get_qdata(G_OBJECT(pixbuf), quark);
+
+    if (!surface)
+    {
+        surface = gdk_cairo_surface_create_from_pixbuf(pixbuf, scale, NULL);
+        g_object_set_qdata_full(G_OBJECT(pixbuf), quark, surface,
+            (GDestroyNotify) cairo_surface_destroy);
+    }
+
+    return surface;
+}
+
+static void
+shape_renderer(cairo_t* cr, PangoAttrShape* attr,
+    gboolean do_path, gpointer udata)
+{
+    cairo_surface_t* surface = attr->data;
+    gdouble x, y;
+
+    if (do_path || !surface)
+        return;
+
+    cairo_get_current_point(cr, &x, &y);
+    y += (gdouble) attr->logical_rect.y / PANGO_SCALE;
+
+    cairo_save(cr);
+    cairo_set_source_surface(cr, surface, x, y);
+    cairo_rectangle(cr, x, y, (gdouble) attr->logical_rect.width / PANGO_SCALE,
+        (gdouble) attr->logical_rect.height / PANGO_SCALE);
+    cairo_fill(cr);
+    cairo_restore(cr);
+}
+
+static void
+insert_attr(PangoAttrList* attrs, PangoAttribute* attr, guint start, guint end)
+{
+    attr->start_index = start;
+    attr->end_index = end;
+    pango_attr_list_insert(attrs, attr);
+}
+
+static void
+ensure_layout(GtChatView* self, ChatLine* line)
+{
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+    PangoAttrList* attrs;
+    gint scale;
+    gint height;
+
+    if (line->layout)
+        return;
+
+    scale = gtk_widget_get_scale_factor(GTK_WIDGET(self));
+
+    line->layout = pango_layout_new(gtk_widget_get_pango_context(GTK_WIDGET(self)));
+    line->unresolved = FALSE;
+
+    pango_layout_set_text(line->layout, line->text, -1);
+    pango_layout_set_width(line->layout, MAX(priv->layout_width - 2*LINE_MARGIN, 1)*PANGO_SCALE);
+    pango_layout_set_wrap(line->layout, PANGO_WRAP_WORD_CHAR);
+
+    attrs = pango_attr_list_new();
+
+    if (line->notice)
+    {
+        insert_attr(attrs, pango_attr_style_new(PANGO_STYLE_ITALIC), 0, G_MAXUINT);
+        insert_attr(attrs, pango_attr_foreground_new(0xbebe, 0xbebe, 0xbebe), 0, G_MAXUINT);
+    }
+    else
+    {
+        if (line->has_colour)
+        {
+            insert_attr(attrs, pango_attr_foreground_new(line->colour.red,
+                    line->colour.green, line->colour.blue),
+                line->sender_start, line->sender_end);
+        }
+
+        insert_attr(attrs, pango_attr_weight_new(PANGO_WEIGHT_BOLD),
+            line->sender_start, line->sender_end);
+    }
+
+    for (guint i = line->has_urls ? find_urls(priv, line) : priv->urls->len;
+         i < priv->urls->len && g_array_index(priv->urls, ChatUrl, i).serial == line->serial; i++)
+    {
+        ChatUrl* url = &g_array_index(priv->urls, ChatUrl, i);
+
+        insert_attr(attrs, pango_attr_foreground_new(0, 0, 0xffff), url->start, url->end);
+        insert_attr(attrs, pango_attr_underline_new(PANGO_UNDERLINE_SINGLE), url->start, url->end);
+    }
+
+    for (guint i = 0; line->images && i < line->images->len; i++)
+    {
+        ChatImage* image = &g_array_index(line->images, ChatImage, i);
+        cairo_surface_t* surface = NULL;
+        PangoRectangle rect;
+
+        if (!image->pixbuf)
+        {
+            image->pixbuf = image->badge ?
+                gt_twitch_resolve_badge(main_app->twitch, image->badge, scale) :
+                gt_twitch_resolve_emote(main_app->twitch, image->id, scale);
+        }
+
+        rect.x = 0;
+
+        if (image->pixbuf)
+        {
+            surface = image_surface(image->pixbuf, scale);
+            rect.width = gdk_pixbuf_get_width(image->pixbuf)*PANGO_SCALE/scale;
+            rect.height = gdk_pixbuf_get_height(image->pixbuf)*PANGO_SCALE/scale;
+        }
+        else
+        {
+            /* NOTE: Placeholders only take up space */
+            rect.width = rect.height = (image->badge ?
+                BADGE_PLACEHOLDER_SIZE : EMOTE_PLACEHOLDER_SIZE)*PANGO_SCALE;
+            line->unresolved = TRUE;
+        }
+
+        rect.y = -rect.height;
+
+        insert_attr(attrs, pango_attr_shape_new_with_data(&rect, &rect, surface,
+                (PangoAttrDataCopyFunc) cairo_surface_reference,
+                (GDestroyNotify) cairo_surface_destroy),
+            image->index, image->index + strlen(OBJECT_REPLACEMENT_CHAR));
+    }
+
+    pango_layout_set_attributes(line->layout, attrs);
+    pango_attr_list_unref(attrs);
+
+    pango_layout_get_pixel_size(line->layout, NULL, &height);
+
+    set_line_height(priv, line, height + 2*LINE_SPACING);
+}
+
+static void
+update_adjustment(GtChatView* self, gdouble value)
+{
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+    gint page = gtk_widget_get_allocated_height(GTK_WIDGET(self));
+    gdouble upper = MAX(priv->total_height, page);
+
+    gtk_adjustment_configure(priv->vadjustment, CLAMP(value, 0, upper - page),
+        0, upper, priv->estimate, page*0.9, page);
+}
+
+/* NOTE: Lays out the lines on screen and releases the layouts of
+ * those that went off screen. Laying out can change the heights of
+ * lines and with them the adjustment, so repeat until it settles */
+static void
+validate(GtChatView* self)
+{
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+    gint page = gtk_widget_get_allocated_height(GTK_WIDGET(self));
+    gdouble value;
+
+    /* NOTE: Style updates can come in before there's an adjustment */
+    if (priv->validating || !priv->vadjustment)
+        return;
+
+    priv->validating = TRUE;
+
+    do
+    {
+        GPtrArray* old = priv->visible;
+
+        value = gtk_adjustment_get_value(priv->vadjustment);
+
+        priv->visible = priv->spare;
+        priv->spare = old;
+        priv->generation++;
+
+        if (priv->len > 0 && priv->layout_width > 0)
+        {
+            gint64 top;
+            guint n = find_line(priv, value, &top);
+
+            for (gdouble y = top - value; n < priv->len && y < page; n++)
+            {
+                ChatLine* line = line_at(priv, n);
+
+                ensure_layout(self, line);
+
+                line->generation = priv->generation;
+                g_ptr_array_add(priv->visible, line);
+
+                y += line->height;
+            }
+        }
+
+        for (guint i = 0; i < old->len; i++)
+        {
+            ChatLine* line = old->pdata[i];
+
+            if (line->generation != priv->generation)
+                g_clear_object(&line->layout);
+        }
+
+        g_ptr_array_set_size(old, 0);
+
+        update_adjustment(self, value);
+    } while (gtk_adjustment_get_value(priv->vadjustment) != value);
+
+    priv->validating = FALSE;
+
+    gtk_widget_queue_draw(GTK_WIDGET(self));
+}
+
+static void
+vadjustment_value_changed_cb(GtkAdjustment* adjustment,
+    gpointer udata)
+{
+    validate(GT_CHAT_VIEW(udata));
+}
+
+static void
+set_vadjustment(GtChatView* self, GtkAdjustment* adjustment)
+{
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+
+    if (adjustment && adjustment == priv->vadjustment)
+        return;
+
+    if (priv->vadjustment)
+    {
+        g_signal_handlers_disconnect_by_func(priv->vadjustment, vadjustment_value_changed_cb, self);
+        g_object_unref(priv->vadjustment);
+    }
+
+    if (!adjustment)
+        adjustment = gtk_adjustment_new(0, 0, 0, 0, 0, 0);
+
+    priv->vadjustment = g_object_ref_sink(adjustment);
+
+    g_signal_connect(priv->vadjustment, "value-changed", G_CALLBACK(vadjustment_value_changed_cb), self);
+
+    update_adjustment(self, 0);
+
+    g_object_notify_by_pspec(G_OBJECT(self), props[PROP_VADJUSTMENT]);
+}
+
+static void
+set_hadjustment(GtChatView* self, GtkAdjustment* adjustment)
+{
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+
+    if (adjustment && adjustment == priv->hadjustment)
+        return;
+
+    g_clear_object(&priv->hadjustment);
+
+    if (!adjustment)
+        adjustment = gtk_adjustment_new(0, 0, 0, 0, 0, 0);
+
+    priv->hadjustment = g_object_ref_sink(adjustment);
+
+    /* NOTE: Lines are wrapped, there is nothing to scroll horizontally */
+    gtk_adjustment_configure(priv->hadjustment, 0, 0, 0, 0, 0, 0);
+
+    g_object_notify_by_pspec(G_OBJECT(self), props[PROP_HADJUSTMENT]);
+}
+
+static void
+set_scrollback(GtChatView* self, guint capacity)
+{
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+    guint keep = MIN(priv->len, capacity);
+    guint drop = priv->len - keep;
+    ChatLine* lines;
+
+    if (capacity == priv->capacity)
+        return;
+
+    release_layouts(self);
+
+    lines = g_new0(ChatLine, capacity);
+
+    if (drop > 0)
+        prune_urls(priv, line_at(priv, drop - 1)->serial);
+
+    for (guint i = 0; i < drop; i++)
+    {
+        unindex_line(priv, line_at(priv, i));
+        chat_line_clear(line_at(priv, i));
+    }
+
+    for (guint i = 0; i < keep; i++)
+        lines[i] = *line_at(priv, drop + i);
+
+    g_free(priv->lines);
+    g_free(priv->tree);
+
+    priv->lines = lines;
+    priv->tree = g_new0(gint, capacity + 1);
+    priv->capacity = capacity;
+    priv->head = 0;
+    priv->len = keep;
+    priv->total_height = 0;
+
+    /* NOTE: Build the tree in linear time, each node passes its sum on
+     * to its parent */
+    for (guint i = 1; i <= keep; i++)
+    {
+        guint parent = i + (i & -i);
+
+        priv->tree[i] += lines[i - 1].height;
+        priv->total_height += lines[i - 1].height;
+
+        if (parent <= capacity)
+            priv->tree[parent] += priv->tree[i];
+    }
+
+    if (priv->vadjustment)
+        validate(self);
+}
+
+static void
+scroll_to_bottom(GtChatView* self)
+{
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+    gint page = gtk_widget_get_allocated_height(GTK_WIDGET(self));
+    gint filled = 0;
+
+    if (priv->layout_width <= 0)
+        return;
+
+    /* NOTE: Lay out the last page first so the heights the bottom is
+     * worked out from aren't estimates */
+    for (guint n = priv->len; n > 0 && filled < page; n--)
+    {
+        ChatLine* line = line_at(priv, n - 1);
+
+        if (!line->layout)
+        {
+            ensure_layout(self, line);
+            g_ptr_array_add(priv->visible, line);
+        }
+
+        filled += line->height;
+    }
+
+    priv->validating = TRUE;
+    update_adjustment(self, priv->total_height - page);
+    priv->validating = FALSE;
+
+    validate(self);
+}
+
+/* NOTE: Centres line n. Laying out the page around it can change the
+ * heights of the lines above it, so centre it once more after that */
+static void
+scroll_to_line(GtChatView* self, guint n)
+{
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+    gint page = gtk_widget_get_allocated_height(GTK_WIDGET(self));
+    ChatLine* line = line_at(priv, n);
+
+    if (priv->layout_width <= 0)
+        return;
+
+    if (!line->layout)
+    {
+        ensure_layout(self, line);
+        g_ptr_array_add(priv->visible, line);
+    }
+
+    for (gint i = 0; i < 2; i++)
+    {
+        priv->validating = TRUE;
+        update_adjustment(self, line_offset(priv, n) - (page - line->height) / 2);
+        priv->validating = FALSE;
+
+        validate(self);
+    }
+}
+
+static gboolean
+commit_cb(GtkWidget* widget,
+    GdkFrameClock* clock, gpointer udata)
+{
+    GtChatView* self = GT_CHAT_VIEW(widget);
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+    gint64 start = g_get_monotonic_time();
+
+    priv->commit_tick = 0;
+
+    /* NOTE: Keeps what's on screen in place when lines were dropped
+     * from the top */
+    priv->validating = TRUE;
+    update_adjustment(self, gtk_adjustment_get_value(priv->vadjustment) - priv->staged_evicted);
+    priv->validating = FALSE;
+
+    if (priv->staged_scroll)
+        scroll_to_bottom(self);
+    else
+        validate(self);
+
+    priv->commits++;
+    priv->committed_lines += priv->staged_lines;
+    priv->commit_time += g_get_monotonic_time() - start;
+
+    if (priv->commits % COMMIT_STATS_INTERVAL == 0)
+    {
+        DEBUGF("Committed an average of '%.2f' lines per frame in '%.3f' ms",
+            (gdouble) priv->committed_lines / priv->commits,
+            (gdouble) priv->commit_time / priv->commits / 1000.0);
+    }
+
+    priv->staged_lines = 0;
+    priv->staged_evicted = 0;
+    priv->staged_scroll = FALSE;
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+schedule_commit(GtChatView* self)
+{
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+
+    if (priv->commit_tick == 0)
+        priv->commit_tick = gtk_widget_add_tick_callback(GTK_WIDGET(self), commit_cb, NULL, NULL);
+}
+
+/* NOTE: Returns a cleared line at the end of the ring, dropping the
+ * oldest line if it's full. The height of the dropped line is added
+ * to evicted */
+static ChatLine*
+push_line(GtChatView* self, gint* evicted)
+{
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+    ChatLine* line;
+
+    if (priv->len == priv->capacity)
+    {
+        line = line_at(priv, 0);
+
+        *evicted += line->height;
+
+        if (line->has_urls)
+            prune_urls(priv, line->serial);
+
+        unindex_line(priv, line);
+        set_line_height(priv, line, 0);
+        chat_line_clear(line);
+
+        priv->head = (priv->head + 1) % priv->capacity;
+        priv->len--;
+    }
+
+    line = line_at(priv, priv->len++);
+    line->serial = ++priv->serial;
+
+    set_line_height(priv, line, priv->estimate);
+
+    return line;
+}
+
+static void
+lines_added(GtChatView* self, gint evicted)
+{
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+
+    priv->staged_lines++;
+    priv->staged_evicted += evicted;
+
+    schedule_commit(self);
+}
+
+static void
+update_estimate(GtChatView* self)
+{
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+    g_autoptr(PangoLayout) layout = NULL;
+    gint height;
+
+    layout = pango_layout_new(gtk_widget_get_pango_context(GTK_WIDGET(self)));
+    pango_layout_set_text(layout, "X", -1);
+    pango_layout_get_pixel_size(layout, NULL, &height);
+
+    priv->estimate = MAX(height, BADGE_PLACEHOLDER_SIZE) + 2*LINE_SPACING;
+}
+
+static gint
+position_compare(const ChatPosition* a, const ChatPosition* b)
+{
+    if (a->serial != b->serial)
+        return a->serial < b->serial ? -1 : 1;
+
+    return (gint) a->index - (gint) b->index;
+}
+
+/* NOTE: Returns FALSE if there's no selection */
+static gboolean
+selection_bounds(GtChatViewPrivate* priv, ChatPosition* start, ChatPosition* end)
+{
+    gint cmp = position_compare(&priv->sel_anchor, &priv->sel_cursor);
+
+    if (cmp == 0)
+        return FALSE;
+
+    *start = cmp < 0 ? priv->sel_anchor : priv->sel_cursor;
+    *end = cmp < 0 ? priv->sel_cursor : priv->sel_anchor;
+
+    return TRUE;
+}
+
+/* NOTE: Below the last line is the end of it, returns FALSE if the
+ * line at y hasn't been laid out */
+static gboolean
+position_at(GtChatView* self, gdouble x, gdouble y, ChatPosition* pos)
+{
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+    gdouble value = gtk_adjustment_get_value(priv->vadjustment);
+    ChatLine* line;
+    gint64 top;
+    gint index, trailing;
+
+    if (priv->len == 0)
+        return FALSE;
+
+    if (value + y >= priv->total_height)
+    {
+        line = line_at(priv, priv->len - 1);
+        pos->serial = line->serial;
+        pos->index = strlen(line->text);
+
+        return TRUE;
+    }
+
+    line = line_at(priv, find_line(priv, value + y, &top));
+
+    if (!line->layout)
+        return FALSE;
+
+    pango_layout_xy_to_index(line->layout, (x - LINE_MARGIN)*PANGO_SCALE,
+        (value + y - top - LINE_SPACING)*PANGO_SCALE, &index, &trailing);
+
+    /* NOTE: Past the middle of a character takes it in */
+    for (; trailing > 0 && line->text[index]; trailing--)
+        index = g_utf8_next_char(line->text + index) - line->text;
+
+    pos->serial = line->serial;
+    pos->index = index;
+
+    return TRUE;
+}
+
+/* NOTE: Emotes are copied as the text they were typed as, badges are
+ * left out along with the space after them */
+static void
+append_line_text(GString* str, ChatLine* line, guint start, guint end)
+{
+    guint pos = start;
+
+    for (guint i = 0; line->images && i < line->images->len; i++)
+    {
+        ChatImage* image = &g_array_index(line->images, ChatImage, i);
+        guint image_end = image->index + strlen(OBJECT_REPLACEMENT_CHAR);
+
+        if (image->index < start || image->index >= end)
+            continue;
+
+        g_string_append_len(str, line->text + pos, image->index - pos);
+
+        if (image->code)
+            g_string_append(str, image->code);
+        else if (line->text[image_end] == ' ')
+            image_end++;
+
+        pos = MIN(image_end, end);
+    }
+
+    g_string_append_len(str, line->text + pos, end - pos);
+}
+
+/* NOTE: Returns NULL if there's no selection or its lines have all
+ * been dropped, the start is moved to the oldest line if it was */
+static gchar*
+selection_text(GtChatViewPrivate* priv)
+{
+    ChatPosition start, end;
+    GString* str;
+    guint64 first;
+
+    if (priv->len == 0 || !selection_bounds(priv, &start, &end))
+        return NULL;
+
+    first = line_at(priv, 0)->serial;
+
+    if (end.serial < first)
+        return NULL;
+
+    if (start.serial < first)
+    {
+        start.serial = first;
+        start.index = 0;
+    }
+
+    str = g_string_new(NULL);
+
+    for (guint64 serial = start.serial; serial <= end.serial; serial++)
+    {
+        ChatLine* line = line_at(priv, serial - first);
+
+        if (serial > start.serial)
+            g_string_append_c(str, '\n');
+
+        append_line_text(str, line,
+            serial == start.serial ? start.index : 0,
+            serial == end.serial ? end.index : strlen(line->text));
+    }
+
+    return g_string_free(str, FALSE);
+}
+
+static void
+copy_selection(GtChatView* self, GdkAtom selection)
+{
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+    g_autofree gchar* text = selection_text(priv);
+
+    if (text)
+        gtk_clipboard_set_text(gtk_widget_get_clipboard(GTK_WIDGET(self), selection), text, -1);
+}
+
+static void
+copy_activate_cb(GtkMenuItem* item, gpointer udata)
+{
+    copy_selection(GT_CHAT_VIEW(udata), GDK_SELECTION_CLIPBOARD);
+}
+
+static void
+show_menu(GtChatView* self, GdkEvent* evt)
+{
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+    ChatPosition start, end;
+
+    if (!priv->menu)
+    {
+        priv->menu = gtk_menu_new();
+        priv->copy_item = gtk_menu_item_new_with_mnemonic(_("_Copy"));
+
+        g_signal_connect(priv->copy_item, "activate", G_CALLBACK(copy_activate_cb), self);
+
+        gtk_menu_shell_append(GTK_MENU_SHELL(priv->menu), priv->copy_item);
+        gtk_widget_show(priv->copy_item);
+
+        /* NOTE: Destroyed along with the view */
+        gtk_menu_attach_to_widget(GTK_MENU(priv->menu), GTK_WIDGET(self), NULL);
+    }
+
+    gtk_widget_set_sensitive(priv->copy_item, selection_bounds(priv, &start, &end));
+
+#if GTK_CHECK_VERSION(3, 22, 0)
+    gtk_menu_popup_at_pointer(GTK_MENU(priv->menu), evt);
+#else
+    gtk_menu_popup(GTK_MENU(priv->menu), NULL, NULL, NULL, NULL,
+        evt ? evt->button.button : 0, gtk_get_current_event_time());
+#endif
+}
+
+static void
+realize(GtkWidget* widget)
+{
+    GtkAllocation alloc;
+    GdkWindowAttr attrs = {0};
+    GdkWindow* window;
+
+    gtk_widget_set_realized(widget, TRUE);
+    gtk_widget_get_allocation(widget, &alloc);
+
+    attrs.window_type = GDK_WINDOW_CHILD;
+    attrs.x = alloc.x;
+    attrs.y = alloc.y;
+    attrs.width = alloc.width;
+    attrs.height = alloc.height;
+    attrs.wclass = GDK_INPUT_OUTPUT;
+    attrs.visual = gtk_widget_get_visual(widget);
+    attrs.event_mask = gtk_widget_get_events(widget) | GDK_EXPOSURE_MASK |
+        GDK_BUTTON_PRESS_MASK | GDK_BUTTON_RELEASE_MASK | GDK_POINTER_MOTION_MASK |
+        GDK_SCROLL_MASK | GDK_SMOOTH_SCROLL_MASK | GDK_LEAVE_NOTIFY_MASK;
+
+    window = gdk_window_new(gtk_widget_get_parent_window(widget), &attrs,
+        GDK_WA_X | GDK_WA_Y | GDK_WA_VISUAL);
+
+    gtk_widget_register_window(widget, window);
+    gtk_widget_set_window(widget, window);
+}
+
+static void
+size_allocate(GtkWidget* widget, GtkAllocation* alloc)
+{
+    GtChatView* self = GT_CHAT_VIEW(widget);
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+    gboolean at_bottom;
+
+    at_bottom = gtk_adjustment_get_value(priv->vadjustment) >=
+        gtk_adjustment_get_upper(priv->vadjustment) - gtk_adjustment_get_page_size(priv->vadjustment);
+
+    gtk_widget_set_allocation(widget, alloc);
+
+    if (gtk_widget_get_realized(widget))
+    {
+        gdk_window_move_resize(gtk_widget_get_window(widget),
+            alloc->x, alloc->y, alloc->width, alloc->height);
+    }
+
+    if (alloc->width != priv->layout_width)
+    {
+        priv->layout_width = alloc->width;
+        release_layouts(self);
+    }
+
+    if (at_bottom)
+        scroll_to_bottom(self);
+    else
+        validate(self);
+}
+
+static void
+get_preferred_width(GtkWidget* widget, gint* min, gint* nat)
+{
+    *min = *nat = 2*LINE_MARGIN;
+}
+
+static void
+get_preferred_height(GtkWidget* widget, gint* min, gint* nat)
+{
+    *min = *nat = 0;
+}
+
+static gboolean
+draw(GtkWidget* widget, cairo_t* cr)
+{
+    GtChatView* self = GT_CHAT_VIEW(widget);
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+    GtkStyleContext* ctx = gtk_widget_get_style_context(widget);
+    gint width = gtk_widget_get_allocated_width(widget);
+    gint height = gtk_widget_get_allocated_height(widget);
+    ChatPosition start, end;
+    gboolean has_selection;
+    GdkRGBA fg;
+    gdouble value;
+    gint64 top;
+    guint n;
+
+    gtk_render_background(ctx, cr, 0, 0, width, height);
+
+    if (priv->len == 0)
+        return GDK_EVENT_PROPAGATE;
+
+    has_selection = selection_bounds(priv, &start, &end);
+
+    gtk_style_context_get_color(ctx, gtk_style_context_get_state(ctx), &fg);
+
+    value = gtk_adjustment_get_value(priv->vadjustment);
+    n = find_line(priv, value, &top);
+
+    for (gdouble y = top - value; n < priv->len && y < height; n++)
+    {
+        ChatLine* line = line_at(priv, n);
+
+        if (line->serial == priv->match_serial)
+        {
+            gtk_style_context_save(ctx);
+            gtk_style_context_add_class(ctx, SEARCH_MATCH_CSS_CLASS);
+            gtk_render_background(ctx, cr, 0, y, width, line->height);
+            gtk_style_context_restore(ctx);
+        }
+
+        if (has_selection && line->layout &&
+            line->serial >= start.serial && line->serial <= end.serial)
+        {
+            gint range[2] = {line->serial == start.serial ? start.index : 0,
+                             line->serial == end.serial ? end.index : strlen(line->text)};
+            cairo_region_t* region = gdk_pango_layout_get_clip_region(line->layout,
+                LINE_MARGIN, (gint) y + LINE_SPACING, range, 1);
+
+            cairo_save(cr);
+            gdk_cairo_region(cr, region);
+            cairo_clip(cr);
+            gtk_style_context_save(ctx);
+            gtk_style_context_add_class(ctx, SELECTION_CSS_CLASS);
+            gtk_render_background(ctx, cr, 0, y, width, line->height);
+            gtk_style_context_restore(ctx);
+            cairo_restore(cr);
+            cairo_region_destroy(region);
+        }
+
+        if (line->layout)
+        {
+            gdk_cairo_set_source_rgba(cr, &fg);
+            cairo_move_to(cr, LINE_MARGIN, y + LINE_SPACING);
+            pango_cairo_show_layout(cr, line->layout);
+        }
+
+        y += line->height;
+    }
+
+    return GDK_EVENT_PROPAGATE;
+}
+
+static gboolean
+button_press_event(GtkWidget* widget, GdkEventButton* evt)
+{
+    GtChatView* self = GT_CHAT_VIEW(widget);
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+
+    if (evt->type != GDK_BUTTON_PRESS)
+        return GDK_EVENT_PROPAGATE;
+
+    if (gdk_event_triggers_context_menu((GdkEvent*) evt))
+    {
+        show_menu(self, (GdkEvent*) evt);
+
+        return GDK_EVENT_STOP;
+    }
+
+    if (evt->button != GDK_BUTTON_PRIMARY)
+        return GDK_EVENT_PROPAGATE;
+
+    gtk_widget_grab_focus(widget);
+
+    if (position_at(self, evt->x, evt->y, &priv->sel_anchor))
+    {
+        priv->sel_cursor = priv->sel_anchor;
+        priv->selecting = TRUE;
+
+        gtk_widget_queue_draw(widget);
+    }
+
+    return GDK_EVENT_STOP;
+}
+
+static gboolean
+motion_notify_event(GtkWidget* widget, GdkEventMotion* evt)
+{
+    GtChatView* self = GT_CHAT_VIEW(widget);
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+
+    if (priv->selecting && position_at(self, evt->x, evt->y, &priv->sel_cursor))
+        gtk_widget_queue_draw(widget);
+
+    return GDK_EVENT_PROPAGATE;
+}
+
+/* NOTE: Finished selections are offered as the primary selection like
+ * any other text widget */
+static gboolean
+button_release_event(GtkWidget* widget, GdkEventButton* evt)
+{
+    GtChatView* self = GT_CHAT_VIEW(widget);
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+
+    if (evt->button != GDK_BUTTON_PRIMARY || !priv->selecting)
+        return GDK_EVENT_PROPAGATE;
+
+    priv->selecting = FALSE;
+
+    copy_selection(self, GDK_SELECTION_PRIMARY);
+
+    return GDK_EVENT_STOP;
+}
+
+static gboolean
+key_press_event(GtkWidget* widget, GdkEventKey* evt)
+{
+    if ((evt->state & GDK_CONTROL_MASK) &&
+        (evt->keyval == GDK_KEY_c || evt->keyval == GDK_KEY_Insert))
+    {
+        copy_selection(GT_CHAT_VIEW(widget), GDK_SELECTION_CLIPBOARD);
+
+        return GDK_EVENT_STOP;
+    }
+
+    return GTK_WIDGET_CLASS(gt_chat_view_parent_class)->key_press_event(widget, evt);
+}
+
+static gboolean
+popup_menu(GtkWidget* widget)
+{
+    show_menu(GT_CHAT_VIEW(widget), NULL);
+
+    return TRUE;
+}
+
+static void
+style_updated(GtkWidget* widget)
+{
+    GtChatView* self = GT_CHAT_VIEW(widget);
+
+    GTK_WIDGET_CLASS(gt_chat_view_parent_class)->style_updated(widget);
+
+    update_estimate(self);
+    release_layouts(self);
+    validate(self);
+}
+
+/* NOTE: Images are resolved at the scale factor, so moving to a
+ * screen with another one fetches them again at the new scale */
+static void
+scale_factor_cb(GObject* obj, GParamSpec* pspec, gpointer udata)
+{
+    GtChatView* self = GT_CHAT_VIEW(obj);
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+
+    for (guint i = 0; i < priv->len; i++)
+    {
+        ChatLine* line = line_at(priv, i);
+
+        for (guint j = 0; line->images && j < line->images->len; j++)
+            g_clear_object(&g_array_index(line->images, ChatImage, j).pixbuf);
+    }
+
+    release_layouts(self);
+    validate(self);
+}
+
+static void
+dispose(GObject* obj)
+{
+    GtChatView* self = GT_CHAT_VIEW(obj);
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+
+    if (priv->commit_tick > 0)
+    {
+        gtk_widget_remove_tick_callback(GTK_WIDGET(self), priv->commit_tick);
+        priv->commit_tick = 0;
+    }
+
+    if (priv->vadjustment)
+        g_signal_handlers_disconnect_by_func(priv->vadjustment, vadjustment_value_changed_cb, self);
+
+    g_clear_object(&priv->vadjustment);
+    g_clear_object(&priv->hadjustment);
+
+    G_OBJECT_CLASS(gt_chat_view_parent_class)->dispose(obj);
+}
+
+static void
+finalise(GObject* obj)
+{
+    GtChatView* self = GT_CHAT_VIEW(obj);
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+
+    for (guint i = 0; i < priv->len; i++)
+        chat_line_clear(line_at(priv, i));
+
+    prune_urls(priv, G_MAXUINT64);
+
+    g_free(priv->lines);
+    g_free(priv->tree);
+    g_ptr_array_free(priv->visible, TRUE);
+    g_ptr_array_free(priv->spare, TRUE);
+    g_array_free(priv->urls, TRUE);
+    g_hash_table_destroy(priv->index);
+    g_ptr_array_free(priv->line_postings, TRUE);
+    g_string_free(priv->token, TRUE);
+    g_clear_pointer(&priv->search_tokens, g_ptr_array_unref);
+    g_hash_table_destroy(priv->colour_table);
+    g_queue_free_full(priv->colour_lru, (GDestroyNotify) chat_colour_free);
+    g_string_free(priv->scratch, TRUE);
+
+    G_OBJECT_CLASS(gt_chat_view_parent_class)->finalize(obj);
+}
+
+static void
+get_property(GObject* obj,
+             guint prop,
+             GValue* val,
+             GParamSpec* pspec)
+{
+    GtChatView* self = GT_CHAT_VIEW(obj);
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+
+    switch (prop)
+    {
+        case PROP_SCROLLBACK:
+            g_value_set_int(val, priv->capacity);
+            break;
+        case PROP_HADJUSTMENT:
+            g_value_set_object(val, priv->hadjustment);
+            break;
+        case PROP_VADJUSTMENT:
+            g_value_set_object(val, priv->vadjustment);
+            break;
+        case PROP_HSCROLL_POLICY:
+            g_value_set_enum(val, priv->hscroll_policy);
+            break;
+        case PROP_VSCROLL_POLICY:
+            g_value_set_enum(val, priv->vscroll_policy);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop, pspec);
+    }
+}
+
+static void
+set_property(GObject* obj,
+             guint prop,
+             const GValue* val,
+             GParamSpec* pspec)
+{
+    GtChatView* self = GT_CHAT_VIEW(obj);
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+
+    switch (prop)
+    {
+        case PROP_SCROLLBACK:
+            set_scrollback(self, g_value_get_int(val));
+            break;
+        case PROP_HADJUSTMENT:
+            set_hadjustment(self, g_value_get_object(val));
+            break;
+        case PROP_VADJUSTMENT:
+            set_vadjustment(self, g_value_get_object(val));
+            break;
+        case PROP_HSCROLL_POLICY:
+            priv->hscroll_policy = g_value_get_enum(val);
+            break;
+        case PROP_VSCROLL_POLICY:
+            priv->vscroll_policy = g_value_get_enum(val);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop, pspec);
+    }
+}
+
+static void
+gt_chat_view_class_init(GtChatViewClass* klass)
+{
+    GObjectClass* obj_class = G_OBJECT_CLASS(klass);
+    GtkWidgetClass* widget_class = GTK_WIDGET_CLASS(klass);
+
+    obj_class->dispose = dispose;
+    obj_class->finalize = finalise;
+    obj_class->get_property = get_property;
+    obj_class->set_property = set_property;
+
+    widget_class->realize = realize;
+    widget_class->size_allocate = size_allocate;
+    widget_class->get_preferred_width = get_preferred_width;
+    widget_class->get_preferred_height = get_preferred_height;
+    widget_class->draw = draw;
+    widget_class->style_updated = style_updated;
+    widget_class->button_press_event = button_press_event;
+    widget_class->button_release_event = button_release_event;
+    widget_class->motion_notify_event = motion_notify_event;
+    widget_class->key_press_event = key_press_event;
+    widget_class->popup_menu = popup_menu;
+
+    props[PROP_SCROLLBACK] = g_param_spec_int("scrollback", "Scrollback",
+        "Number of chat lines to keep, the oldest are dropped first",
+        MIN_SCROLLBACK, MAX_SCROLLBACK, DEFAULT_SCROLLBACK, G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+
+    g_object_class_install_property(obj_class, PROP_SCROLLBACK, props[PROP_SCROLLBACK]);
+
+    g_object_class_override_property(obj_class, PROP_HADJUSTMENT, "hadjustment");
+    g_object_class_override_property(obj_class, PROP_VADJUSTMENT, "vadjustment");
+    g_object_class_override_property(obj_class, PROP_HSCROLL_POLICY, "hscroll-policy");
+    g_object_class_override_property(obj_class, PROP_VSCROLL_POLICY, "vscroll-policy");
+
+    props[PROP_HADJUSTMENT] = g_object_class_find_property(obj_class, "hadjustment");
+    props[PROP_VADJUSTMENT] = g_object_class_find_property(obj_class, "vadjustment");
+
+    gtk_widget_class_set_css_name(widget_class, "chatview");
+}
+
+static void
+gt_chat_view_init(GtChatView* self)
+{
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+
+    gtk_widget_set_has_window(GTK_WIDGET(self), TRUE);
+    gtk_widget_set_can_focus(GTK_WIDGET(self), TRUE);
+
+    priv->visible = g_ptr_array_new();
+    priv->spare = g_ptr_array_new();
+    priv->urls = g_array_new(FALSE, FALSE, sizeof(ChatUrl));
+    priv->index = g_hash_table_new_full(g_str_hash, g_str_equal,
+        NULL, (GDestroyNotify) chat_posting_free);
+    priv->line_postings = g_ptr_array_new();
+    priv->token = g_string_new(NULL);
+    priv->colour_table = g_hash_table_new(g_str_hash, g_str_equal);
+    priv->colour_lru = g_queue_new();
+    priv->scratch = g_string_new(NULL);
+
+    g_signal_connect(self, "notify::scale-factor", G_CALLBACK(scale_factor_cb), NULL);
+
+    /* NOTE: Layouts are made from the widget's own context so that
+     * they follow font changes and draw their images through this */
+    pango_cairo_context_set_shape_renderer(gtk_widget_get_pango_context(GTK_WIDGET(self)),
+        (PangoCairoShapeRendererFunc) shape_renderer, NULL, NULL);
+
+    update_estimate(self);
+    set_vadjustment(self, NULL);
+    set_hadjustment(self, NULL);
+}
+
+GtChatView*
+gt_chat_view_new()
+{
+    return g_object_new(GT_TYPE_CHAT_VIEW, NULL);
+}
+
+/* NOTE: The nick and user id aren't shown but are indexed so messages
+ * can be searched for by them, either can be NULL */
+void
+gt_chat_view_append_message(GtChatView* self, const gchar* sender,
+    const gchar* nick, const gchar* user_id,
+    const gchar* colour, GList* badges, GArray* runs)
+{
+    g_assert(GT_IS_CHAT_VIEW(self));
+    g_assert_nonnull(sender);
+    g_assert_nonnull(runs);
+
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+    GString* text = priv->scratch;
+    gint evicted = 0;
+    ChatLine* line;
+
+    line = push_line(self, &evicted);
+
+    g_string_truncate(text, 0);
+
+    for (GList* l = badges; l != NULL; l = l->next)
+    {
+        ChatImage image = {text->len, 0, l->data, NULL, NULL};
+
+        if (!line->images)
+            line->images = g_array_new(FALSE, FALSE, sizeof(ChatImage));
+
+        g_array_append_val(line->images, image);
+        g_string_append(text, OBJECT_REPLACEMENT_CHAR " ");
+    }
+
+    line->sender_start = text->len;
+    g_string_append(text, sender);
+    line->sender_end = text->len;
+    g_string_append(text, ": ");
+
+    if (colour)
+        line->has_colour = lookup_colour(priv, colour, &line->colour);
+
+    for (guint i = 0; i < runs->len; i++)
+    {
+        GtChatRun* run = &g_array_index(runs, GtChatRun, i);
+
+        switch (run->type)
+        {
+            case GT_CHAT_RUN_TEXT:
+                g_string_append_len(text, run->text, run->len);
+                break;
+            case GT_CHAT_RUN_URL:
+            {
+                ChatUrl url = {line->serial, text->len, text->len + run->len,
+                               g_strndup(run->url, run->url_len)};
+
+                g_array_append_val(priv->urls, url);
+                line->has_urls = TRUE;
+                g_string_append_len(text, run->text, run->len);
+                break;
+            }
+            case GT_CHAT_RUN_EMOTE:
+            {
+                ChatImage image = {text->len, run->emote->id, NULL, NULL,
+                                   g_strndup(run->text, run->len)};
+
+                if (!line->images)
+                    line->images = g_array_new(FALSE, FALSE, sizeof(ChatImage));
+
+                g_array_append_val(line->images, image);
+                g_string_append(text, OBJECT_REPLACEMENT_CHAR);
+                break;
+            }
+        }
+    }
+
+    line->text = g_strndup(text->str, text->len);
+
+    index_line(priv, line, nick, user_id);
+
+    lines_added(self, evicted);
+}
+
+void
+gt_chat_view_append_notice(GtChatView* self, const gchar* text)
+{
+    g_assert(GT_IS_CHAT_VIEW(self));
+    g_assert_nonnull(text);
+
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+    gint evicted = 0;
+    ChatLine* line;
+
+    line = push_line(self, &evicted);
+    line->text = g_strdup(text);
+    line->notice = TRUE;
+
+    index_line(priv, line, NULL, NULL);
+
+    lines_added(self, evicted);
+}
+
+void
+gt_chat_view_clear(GtChatView* self)
+{
+    g_assert(GT_IS_CHAT_VIEW(self));
+
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+
+    release_layouts(self);
+
+    for (guint i = 0; i < priv->len; i++)
+        chat_line_clear(line_at(priv, i));
+
+    prune_urls(priv, G_MAXUINT64);
+    g_hash_table_remove_all(priv->index);
+    priv->match_serial = 0;
+    priv->selecting = FALSE;
+    memset(&priv->sel_anchor, 0, sizeof(ChatPosition));
+    memset(&priv->sel_cursor, 0, sizeof(ChatPosition));
+
+    memset(priv->tree, 0, (priv->capacity + 1)*sizeof(gint));
+
+    priv->head = 0;
+    priv->len = 0;
+    priv->total_height = 0;
+    priv->staged_evicted = 0;
+
+    priv->validating = TRUE;
+    update_adjustment(self, 0);
+    priv->validating = FALSE;
+
+    gtk_widget_queue_draw(GTK_WIDGET(self));
+}
+
+/* NOTE: Scrolls to the last line once the lines appended so far are
+ * committed on the next frame */
+void
+gt_chat_view_scroll_to_bottom(GtChatView* self)
+{
+    g_assert(GT_IS_CHAT_VIEW(self));
+
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+
+    priv->staged_scroll = TRUE;
+
+    schedule_commit(self);
+}
+
+/* NOTE: Lays the lines that are showing placeholders out again so
+ * they pick up images that have been fetched since */
+void
+gt_chat_view_images_changed(GtChatView* self)
+{
+    g_assert(GT_IS_CHAT_VIEW(self));
+
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+    gboolean changed = FALSE;
+
+    for (guint i = 0; i < priv->visible->len; i++)
+    {
+        ChatLine* line = priv->visible->pdata[i];
+
+        if (line->layout && line->unresolved)
+        {
+            g_clear_object(&line->layout);
+            changed = TRUE;
+        }
+    }
+
+    if (changed)
+        validate(self);
+}
+
+const gchar*
+gt_chat_view_get_url_at(GtChatView* self, gdouble x, gdouble y)
+{
+    g_assert(GT_IS_CHAT_VIEW(self));
+
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+    gdouble value = gtk_adjustment_get_value(priv->vadjustment);
+    ChatLine* line;
+    gint64 top;
+    gint index, trailing;
+
+    if (priv->len == 0)
+        return NULL;
+
+    line = line_at(priv, find_line(priv, value + y, &top));
+
+    if (!line->layout || !line->has_urls)
+        return NULL;
+
+    if (!pango_layout_xy_to_index(line->layout, (x - LINE_MARGIN)*PANGO_SCALE,
+            (value + y - top - LINE_SPACING)*PANGO_SCALE, &index, &trailing))
+    {
+        return NULL;
+    }
+
+    for (guint i = find_urls(priv, line);
+         i < priv->urls->len && g_array_index(priv->urls, ChatUrl, i).serial == line->serial; i++)
+    {
+        ChatUrl* url = &g_array_index(priv->urls, ChatUrl, i);
+
+        if ((guint) index >= url->start && (guint) index < url->end)
+            return url->url;
+    }
+
+    return NULL;
+}
+
+guint
+gt_chat_view_get_line_count(GtChatView* self)
+{
+    g_assert(GT_IS_CHAT_VIEW(self));
+
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+
+    return priv->len;
+}
+
+/* NOTE: Lines match when they contain every word of the query, an
+ * empty query clears the search */
+void
+gt_chat_view_set_search(GtChatView* self, const gchar* query)
+{
+    g_assert(GT_IS_CHAT_VIEW(self));
+
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+
+    g_clear_pointer(&priv->search_tokens, g_ptr_array_unref);
+    priv->match_serial = 0;
+
+    if (!utils_str_empty(query))
+    {
+        priv->search_tokens = g_ptr_array_new_with_free_func(g_free);
+
+        foreach_token(query, (TokenFunc) add_search_token_cb, priv->search_tokens);
+
+        if (priv->search_tokens->len == 0)
+            g_clear_pointer(&priv->search_tokens, g_ptr_array_unref);
+    }
+
+    gtk_widget_queue_draw(GTK_WIDGET(self));
+}
+
+/* NOTE: Moves to the closest match older or newer than the current
+ * one, starting from the bottom if there is none. The candidates are
+ * taken from the shortest postings and looked up in the others.
+ * Returns FALSE and stays on the current match if there are no more */
+gboolean
+gt_chat_view_find(GtChatView* self, gboolean older)
+{
+    g_assert(GT_IS_CHAT_VIEW(self));
+
+    GtChatViewPrivate* priv = gt_chat_view_get_instance_private(self);
+    g_autoptr(GPtrArray) postings = NULL;
+    gint64 start = g_get_monotonic_time();
+    ChatPosting* shortest;
+    guint64 found = 0;
+    guint64 from;
+
+    if (!priv->search_tokens)
+        return FALSE;
+
+    postings = g_ptr_array_sized_new(priv->search_tokens->len);
+
+    for (guint i = 0; i < priv->search_tokens->len; i++)
+    {
+        ChatPosting* posting = g_hash_table_lookup(priv->index, priv->search_tokens->pdata[i]);
+
+        if (!posting)
+            return FALSE;
+
+        g_ptr_array_add(postings, posting);
+    }
+
+    g_ptr_array_sort(postings, (GCompareFunc) posting_compare);
+
+    shortest = postings->pdata[0];
+
+    if (older)
+    {
+        from = priv->match_serial > 0 ? priv->match_serial : G_MAXUINT64;
+
+        for (guint i = posting_find(shortest, from); i > shortest->head && !found; i--)
+        {
+            guint64 serial = g_array_index(shortest->serials, guint64, i - 1);
+            guint j;
+
+            for (j = 1; j < postings->len && posting_contains(postings->pdata[j], serial); j++);
+
+            if (j == postings->len)
+                found = serial;
+        }
+    }
+    else
+    {
+        from = priv->match_serial + 1;
+
+        for (guint i = posting_find(shortest, from); i < shortest->serials->len && !found; i++)
+        {
+            guint64 serial = g_array_index(shortest->serials, guint64, i);
+            guint j;
+
+            for (j = 1; j < postings->len && posting_contains(postings->pdata[j], serial); j++);
+
+            if (j == postings->len)
+                found = serial;
+        }
+    }
+
+    DEBUGF("Searched '%u' lines in '%.3f' ms", priv->len,
+        (gdouble) (g_get_monotonic_time() - start) / 1000.0);
+
+    if (!found)
+        return FALSE;
+
+    priv->match_serial = found;
+
+    scroll_to_line(self, found - line_at(priv, 0)->serial);
+
+    gtk_widget_queue_draw(GTK_WIDGET(self));
+
+    return TRUE;
+}
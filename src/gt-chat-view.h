@@ -0,0 +1,49 @@
+/*
+ *  This file is part of GNOME Twitch - 'Enjoy Twitch on your GNU/Linux desktop'
+ *  Copyright © 2017 Vincent Szolnoky <vinszent@vinszent.com>
+ *
+ *  GNOME Twitch is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GNOME Twitch is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNOME Twitch. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GT_CHAT_VIEW_H
+#define GT_CHAT_VIEW_H
+
+#include <gtk/gtk.h>
+#include "gt-chat.h"
+
+G_BEGIN_DECLS
+
+#define GT_TYPE_CHAT_VIEW gt_chat_view_get_type()
+
+G_DECLARE_FINAL_TYPE(GtChatView, gt_chat_view, GT, CHAT_VIEW, GtkWidget)
+
+struct _GtChatView
+{
+    GtkWidget parent_instance;
+};
+
+GtChatView*     gt_chat_view_new();
+void            gt_chat_view_append_message(GtChatView* self, const gchar* sender, const gchar* nick, const gchar* user_id, const gchar* colour, GList* badges, GArray* runs);
+void            gt_chat_view_append_notice(GtChatView* self, const gchar* text);
+void            gt_chat_view_clear(GtChatView* self);
+void            gt_chat_view_scroll_to_bottom(GtChatView* self);
+void            gt_chat_view_images_changed(GtChatView* self);
+const gchar*    gt_chat_view_get_url_at(GtChatView* self, gdouble x, gdouble y);
+guint           gt_chat_view_get_line_count(GtChatView* self);
+void            gt_chat_view_set_search(GtChatView* self, const gchar* query);
+gboolean        gt_chat_view_find(GtChatView* self, gboolean older);
+
+G_END_DECLS
+
+#endif
@@ -17,6 +17,8 @@
  */
 
 #include "gt-chat.h"
+#include "gt-chat-view.h"
+#include "gt-chat-log.h"
 #include "gt-irc.h"
 #include "gt-app.h"
 #include "gt-win.h"
@@ -37,8 +39,9 @@
 #define CHAT_DARK_THEME_CSS ".gt-chat { background-color: rgba(25, 25, 31, %.2f); }"
 #define CHAT_LIGHT_THEME_CSS ".gt-chat { background-color: rgba(242, 242, 242, %.2f); }"
 
-#define MAX_SCROLLBACK 1000 //TODO: Make this a setting
-#define SAVEUP_AMOUNT 100
+#define USER_CACHE_SIZE 4096
+#define PICKER_CHUNK_SIZE 50
+#define PICKER_EMOTE_SIZE 28
 
 const char* default_chat_colours[] =
 {
@@ -55,6 +58,19 @@ static gchar* emote_replacement_codes[] =
     ":-/", ";-)", ":-P", ";-P", "R-)",
 };
 
+/* NOTE: How a chatter is shown, made from the tags of their last
+ * message and made again when those change */
+typedef struct
+{
+    gchar* key;
+    gchar* display_name;
+    gchar* colour_tag;
+    gchar* badges_tag;
+    gchar* sender;
+    const gchar* colour;
+    GList* badges;
+} ChatUser;
+
 typedef struct
 {
     gboolean dark_theme;
@@ -64,20 +80,25 @@ typedef struct
     GtkWidget* emote_popover;
     GtkWidget* emote_flow;
 
+    /* NOTE: The emote picker is filled a chunk at a time from an idle
+     * and the images are only resolved once they are drawn. Pending
+     * images are keyed by emote id */
+    gchar* emote_sets;
+    GList* picker_emotes;
+    GList* picker_next;
+    guint picker_source;
+    GHashTable* picker_pending;
+
     GtkWidget* error_label;
     GtkWidget* chat_view;
     GtkWidget* chat_scroll;
     GtkWidget* chat_scroll_vbar;
     GtkWidget* chat_entry;
-    GtkTextBuffer* chat_buffer;
-    GtkAdjustment* chat_adjustment;
-    GtkTextTagTable* tag_table;
+    GtkWidget* search_bar;
+    GtkWidget* search_entry;
     GtkWidget* main_stack;
     GtkWidget* connecting_revealer;
 
-    GtkTextMark* bottom_mark;
-    GtkTextIter bottom_iter;
-
     GtkCssProvider* chat_css_provider;
 
     GtIrc* irc;
@@ -89,6 +110,19 @@ typedef struct
 
     GRegex* url_regex;
 
+    /* NOTE: Keyed by user id, or nick if there is none, with the most
+     * recent chatters first in the queue */
+    GHashTable* user_table;
+    GQueue* user_lru;
+
+    /* NOTE: Reused for every message so splitting doesn't allocate */
+    GArray* runs;
+
+    /* NOTE: Timestamp of the last message loaded from the log, history
+     * replayed by GtIrc up to it is already shown */
+    GtChatLog* log;
+    gint64 log_loaded_until;
+
     GMutex mutex;
 
 } GtChatPrivate;
@@ -117,6 +151,123 @@ get_default_chat_colour(const gchar* name)
     return default_chat_colours[total % 13];
 }
 
+static void
+chat_user_clear(ChatUser* user)
+{
+    g_free(user->display_name);
+    g_free(user->colour_tag);
+    g_free(user->badges_tag);
+    g_free(user->sender);
+    g_list_free(user->badges);
+}
+
+static void
+chat_user_free(ChatUser* user)
+{
+    chat_user_clear(user);
+    g_free(user->key);
+    g_free(user);
+}
+
+static void
+clear_users(GtChat* self)
+{
+    GtChatPrivate* priv = gt_chat_get_instance_private(self);
+
+    g_hash_table_remove_all(priv->user_table);
+    g_queue_free_full(priv->user_lru, (GDestroyNotify) chat_user_free);
+    priv->user_lru = g_queue_new();
+}
+
+//FIXME: Ideally the display name should be bold and the nick name should be normal,
+//will do this later
+static gchar*
+format_sender(const gchar* display_name, const gchar* nick)
+{
+    if (utils_str_empty(display_name))
+        return g_strdup(nick);
+
+    g_assert(g_utf8_validate(display_name, -1, NULL));
+
+    for (const gchar* c = display_name; *c; c = g_utf8_next_char(c))
+    {
+        switch (g_unichar_get_script(g_utf8_get_char(c)))
+        {
+            case G_UNICODE_SCRIPT_HIRAGANA:
+            case G_UNICODE_SCRIPT_KATAKANA:
+            case G_UNICODE_SCRIPT_HANGUL:
+            case G_UNICODE_SCRIPT_HAN:
+                return g_strdup_printf("%s (%s)", display_name, nick);
+            default:
+                break;
+        }
+    }
+
+    return g_strdup(display_name);
+}
+
+static ChatUser*
+lookup_user(GtChat* self, GtIrcMessage* msg)
+{
+    GtChatPrivate* priv = gt_chat_get_instance_private(self);
+    GtIrcCommandPrivmsg* privmsg = msg->cmd.privmsg;
+    const gchar* badges_tag = gt_irc_message_get_tag(msg, GT_IRC_TAG_BADGES);
+    const gchar* key = gt_irc_message_get_tag(msg, GT_IRC_TAG_USER_ID);
+    GList* link;
+    ChatUser* user;
+
+    if (utils_str_empty(key))
+        key = msg->nick;
+
+    link = g_hash_table_lookup(priv->user_table, key);
+
+    if (link)
+    {
+        user = link->data;
+
+        g_queue_unlink(priv->user_lru, link);
+        g_queue_push_head_link(priv->user_lru, link);
+
+        /* NOTE: A badge set that was loaded after the user was cached
+         * shows up as a badge the list didn't have before */
+        if (g_strcmp0(user->display_name, privmsg->display_name) == 0 &&
+            g_strcmp0(user->colour_tag, privmsg->colour) == 0 &&
+            g_strcmp0(user->badges_tag, badges_tag) == 0 &&
+            g_list_length(user->badges) == g_list_length(privmsg->badges))
+        {
+            return user;
+        }
+
+        chat_user_clear(user);
+    }
+    else
+    {
+        if (g_queue_get_length(priv->user_lru) >= USER_CACHE_SIZE)
+        {
+            user = g_queue_pop_tail(priv->user_lru);
+
+            g_hash_table_remove(priv->user_table, user->key);
+            chat_user_free(user);
+        }
+
+        user = g_new0(ChatUser, 1);
+        user->key = g_strdup(key);
+
+        g_queue_push_head(priv->user_lru, user);
+        g_hash_table_insert(priv->user_table, user->key, priv->user_lru->head);
+    }
+
+    user->display_name = g_strdup(privmsg->display_name);
+    user->colour_tag = g_strdup(privmsg->colour);
+    user->badges_tag = g_strdup(badges_tag);
+    user->sender = format_sender(privmsg->display_name, msg->nick);
+    user->colour = utils_str_empty(user->colour_tag) ?
+        get_default_chat_colour(msg->nick) : user->colour_tag;
+    user->badges = g_list_copy(privmsg->badges);
+
+    return user;
+}
+
 static void
 send_msg_from_entry(GtChat* self)
 {
@@ -184,38 +335,83 @@ int_compare(const GtChatEmote* a, const GtChatEmote* b)
 }
 
 static void
-emoticons_cb(GObject* source,
-             GAsyncResult* res,
-             gpointer udata)
+clear_picker(GtChat* self)
+{
+    GtChatPrivate* priv = gt_chat_get_instance_private(self);
+
+    if (priv->picker_source > 0)
+    {
+        g_source_remove(priv->picker_source);
+        priv->picker_source = 0;
+    }
+
+    gt_chat_emote_list_free(priv->picker_emotes);
+    priv->picker_emotes = NULL;
+    priv->picker_next = NULL;
+
+    /* NOTE: Has to be emptied before the images are destroyed */
+    g_hash_table_remove_all(priv->picker_pending);
+
+    utils_container_clear(GTK_CONTAINER(priv->emote_flow));
+}
+
+static void
+set_picker_image(GtkWidget* image, GdkPixbuf* pixbuf, gint scale)
+{
+    cairo_surface_t* surface = gdk_cairo_surface_create_from_pixbuf(pixbuf,
+        scale, gtk_widget_get_window(image));
+
+    gtk_image_set_from_surface(GTK_IMAGE(image), surface);
+
+    cairo_surface_destroy(surface);
+}
+
+static gboolean
+picker_image_draw_cb(GtkWidget* image,
+                     cairo_t* cr,
+                     gpointer udata)
 {
     GtChat* self = GT_CHAT(udata);
     GtChatPrivate* priv = gt_chat_get_instance_private(self);
-    GError* error = NULL;
-    GList* emoticons = NULL;
+    gpointer id = g_object_get_data(G_OBJECT(image), "emote-id");
+    gint scale = CLAMP(gtk_widget_get_scale_factor(image), 1, GT_CHAT_IMAGE_MAX_SCALE);
+    g_autoptr(GdkPixbuf) pixbuf = NULL;
 
-    emoticons = g_task_propagate_pointer(G_TASK(res), &error);
+    g_signal_handlers_disconnect_by_func(image, picker_image_draw_cb, udata);
 
-    if (error)
+    pixbuf = gt_twitch_resolve_emote(main_app->twitch, GPOINTER_TO_INT(id), scale);
+
+    if (pixbuf)
+        set_picker_image(image, pixbuf, scale);
+    else
     {
-        //TODO: Show this error to user
-        WARNING("Couldn't get emoticons list");
-        return;
+        GSList* images = g_hash_table_lookup(priv->picker_pending, id);
+
+        g_object_set_data(G_OBJECT(image), "emote-scale", GINT_TO_POINTER(scale));
+
+        g_hash_table_steal(priv->picker_pending, id);
+        g_hash_table_insert(priv->picker_pending, id, g_slist_prepend(images, image));
     }
 
-    utils_container_clear(GTK_CONTAINER(priv->emote_flow));
+    return GDK_EVENT_PROPAGATE;
+}
 
-    emoticons = g_list_sort(emoticons, (GCompareFunc) int_compare);
+static gboolean
+fill_picker_cb(gpointer udata)
+{
+    GtChat* self = GT_CHAT(udata);
+    GtChatPrivate* priv = gt_chat_get_instance_private(self);
 
-    for (GList* l = emoticons; l != NULL; l = l->next)
+    for (gint i = 0; i < PICKER_CHUNK_SIZE && priv->picker_next != NULL;
+         i++, priv->picker_next = priv->picker_next->next)
     {
-        GtChatEmote* emote = l->data;
+        GtChatEmote* emote = priv->picker_next->data;
+        GtkWidget* image = gtk_image_new();
+        gchar* code = NULL;
 
         g_assert_nonnull(emote);
-        g_assert(GDK_IS_PIXBUF(emote->pixbuf));
-
-        GtkWidget* image = gtk_image_new_from_pixbuf(emote->pixbuf);
-        gchar* code = NULL;;
 
+        gtk_widget_set_size_request(image, PICKER_EMOTE_SIZE, PICKER_EMOTE_SIZE);
         gtk_widget_set_visible(image, TRUE);
 
         if (emote->id < 15)
@@ -227,176 +423,327 @@ emoticons_cb(GObject* source,
 
         g_object_set_data_full(G_OBJECT(image), "code",
             g_strdup(code), g_free);
+        g_object_set_data(G_OBJECT(image), "emote-id", GINT_TO_POINTER(emote->id));
+
+        g_signal_connect(image, "draw", G_CALLBACK(picker_image_draw_cb), self);
 
         gtk_flow_box_insert(GTK_FLOW_BOX(priv->emote_flow), image, -1);
     }
 
-    gt_chat_emote_list_free(emoticons);
+    if (priv->picker_next)
+        return G_SOURCE_CONTINUE;
+
+    gt_chat_emote_list_free(priv->picker_emotes);
+    priv->picker_emotes = NULL;
+    priv->picker_source = 0;
+
+    return G_SOURCE_REMOVE;
 }
 
-static gboolean
-irc_source_cb(GtIrcMessage* msg,
-              gpointer udata)
+static void
+emoticons_cb(GObject* source,
+             GAsyncResult* res,
+             gpointer udata)
 {
     GtChat* self = GT_CHAT(udata);
     GtChatPrivate* priv = gt_chat_get_instance_private(self);
-    gboolean ret = G_SOURCE_REMOVE;
+    GError* error = NULL;
+    GList* emoticons = NULL;
 
-    g_mutex_lock(&priv->mutex);
+    emoticons = g_task_propagate_pointer(G_TASK(res), &error);
 
-    if (msg->cmd_type == GT_IRC_COMMAND_PRIVMSG)
+    if (error)
     {
-        GtkTextIter iter;
-        GtIrcCommandPrivmsg* privmsg = msg->cmd.privmsg;
-        GtkTextTag* colour_tag;
-        const gchar* sender;
+        //TODO: Show this error to user
+        WARNING("Couldn't get emoticons list");
 
-        gtk_text_buffer_get_end_iter(priv->chat_buffer, &iter);
+        /* NOTE: So the next USERSTATE tries again */
+        g_clear_pointer(&priv->emote_sets, g_free);
+        g_error_free(error);
 
-        //FIXME: Ideally the display name should be bold and the nick name should be normal,
-        //will do this later
-        if (utils_str_empty(privmsg->display_name))
-            sender = g_strdup(msg->nick);
-        else
-        {
-            g_assert(g_utf8_validate(privmsg->display_name, -1, NULL));
-
-            for (const gchar* next_unichar = privmsg->display_name; *next_unichar; next_unichar = g_utf8_next_char(next_unichar))
-            {
-                GUnicodeScript script = g_unichar_get_script(g_utf8_get_char(next_unichar));
-
-                switch (script)
-                {
-                    case G_UNICODE_SCRIPT_HIRAGANA:
-                    case G_UNICODE_SCRIPT_KATAKANA:
-                    case G_UNICODE_SCRIPT_HANGUL:
-                    case G_UNICODE_SCRIPT_HAN:
-                    {
-                        sender = g_strdup_printf("%s (%s)", privmsg->display_name, msg->nick);
-                            goto done;
-                    }
-                    default:
-                        break;
-                }
-            }
-
-            sender = g_strdup(privmsg->display_name);
-        }
+        return;
+    }
 
-    done:
+    clear_picker(self);
 
-        if (!privmsg->colour || strlen(privmsg->colour) < 1)
-            privmsg->colour = g_strdup(get_default_chat_colour(msg->nick));
+    priv->picker_emotes = g_list_sort(emoticons, (GCompareFunc) int_compare);
+    priv->picker_next = priv->picker_emotes;
+    priv->picker_source = g_idle_add_full(G_PRIORITY_LOW, fill_picker_cb, self, NULL);
+}
 
-        colour_tag = gtk_text_tag_table_lookup(priv->tag_table, privmsg->colour);
+static void
+append_run(GArray* runs, GtChatRunType type, const gchar* start, const gchar* end,
+    const gchar* url, gsize url_len, GtChatEmote* emote)
+{
+    GtChatRun run = {type, start, end - start, url, url_len, emote};
 
-        if (!colour_tag)
-        {
-            colour_tag = gtk_text_buffer_create_tag(priv->chat_buffer, privmsg->colour,
-                                                    "foreground", privmsg->colour,
-                                                    "weight", PANGO_WEIGHT_BOLD,
-                                                    NULL);
-        }
+    if (end > start || type == GT_CHAT_RUN_EMOTE)
+        g_array_append_val(runs, run);
+}
+
+/* NOTE: Walks the message once, emote offsets are in characters
+ * (with an inclusive end) while url matches are in bytes so both are
+ * tracked side by side. Emotes take precedence over urls, emotes that
+ * overlap an earlier one or lie past the end are ignored */
+void
+gt_chat_split_runs(GArray* runs, const gchar* msg, GRegex* url_regex, GList* emotes)
+{
+    GMatchInfo* match_info = NULL;
+    GtChatRunType run_type = GT_CHAT_RUN_TEXT;
+    const gchar* run_start = msg;
+    const gchar* run_url = NULL;
+    gsize run_url_len = 0;
+    gint url_start = -1;
+    gint url_end = -1;
+    const gchar* c = msg;
+    glong i = 0;
+
+    g_assert_nonnull(runs);
+    g_assert_nonnull(msg);
+
+    if (url_regex && g_regex_match(url_regex, msg, 0, &match_info))
+        g_match_info_fetch_pos(match_info, 0, &url_start, &url_end);
+
+    while (*c)
+    {
+        GtChatEmote* emote = NULL;
+        GtChatRunType type;
+        gint pos = c - msg;
+
+        while (emotes && ((GtChatEmote*) emotes->data)->start < i)
+            emotes = emotes->next;
+
+        if (emotes) emote = emotes->data;
 
-        for (GList* l = privmsg->badges; l != NULL; l = l->next)
+        if (emote && emote->start == i)
         {
-            g_assert_nonnull(l->data);
+            append_run(runs, run_type, run_start, c, run_url, run_url_len, NULL);
 
-            GtChatBadge* badge = l->data;
+            run_start = c;
 
-            /* NOTE: If for whatever reason the pixbuf is NULL we'll just insert the original text */
-            if (badge->pixbuf)
-            {
-                gtk_text_buffer_insert_pixbuf(priv->chat_buffer, &iter, GDK_PIXBUF(badge->pixbuf));
-                gtk_text_buffer_insert(priv->chat_buffer, &iter, " ", -1);
-            }
-            else
-                gtk_text_buffer_insert(priv->chat_buffer, &iter, badge->name, -1);
+            for (; *c && i <= emote->end; ++i)
+                c = g_utf8_next_char(c);
+
+            append_run(runs, GT_CHAT_RUN_EMOTE, run_start, c, NULL, 0, emote);
+
+            run_start = c;
+            run_type = GT_CHAT_RUN_TEXT;
+            run_url = NULL;
+            run_url_len = 0;
+            emotes = emotes->next;
+
+            continue;
         }
 
-#undef INSERT_USER_MOD_PIXBUF
-
-        gtk_text_buffer_insert_with_tags(priv->chat_buffer, &iter, sender, -1, colour_tag, NULL);
-        gtk_text_buffer_insert(priv->chat_buffer, &iter, ": ", -1);
-
-        GMatchInfo* match_info = NULL;
-        glong match_offset_start = -1;
-        glong match_offset_end = -1;
-        GtkTextTag* url_tag = NULL;
-        gboolean done_matching = FALSE;
-
-#define UPDATE_URL_OFFSETS_AND_TAG()                                    \
-        if (!done_matching)                                             \
-        {                                                               \
-            gchar* match_string = g_match_info_fetch(match_info, 0);    \
-            gint match_start = -1;                                      \
-            gint match_end = -1;                                        \
-            g_match_info_fetch_pos(match_info, 0, &match_start, &match_end); \
-            match_offset_start = g_utf8_pointer_to_offset(privmsg->msg, privmsg->msg + match_start); \
-            match_offset_end = g_utf8_pointer_to_offset(privmsg->msg, privmsg->msg + match_end); \
-            done_matching = !g_match_info_next(match_info, NULL);       \
-            url_tag = gtk_text_buffer_create_tag(priv->chat_buffer, NULL, \
-                                                 "foreground", "blue",  \
-                                                 "underline", PANGO_UNDERLINE_SINGLE, \
-                                                 NULL);                 \
-            g_object_set_data(G_OBJECT(url_tag), "url", match_string);  \
-        }                                                               \
-
-        if (g_regex_match(priv->url_regex, privmsg->msg, 0, &match_info))
-            UPDATE_URL_OFFSETS_AND_TAG();
-
-        gchar* c = g_utf8_offset_to_pointer(privmsg->msg, 0);
-        gchar* d = g_utf8_offset_to_pointer(privmsg->msg, 1);
-        GList* l = privmsg->emotes;
-        for (gint i = 0; i < g_utf8_strlen(privmsg->msg, -1);
-             ++i, c = g_utf8_offset_to_pointer(privmsg->msg, i),
-                 d = g_utf8_offset_to_pointer(privmsg->msg, i + 1))
+        while (url_end >= 0 && pos >= url_end)
         {
-            GtChatEmote* emote = NULL;
-
-            if (l) emote = l->data;
-
-            if (emote && i == emote->start)
-            {
-                gtk_text_buffer_insert_pixbuf(priv->chat_buffer, &iter, emote->pixbuf);
-                l = l->next;
-                i = emote->end;
-            }
-            else if (i >= match_offset_start && i < match_offset_end)
-            {
-                gtk_text_buffer_insert_with_tags(priv->chat_buffer, &iter, c, (d - c)*sizeof(gchar),
-                                                 url_tag, NULL);
-
-                if (i + 1 == match_offset_end)
-                    UPDATE_URL_OFFSETS_AND_TAG();
-            }
+            if (g_match_info_next(match_info, NULL))
+                g_match_info_fetch_pos(match_info, 0, &url_start, &url_end);
             else
-                gtk_text_buffer_insert(priv->chat_buffer, &iter, c, (d - c)*sizeof(gchar));
+                url_start = url_end = -1;
+        }
+
+        type = url_start >= 0 && pos >= url_start ? GT_CHAT_RUN_URL : GT_CHAT_RUN_TEXT;
+
+        if (type != run_type || (type == GT_CHAT_RUN_URL && run_url != msg + url_start))
+        {
+            append_run(runs, run_type, run_start, c, run_url, run_url_len, NULL);
+
+            run_start = c;
+            run_type = type;
+            run_url = type == GT_CHAT_RUN_URL ? msg + url_start : NULL;
+            run_url_len = type == GT_CHAT_RUN_URL ? url_end - url_start : 0;
+        }
+
+        c = g_utf8_next_char(c);
+        ++i;
+    }
+
+    append_run(runs, run_type, run_start, c, run_url, run_url_len, NULL);
+
+    g_match_info_free(match_info);
+}
+
+static void
+emote_resolved_cb(GtTwitch* twitch,
+    gint id, GdkPixbuf* pixbuf, gint scale, gpointer udata)
+{
+    GtChat* self = GT_CHAT(udata);
+    GtChatPrivate* priv = gt_chat_get_instance_private(self);
+    GSList* images = g_hash_table_lookup(priv->picker_pending, GINT_TO_POINTER(id));
+    GSList* waiting = NULL;
+
+    g_hash_table_steal(priv->picker_pending, GINT_TO_POINTER(id));
+
+    /* NOTE: Images waiting on another scale keep waiting */
+    for (GSList* l = images; l != NULL; l = l->next)
+    {
+        if (GPOINTER_TO_INT(g_object_get_data(G_OBJECT(l->data), "emote-scale")) == scale)
+            set_picker_image(l->data, pixbuf, scale);
+        else
+            waiting = g_slist_prepend(waiting, l->data);
+    }
+
+    g_slist_free(images);
 
+    if (waiting)
+        g_hash_table_insert(priv->picker_pending, GINT_TO_POINTER(id), waiting);
+
+    gt_chat_view_images_changed(GT_CHAT_VIEW(priv->chat_view));
+}
+
+static void
+badge_resolved_cb(GtTwitch* twitch,
+    GtChatBadge* badge, gpointer udata)
+{
+    GtChat* self = GT_CHAT(udata);
+    GtChatPrivate* priv = gt_chat_get_instance_private(self);
+
+    gt_chat_view_images_changed(GT_CHAT_VIEW(priv->chat_view));
+}
+
+/* NOTE: In microseconds, from when Twitch received the message if it
+ * says so */
+static gint64
+message_timestamp(GtIrcMessage* msg)
+{
+    const gchar* sent = gt_irc_message_get_tag(msg, GT_IRC_TAG_TMI_SENT_TS);
+    gint64 ret = 0;
+
+    if (!utils_str_empty(sent))
+        ret = g_ascii_strtoll(sent, NULL, 10)*1000;
+
+    return ret > 0 ? ret : g_get_real_time();
+}
+
+static void
+load_log_history(GtChat* self)
+{
+    GtChatPrivate* priv = gt_chat_get_instance_private(self);
+    g_autoptr(GtChatLogReader) reader = NULL;
+    g_autoptr(GError) err = NULL;
+    GtChatLogRecord record;
+    guint count = 0;
+
+    reader = gt_chat_log_reader_new(gt_channel_get_name(priv->chan), &err);
+
+    if (!reader)
+    {
+        if (!g_error_matches(err, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+            WARNINGF("Unable to load chat history because: %s", err->message);
+
+        return;
+    }
+
+    gt_chat_log_reader_seek_tail(reader, g_settings_get_int(main_app->settings, "chat-history-size"));
+
+    while (gt_chat_log_reader_next(reader, &record))
+    {
+        g_autofree gchar* sender = format_sender(record.display_name, record.nick);
+        GList* emotes = gt_chat_log_record_get_emotes(&record);
+
+        g_array_set_size(priv->runs, 0);
+        gt_chat_split_runs(priv->runs, record.msg, priv->url_regex, emotes);
+
+        gt_chat_view_append_message(GT_CHAT_VIEW(priv->chat_view), sender, record.nick, record.user_id,
+            utils_str_empty(record.colour) ? get_default_chat_colour(record.nick) : record.colour,
+            NULL, priv->runs);
+
+        gt_chat_emote_list_free(emotes);
+
+        priv->log_loaded_until = record.timestamp;
+        count++;
+    }
+
+    DEBUGF("Loaded '%u' messages of history from the chat log", count);
+
+    if (count > 0)
+        gt_chat_view_scroll_to_bottom(GT_CHAT_VIEW(priv->chat_view));
+}
+
+/* NOTE: Returns whether any lines were added to the view */
+static gboolean
+handle_irc_message(GtChat* self, GtIrcMessage* msg)
+{
+    GtChatPrivate* priv = gt_chat_get_instance_private(self);
+    gboolean ret = FALSE;
+
+    if (msg->cmd_type == GT_IRC_COMMAND_PRIVMSG)
+    {
+        GtIrcCommandPrivmsg* privmsg = msg->cmd.privmsg;
+        const gchar* user_id = gt_irc_message_get_tag(msg, GT_IRC_TAG_USER_ID);
+        gint64 timestamp = message_timestamp(msg);
+        ChatUser* user;
+
+        /* NOTE: Replayed lines carry the timestamp they were logged
+         * with the first time round. Live messages are never compared
+         * as Twitch's clock can be behind the last record */
+        if (msg->replayed && timestamp <= priv->log_loaded_until)
+            return FALSE;
+
+        user = lookup_user(self, msg);
+
+        if (priv->log && !msg->replayed)
+        {
+            gt_chat_log_append(priv->log, timestamp, privmsg->user_modes, user_id, msg->nick,
+                privmsg->display_name, privmsg->colour, privmsg->msg, privmsg->emotes);
         }
 
-        g_match_info_free(match_info);
+        g_array_set_size(priv->runs, 0);
+        gt_chat_split_runs(priv->runs, privmsg->msg, priv->url_regex, privmsg->emotes);
 
-#undef UPDATE_URL_OFFSETS
+        gt_chat_view_append_message(GT_CHAT_VIEW(priv->chat_view), user->sender, msg->nick,
+            user_id, user->colour, user->badges, priv->runs);
 
-        gtk_text_buffer_insert(priv->chat_buffer, &iter, "\n", 1);
+        ret = TRUE;
+    }
+    else if (msg->cmd_type == GT_IRC_COMMAND_SKIPPED)
+    {
+        guint count = msg->cmd.skipped->count;
+        g_autofree gchar* text = NULL;
 
-        gtk_text_buffer_get_end_iter(priv->chat_buffer, &iter);
+        text = g_strdup_printf(ngettext("%u message skipped", "%u messages skipped", count), count);
 
-        gtk_text_buffer_move_mark(priv->chat_buffer, priv->bottom_mark, &iter);
+        gt_chat_view_append_notice(GT_CHAT_VIEW(priv->chat_view), text);
 
-        if (priv->chat_sticky)
-            gtk_text_view_scroll_mark_onscreen(GTK_TEXT_VIEW(priv->chat_view), priv->bottom_mark);
+        ret = TRUE;
     }
     else if (msg->cmd_type == GT_IRC_COMMAND_USERSTATE)
     {
-        const gchar* emote_sets = utils_search_key_value_strv(msg->tags, "emote-sets");
+        const gchar* emote_sets = gt_irc_message_get_tag(msg, GT_IRC_TAG_EMOTE_SETS);
+
+        /* NOTE: Twitch sends a USERSTATE after every message we send,
+         * the picker only needs rebuilding when the sets change */
+        if (g_strcmp0(emote_sets, priv->emote_sets) != 0)
+        {
+            g_free(priv->emote_sets);
+            priv->emote_sets = g_strdup(emote_sets);
 
-        gt_twitch_emoticons_async(main_app->twitch, emote_sets,
-            (GAsyncReadyCallback) emoticons_cb, NULL, self);
+            gt_twitch_emoticons_async(main_app->twitch, emote_sets,
+                (GAsyncReadyCallback) emoticons_cb, NULL, self);
+        }
     }
 
-    gt_irc_message_free(msg);
+    return ret;
+}
+
+static gboolean
+irc_source_cb(GPtrArray* msgs,
+              gpointer udata)
+{
+    GtChat* self = GT_CHAT(udata);
+    GtChatPrivate* priv = gt_chat_get_instance_private(self);
+    gboolean inserted = FALSE;
+
+    g_mutex_lock(&priv->mutex);
+
+    for (guint i = 0; i < msgs->len; i++)
+        inserted |= handle_irc_message(self, g_ptr_array_index(msgs, i));
+
+    /* NOTE: The view lays out and scrolls once per frame no matter
+     * how many batches come in before it */
+    if (inserted && priv->chat_sticky)
+        gt_chat_view_scroll_to_bottom(GT_CHAT_VIEW(priv->chat_view));
 
     g_mutex_unlock(&priv->mutex);
 
@@ -416,6 +763,84 @@ key_press_cb(GtkWidget* widget,
     return FALSE;
 }
 
+/* NOTE: Jumping to a match stops the chat following new messages */
+static void
+find_match(GtChat* self, gboolean older)
+{
+    GtChatPrivate* priv = gt_chat_get_instance_private(self);
+
+    if (gt_chat_view_find(GT_CHAT_VIEW(priv->chat_view), older))
+    {
+        priv->chat_sticky = FALSE;
+        REMOVE_STYLE_CLASS(priv->search_entry, GTK_STYLE_CLASS_ERROR);
+    }
+    else if (gtk_entry_get_text_length(GTK_ENTRY(priv->search_entry)) > 0)
+        ADD_STYLE_CLASS(priv->search_entry, GTK_STYLE_CLASS_ERROR);
+}
+
+static void
+search_changed_cb(GtkSearchEntry* entry,
+                  gpointer udata)
+{
+    GtChat* self = GT_CHAT(udata);
+    GtChatPrivate* priv = gt_chat_get_instance_private(self);
+
+    REMOVE_STYLE_CLASS(priv->search_entry, GTK_STYLE_CLASS_ERROR);
+
+    gt_chat_view_set_search(GT_CHAT_VIEW(priv->chat_view), gtk_entry_get_text(GTK_ENTRY(entry)));
+
+    find_match(self, TRUE);
+}
+
+static void
+search_older_cb(GtkSearchEntry* entry,
+                gpointer udata)
+{
+    find_match(GT_CHAT(udata), TRUE);
+}
+
+static void
+search_newer_cb(GtkSearchEntry* entry,
+                gpointer udata)
+{
+    find_match(GT_CHAT(udata), FALSE);
+}
+
+static void
+search_mode_cb(GObject* source,
+               GParamSpec* pspec,
+               gpointer udata)
+{
+    GtChat* self = GT_CHAT(udata);
+    GtChatPrivate* priv = gt_chat_get_instance_private(self);
+
+    if (!gtk_search_bar_get_search_mode(GTK_SEARCH_BAR(priv->search_bar)))
+    {
+        gt_chat_view_set_search(GT_CHAT_VIEW(priv->chat_view), NULL);
+        gtk_entry_set_text(GTK_ENTRY(priv->search_entry), "");
+    }
+}
+
+static gboolean
+chat_key_press_cb(GtkWidget* widget,
+                  GdkEventKey* evt,
+                  gpointer udata)
+{
+    GtChat* self = GT_CHAT(udata);
+    GtChatPrivate* priv = gt_chat_get_instance_private(self);
+    GtkSearchBar* bar = GTK_SEARCH_BAR(priv->search_bar);
+
+    if ((evt->state & GDK_CONTROL_MASK) && evt->keyval == GDK_KEY_f)
+    {
+        gtk_search_bar_set_search_mode(bar, TRUE);
+        gtk_widget_grab_focus(priv->search_entry);
+
+        return GDK_EVENT_STOP;
+    }
+
+    return GDK_EVENT_PROPAGATE;
+}
+
 static gboolean
 chat_view_button_press_cb(GtkWidget* widget,
                           GdkEventButton* evt,
@@ -423,34 +848,23 @@ chat_view_button_press_cb(GtkWidget* widget,
 {
     GtChat* self = GT_CHAT(udata);
     GtChatPrivate* priv = gt_chat_get_instance_private(self);
-    gint x, y;
-    GtkTextIter iter;
-    GSList* tags;
+    const gchar* url;
 
-    gtk_text_view_window_to_buffer_coords(GTK_TEXT_VIEW(priv->chat_view), GTK_TEXT_WINDOW_TEXT,
-                                          evt->x, evt->y, &x, &y);
-    gtk_text_view_get_iter_at_location(GTK_TEXT_VIEW(priv->chat_view), &iter, x, y);
-    tags = gtk_text_iter_get_tags(&iter);
+    url = gt_chat_view_get_url_at(GT_CHAT_VIEW(priv->chat_view), evt->x, evt->y);
 
-    for (GSList* l = tags; l != NULL; l = l->next)
+    if (!utils_str_empty(url))
     {
-        gchar* url = g_object_get_data(G_OBJECT(l->data), "url");
         GtWin* win = GT_WIN_TOPLEVEL(self);
 
         g_assert(GT_IS_WIN(win));
 
-        if (!utils_str_empty(url))
-        {
 #if GTK_CHECK_VERSION(3, 22, 0)
-            gtk_show_uri_on_window(GTK_WINDOW(win), url, GDK_CURRENT_TIME, NULL);
+        gtk_show_uri_on_window(GTK_WINDOW(win), url, GDK_CURRENT_TIME, NULL);
 #else
-            gtk_show_uri(NULL, url, GDK_CURRENT_TIME, NULL);
+        gtk_show_uri(NULL, url, GDK_CURRENT_TIME, NULL);
 #endif
-        }
     }
 
-    g_slist_free(tags);
-
     return FALSE;
 }
 
@@ -461,35 +875,14 @@ chat_view_motion_cb(GtkWidget* widget,
 {
     GtChat* self = GT_CHAT(udata);
     GtChatPrivate* priv = gt_chat_get_instance_private(self);
-    gint x, y;
-    GtkTextIter iter;
-    GSList* tags = NULL;
     GdkCursor* cursor = NULL;
 
-    gtk_text_view_window_to_buffer_coords(GTK_TEXT_VIEW(widget),
-                                          GTK_TEXT_WINDOW_WIDGET,
-                                          evt->x, evt->y,
-                                          &x, &y);
-
-    gtk_text_view_get_iter_at_location(GTK_TEXT_VIEW(widget),
-        &iter, x, y);
-
-    tags = gtk_text_iter_get_tags(&iter);
-
-    for (GSList* l = tags; l != NULL; l = l->next)
-    {
-        if (g_object_get_data(G_OBJECT(l->data), "url"))
-        {
-            cursor = gdk_cursor_new_for_display(gdk_display_get_default(), GDK_HAND2);
-            break;
-        }
-    }
-
-    if (!cursor) cursor = gdk_cursor_new_for_display(gdk_display_get_default(), GDK_XTERM);
+    if (gt_chat_view_get_url_at(GT_CHAT_VIEW(priv->chat_view), evt->x, evt->y))
+        cursor = gdk_cursor_new_for_display(gdk_display_get_default(), GDK_HAND2);
 
     gdk_window_set_cursor(evt->window, cursor);
 
-    g_object_unref(cursor);
+    if (cursor) g_object_unref(cursor);
 
     return GDK_EVENT_PROPAGATE;
 }
@@ -675,6 +1068,18 @@ finalise(GObject* obj)
     G_OBJECT_CLASS(gt_chat_parent_class)->finalize(obj);
 
     g_object_unref(priv->irc);
+
+    if (priv->picker_source > 0)
+        g_source_remove(priv->picker_source);
+
+    gt_chat_emote_list_free(priv->picker_emotes);
+    g_hash_table_destroy(priv->picker_pending);
+    g_clear_object(&priv->log);
+    g_free(priv->emote_sets);
+
+    g_array_free(priv->runs, TRUE);
+    g_hash_table_destroy(priv->user_table);
+    g_queue_free_full(priv->user_lru, (GDestroyNotify) chat_user_free);
 }
 
 static void
@@ -736,8 +1141,9 @@ gt_chat_class_init(GtChatClass* klass)
     gtk_widget_class_set_template_from_resource(widget_class,
                                                 "/com/vinszent/GnomeTwitch/ui/gt-chat.ui");
 
-    gtk_widget_class_bind_template_child_private(widget_class, GtChat, chat_view);
     gtk_widget_class_bind_template_child_private(widget_class, GtChat, chat_scroll);
+    gtk_widget_class_bind_template_child_private(widget_class, GtChat, search_bar);
+    gtk_widget_class_bind_template_child_private(widget_class, GtChat, search_entry);
     gtk_widget_class_bind_template_child_private(widget_class, GtChat, chat_entry);
     gtk_widget_class_bind_template_child_private(widget_class, GtChat, main_stack);
     gtk_widget_class_bind_template_child_private(widget_class, GtChat, error_label);
@@ -761,36 +1167,6 @@ gt_chat_class_init(GtChatClass* klass)
     g_object_class_install_properties(obj_class, NUM_PROPS, props);
 }
 
-static void
-value_changed(GtkAdjustment* adjustment,
-              gpointer udata)
-{
-    GtChat* self = GT_CHAT(udata);
-    GtChatPrivate* priv = gt_chat_get_instance_private(self);
-
-    gdouble val = gtk_adjustment_get_value(adjustment);
-    gdouble upper = gtk_adjustment_get_upper(adjustment);
-    gdouble page_size = gtk_adjustment_get_page_size(adjustment);
-
-    if (val >= upper - page_size - 5 || val < 1)
-    {
-        gint lc = gtk_text_buffer_get_line_count(priv->chat_buffer);
-
-        if (lc - MAX_SCROLLBACK >= SAVEUP_AMOUNT)
-        {
-            g_mutex_lock(&priv->mutex);
-
-            GtkTextIter start, end;
-
-            gtk_text_buffer_get_iter_at_line(priv->chat_buffer, &start, 0);
-            gtk_text_buffer_get_iter_at_line(priv->chat_buffer, &end, lc - MAX_SCROLLBACK);
-            gtk_text_buffer_delete(priv->chat_buffer, &start, &end);
-
-            g_mutex_unlock(&priv->mutex);
-        }
-    }
-}
-
 static void
 gt_chat_init(GtChat* self)
 {
@@ -806,11 +1182,10 @@ gt_chat_init(GtChat* self)
                                    GTK_STYLE_PROVIDER_PRIORITY_USER);
 
     priv->chat_scroll_vbar = gtk_scrolled_window_get_vscrollbar(GTK_SCROLLED_WINDOW(priv->chat_scroll));
-    priv->chat_buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(priv->chat_view));
-    priv->tag_table = gtk_text_buffer_get_tag_table(priv->chat_buffer);
-    gtk_text_buffer_get_end_iter(priv->chat_buffer, &priv->bottom_iter);
-    priv->bottom_mark = gtk_text_buffer_create_mark(priv->chat_buffer, "end", &priv->bottom_iter, TRUE);
-    priv->chat_adjustment = gtk_scrolled_window_get_vadjustment(GTK_SCROLLED_WINDOW(priv->chat_scroll));
+    priv->chat_view = GTK_WIDGET(gt_chat_view_new());
+    gtk_widget_set_visible(priv->chat_view, TRUE);
+    gtk_container_add(GTK_CONTAINER(priv->chat_scroll), priv->chat_view);
+    gtk_search_bar_connect_entry(GTK_SEARCH_BAR(priv->search_bar), GTK_ENTRY(priv->search_entry));
 
     priv->irc = gt_irc_new();
     priv->irc_cancel = g_cancellable_new();
@@ -821,9 +1196,19 @@ gt_chat_init(GtChat* self)
 
     priv->url_regex = g_regex_new("(https?://([-\\w\\.]+)+(:\\d+)?(/([\\w/_\\.]*(\\?\\S+)?)?)?)",
                                   G_REGEX_OPTIMIZE, 0, NULL);
-
+    priv->runs = g_array_new(FALSE, FALSE, sizeof(GtChatRun));
+    priv->user_table = g_hash_table_new(g_str_hash, g_str_equal);
+    priv->user_lru = g_queue_new();
+    priv->picker_pending = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+        NULL, (GDestroyNotify) g_slist_free);
 
     g_signal_connect(priv->chat_entry, "key-press-event", G_CALLBACK(key_press_cb), self);
+    g_signal_connect(self, "key-press-event", G_CALLBACK(chat_key_press_cb), self);
+    g_signal_connect(priv->search_entry, "search-changed", G_CALLBACK(search_changed_cb), self);
+    g_signal_connect(priv->search_entry, "activate", G_CALLBACK(search_older_cb), self);
+    g_signal_connect(priv->search_entry, "previous-match", G_CALLBACK(search_older_cb), self);
+    g_signal_connect(priv->search_entry, "next-match", G_CALLBACK(search_newer_cb), self);
+    g_signal_connect(priv->search_bar, "notify::search-mode-enabled", G_CALLBACK(search_mode_cb), self);
     utils_signal_connect_oneshot(self, "hierarchy-changed", G_CALLBACK(anchored_cb), self);
     g_signal_connect(priv->irc, "error-encountered", G_CALLBACK(error_encountered_cb), self);
     g_signal_connect(priv->irc, "notify::state", G_CALLBACK(connected_cb), self);
@@ -833,10 +1218,28 @@ gt_chat_init(GtChat* self)
     g_signal_connect(priv->chat_view, "motion-notify-event", G_CALLBACK(chat_view_motion_cb), self);
     g_signal_connect(priv->chat_scroll, "scroll-event", G_CALLBACK(chat_scrolled_cb), self);
     g_signal_connect(priv->chat_scroll_vbar, "button-press-event", G_CALLBACK(chat_scrolled_cb), self);
-    g_signal_connect(priv->chat_adjustment, "value-changed", G_CALLBACK(value_changed), self);
     g_signal_connect(priv->chat_entry, "icon-press", G_CALLBACK(emote_icon_press_cb), self);
     g_signal_connect(priv->emote_flow, "child-activated", G_CALLBACK(emote_activated_cb), self);
     g_signal_connect(priv->irc, "notify::state", G_CALLBACK(irc_state_changed_cb), self);
+    g_signal_connect_object(main_app->twitch, "emote-resolved", G_CALLBACK(emote_resolved_cb), self, 0);
+    g_signal_connect_object(main_app->twitch, "badge-resolved", G_CALLBACK(badge_resolved_cb), self, 0);
+
+    g_settings_bind(main_app->settings, "chat-dispatch-budget",
+        priv->irc, "dispatch-budget", G_SETTINGS_BIND_GET);
+    g_settings_bind(main_app->settings, "chat-queue-limit",
+        priv->irc, "queue-limit", G_SETTINGS_BIND_GET);
+    g_settings_bind(main_app->settings, "chat-overload-policy",
+        priv->irc, "overload-policy", G_SETTINGS_BIND_GET);
+    g_settings_bind(main_app->settings, "chat-shared-io",
+        priv->irc, "shared-io", G_SETTINGS_BIND_GET);
+    g_settings_bind(main_app->settings, "chat-idle-timeout",
+        priv->irc, "idle-timeout", G_SETTINGS_BIND_GET);
+    g_settings_bind(main_app->settings, "chat-history-size",
+        priv->irc, "history-size", G_SETTINGS_BIND_GET);
+    g_settings_bind(main_app->settings, "chat-history-memory",
+        priv->irc, "history-memory", G_SETTINGS_BIND_GET);
+    g_settings_bind(main_app->settings, "chat-scrollback",
+        priv->chat_view, "scrollback", G_SETTINGS_BIND_GET);
 
     /* g_object_bind_property(priv->irc, "logged-in", */
     /*                        priv->connecting_revealer, "reveal-child", */
@@ -891,11 +1294,36 @@ gt_chat_connect(GtChat* self, GtChannel* chan)
 
     priv->chan = g_object_ref(chan);
 
+    if (g_settings_get_boolean(main_app->settings, "chat-log"))
+    {
+        g_autoptr(GError) err = NULL;
+
+        /* NOTE: Opened first so a partial record left by a crash is
+         * gone before the history is read */
+        /* NOTE: Another chat showing the channel is already recording
+         * it, the history is still shown */
+        if (!(priv->log = gt_chat_log_new(gt_channel_get_name(chan), &err)))
+        {
+            if (g_error_matches(err, G_IO_ERROR, G_IO_ERROR_BUSY))
+                DEBUGF("Not recording chat because: %s", err->message);
+            else
+                WARNINGF("Unable to record chat because: %s", err->message);
+        }
+
+        load_log_history(self);
+    }
+
     GtIrcState state = gt_irc_get_state(priv->irc);
 
     utils_refresh_cancellable(&priv->irc_cancel);
 
-    if (state >= GT_IRC_STATE_CONNECTING)
+    /* NOTE: The connection was kept warm, we only need to join */
+    if (gt_irc_is_idle(priv->irc))
+    {
+        gt_irc_connect_and_join_channel_async(priv->irc, priv->chan,
+            priv->irc_cancel, NULL, NULL);
+    }
+    else if (state >= GT_IRC_STATE_CONNECTING)
     {
         if (priv->irc_disconnected_source > 0)
             g_signal_handler_disconnect(priv->irc, priv->irc_disconnected_source);
@@ -934,9 +1362,14 @@ gt_chat_disconnect(GtChat* self)
     else if (state == GT_IRC_STATE_CONNECTING)
         g_cancellable_cancel(priv->irc_cancel);
     else if (state > GT_IRC_STATE_CONNECTING)
-        gt_irc_disconnect(priv->irc);
+        gt_irc_release(priv->irc);
 
     g_clear_object(&priv->chan);
+    g_clear_object(&priv->log);
+    priv->log_loaded_until = 0;
+
+    gt_chat_view_clear(GT_CHAT_VIEW(priv->chat_view));
 
-    gtk_text_buffer_set_text(priv->chat_buffer, "", -1);
+    /* NOTE: Badges are per channel */
+    clear_users(self);
 }
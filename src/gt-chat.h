@@ -21,6 +21,7 @@
 
 #include <gtk/gtk.h>
 #include "gt-channel.h"
+#include "gt-twitch.h"
 
 G_BEGIN_DECLS
 
@@ -33,9 +34,30 @@ struct _GtChat
     GtkBox parent_instance;
 };
 
+typedef enum
+{
+    GT_CHAT_RUN_TEXT,
+    GT_CHAT_RUN_URL,
+    GT_CHAT_RUN_EMOTE,
+} GtChatRunType;
+
+/* NOTE: Stretch of a chat message that is inserted into the buffer
+ * with a single call. Text and url point into the message, url is
+ * the whole link a url run is part of as an emote can split it */
+typedef struct
+{
+    GtChatRunType type;
+    const gchar* text;
+    gsize len;
+    const gchar* url;
+    gsize url_len;
+    GtChatEmote* emote;
+} GtChatRun;
+
 GtChat*         gt_chat_new();
 void            gt_chat_connect(GtChat* self, GtChannel* chan);
 void            gt_chat_disconnect(GtChat* self);
+void            gt_chat_split_runs(GArray* runs, const gchar* msg, GRegex* url_regex, GList* emotes);
 
 G_END_DECLS
 
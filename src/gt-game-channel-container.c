@@ -22,6 +22,7 @@
 #include "gt-win.h"
 #include "gt-channels-container-child.h"
 #include "gt-channel.h"
+#include "gt-json-decoders.h"
 #include "utils.h"
 #include <glib/gi18n.h>
 
@@ -35,7 +36,6 @@
 typedef struct
 {
     gchar* game;
-    JsonParser* json_parser;
     GCancellable* cancel;
 } GtGameChannelContainerPrivate;
 
@@ -69,7 +69,7 @@ static void
 process_json_cb(GObject* source,
     GAsyncResult* res, gpointer udata)
 {
-    RETURN_IF_FAIL(JSON_IS_PARSER(source));
+    RETURN_IF_FAIL(G_IS_MEMORY_OUTPUT_STREAM(source));
     RETURN_IF_FAIL(G_IS_ASYNC_RESULT(res));
     RETURN_IF_FAIL(udata != NULL);
 
@@ -82,12 +82,11 @@ process_json_cb(GObject* source,
         return;
     }
 
-    GtGameChannelContainerPrivate* priv = gt_game_channel_container_get_instance_private(self);
-    g_autoptr(JsonReader) reader = NULL;
+    g_autoptr(GBytes) bytes = NULL;
     g_autoptr(GtGameList) items = NULL;
     g_autoptr(GError) err = NULL;
 
-    json_parser_load_from_stream_finish(priv->json_parser, res, &err);
+    g_output_stream_splice_finish(G_OUTPUT_STREAM(source), res, &err);
 
     if (g_error_matches(err, G_IO_ERROR, G_IO_ERROR_CANCELLED))
     {
@@ -101,45 +100,19 @@ process_json_cb(GObject* source,
         return;
     }
 
-    reader = json_reader_new(json_parser_get_root(priv->json_parser));
+    bytes = g_memory_output_stream_steal_as_bytes(G_MEMORY_OUTPUT_STREAM(source));
 
-    if (!json_reader_read_member(reader, "streams"))
-    {
-        WARNING("Unable to process JSON because: %s",
-            json_reader_get_error(reader)->message);
-        gt_item_container_show_error(GT_ITEM_CONTAINER(self),
-            json_reader_get_error(reader));
-        return;
-    }
+    items = gt_json_decode_streams_page(g_bytes_get_data(bytes, NULL), g_bytes_get_size(bytes), &err);
 
-    for (gint i = 0; i < json_reader_count_elements(reader); i++)
+    if (err)
     {
-        g_autoptr(GtChannelData) data = NULL;
-
-        if (!json_reader_read_element(reader, i))
-        {
-            WARNING("Unable to process JSON because: %s",
-                json_reader_get_error(reader)->message);
-            gt_item_container_show_error(GT_ITEM_CONTAINER(self),
-                json_reader_get_error(reader));
-            return;
-        }
-
-        data = utils_parse_stream_from_json(reader, &err);
-
-        if (err)
-        {
-            WARNING("Unable to process JSON because: %s", err->message);
-            gt_item_container_show_error(GT_ITEM_CONTAINER(self), err);
-            return;
-        }
-
-        items = g_list_append(items, gt_channel_new(g_steal_pointer(&data)));
-
-        json_reader_end_element(reader);
+        WARNING("Unable to process JSON because: %s", err->message);
+        gt_item_container_show_error(GT_ITEM_CONTAINER(self), err);
+        return;
     }
 
-    json_reader_end_member(reader);
+    for (GList* l = items; l != NULL; l = l->next)
+        l->data = gt_channel_new(l->data);
 
     gt_item_container_append_items(GT_ITEM_CONTAINER(self), g_steal_pointer(&items));
     gt_item_container_set_fetching_items(GT_ITEM_CONTAINER(self), FALSE);
@@ -159,6 +132,7 @@ handle_response_cb(GtHTTP* http,
     if (!self) {TRACE("Unreffed while waiting"); return;}
 
     GtGameChannelContainerPrivate* priv = gt_game_channel_container_get_instance_private(self);
+    g_autoptr(GOutputStream) output = NULL;
 
     if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
     {
@@ -174,8 +148,11 @@ handle_response_cb(GtHTTP* http,
 
     RETURN_IF_FAIL(G_IS_INPUT_STREAM(res));
 
-    json_parser_load_from_stream_async(priv->json_parser, res,
-        priv->cancel, process_json_cb, g_steal_pointer(&ref));
+    output = g_memory_output_stream_new_resizable();
+
+    g_output_stream_splice_async(output, G_INPUT_STREAM(res),
+        G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE | G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+        G_PRIORITY_DEFAULT, priv->cancel, process_json_cb, g_steal_pointer(&ref));
 }
 
 static void
@@ -279,7 +256,6 @@ gt_game_channel_container_init(GtGameChannelContainer* self)
 {
     GtGameChannelContainerPrivate* priv = gt_game_channel_container_get_instance_private(self);
 
-    priv->json_parser = json_parser_new();
     priv->cancel = NULL;
 }
 
@@ -34,27 +34,42 @@ typedef struct
     SoupSession* soup;
     GQueue* message_queue;
     GHashTable* inflight_table;
+    GHashTable* pending_table; // Requests that can still be joined, by key
     GtCache* cache;
 
     guint max_inflight_per_category;
     gchar* cache_directory;
+    guint requests_sent;
+    guint requests_coalesced;
 } GtHTTPSoupPrivate;
 
+/* NOTE: One request on the wire, shared by every caller that asked for
+ * the same URI with the same headers while it was queued or in flight */
 typedef struct
 {
     GWeakRef* self;
     SoupMessage* soup_message;
     gchar* uri;
+    gchar* key;
     gchar* category;
+    GCancellable* cancel; // Cancelled once every subscriber has left
+    GList* subscribers;
+    gint flags; // Flags of all subscribers combined
+    gssize content_length;
+    gssize bytes_read;
+} SoupCallbackData;
+
+typedef struct
+{
+    GWeakRef* self;
+    SoupCallbackData* msg; // NULL once detached
     GCancellable* cancel;
     gulong cancel_cb_id;
     GtHTTPStreamCallback cb_stream;
     GtHTTPDataCallback cb_data;
     gpointer udata;
     gint flags;
-    gssize content_length;
-    gssize bytes_read;
-} SoupCallbackData;
+} SoupSubscriber;
 
 static void gt_http_iface_init(GtHTTPInterface* iface);
 
@@ -67,6 +82,8 @@ enum
     PROP_0,
     PROP_MAX_INFLIGHT_PER_CATEGORY,
     PROP_CACHE_DIRECTORY,
+    PROP_REQUESTS_SENT,
+    PROP_REQUESTS_COALESCED,
     NUM_PROPS,
 };
 
@@ -74,36 +91,21 @@ static GParamSpec* props[NUM_PROPS];
 
 #define NO_CATEGORY "_NO_CATEGORY"
 
-#define CALL_ERROR_CB(msg, err)                                         \
-    G_STMT_START                                                        \
-    {                                                                   \
-        if (msg->flags & GT_HTTP_FLAG_RETURN_STREAM)                    \
-            msg->cb_stream(GT_HTTP(self), NULL, g_steal_pointer(&err), msg->udata); \
-        else if (msg->flags & GT_HTTP_FLAG_RETURN_DATA)                 \
-            msg->cb_data(GT_HTTP(self), NULL, 0, g_steal_pointer(&err), msg->udata); \
-        else                                                            \
-            RETURN_IF_REACHED();                                        \
-    } G_STMT_END
+static GList* take_subscribers(SoupCallbackData* msg);
+static void soup_subscriber_free(SoupSubscriber* sub);
 
 static SoupCallbackData*
-soup_callback_data_new(GtHTTPSoup* self, SoupMessage* soup_message, const gchar* category,
-    GCancellable* cancel, GCallback cb, gpointer udata, gint flags)
+soup_callback_data_new(GtHTTPSoup* self, SoupMessage* soup_message,
+    const gchar* key, const gchar* category)
 {
     SoupCallbackData* data = g_slice_new0(SoupCallbackData);
 
     data->self = utils_weak_ref_new(self);
     data->soup_message = g_object_ref(soup_message);
     data->uri = soup_uri_to_string(soup_message_get_uri(soup_message), FALSE);
+    data->key = g_strdup(key);
     data->category = g_strdup(category);
-    data->cancel = g_object_ref(cancel);
-    data->udata = udata;
-    data->flags = flags;
-    if (flags & GT_HTTP_FLAG_RETURN_STREAM)
-        data->cb_stream = (GtHTTPStreamCallback) cb;
-    else if (flags & GT_HTTP_FLAG_RETURN_DATA)
-        data->cb_data = (GtHTTPDataCallback) cb;
-    else
-        RETURN_VAL_IF_REACHED(NULL);
+    data->cancel = g_cancellable_new();
 
     return data;
 }
@@ -113,15 +115,150 @@ soup_callback_data_free(SoupCallbackData* data)
 {
     if (!data) return;
 
+    /* NOTE: Only left when we were unreffed while waiting */
+    g_list_free_full(take_subscribers(data), (GDestroyNotify) soup_subscriber_free);
+
     g_free(data->uri);
+    g_free(data->key);
     g_free(data->category);
     utils_weak_ref_free(data->self);
     g_object_unref(data->soup_message);
-    if (data->cancel) g_object_unref(data->cancel);
+    g_object_unref(data->cancel);
 
     g_slice_free(SoupCallbackData, data);
 }
 
+static SoupSubscriber*
+soup_subscriber_new(GtHTTPSoup* self, GCancellable* cancel,
+    GCallback cb, gpointer udata, gint flags)
+{
+    SoupSubscriber* sub = g_slice_new0(SoupSubscriber);
+
+    sub->self = utils_weak_ref_new(self);
+    sub->cancel = cancel ? g_object_ref(cancel) : NULL;
+    sub->udata = udata;
+    sub->flags = flags;
+    if (flags & GT_HTTP_FLAG_RETURN_STREAM)
+        sub->cb_stream = (GtHTTPStreamCallback) cb;
+    else if (flags & GT_HTTP_FLAG_RETURN_DATA)
+        sub->cb_data = (GtHTTPDataCallback) cb;
+    else
+        g_assert_not_reached();
+
+    return sub;
+}
+
+static void
+soup_subscriber_free(SoupSubscriber* sub)
+{
+    if (!sub) return;
+
+    g_assert_null(sub->msg);
+    g_assert(sub->cancel_cb_id == 0);
+
+    utils_weak_ref_free(sub->self);
+    if (sub->cancel) g_object_unref(sub->cancel);
+
+    g_slice_free(SoupSubscriber, sub);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(SoupSubscriber, soup_subscriber_free);
+
+/* NOTE: Detaches every subscriber from msg so they can be called back,
+ * the caller frees them */
+static GList*
+take_subscribers(SoupCallbackData* msg)
+{
+    GList* subs = g_steal_pointer(&msg->subscribers);
+
+    for (GList* l = subs; l != NULL; l = l->next)
+    {
+        SoupSubscriber* sub = l->data;
+
+        if (sub->cancel_cb_id > 0)
+            g_cancellable_disconnect(sub->cancel, sub->cancel_cb_id);
+
+        sub->cancel_cb_id = 0;
+        sub->msg = NULL;
+    }
+
+    return subs;
+}
+
+/* NOTE: Subscribers own the error they are called with */
+static void
+call_subscriber_error_cb(GtHTTPSoup* self, SoupSubscriber* sub, const GError* err)
+{
+    if (sub->flags & GT_HTTP_FLAG_RETURN_STREAM)
+        sub->cb_stream(GT_HTTP(self), NULL, g_error_copy(err), sub->udata);
+    else
+        sub->cb_data(GT_HTTP(self), NULL, 0, g_error_copy(err), sub->udata);
+}
+
+static void
+call_error_cb(GtHTTPSoup* self, SoupCallbackData* msg, const GError* err)
+{
+    GList* subs = take_subscribers(msg);
+
+    for (GList* l = subs; l != NULL; l = l->next)
+        call_subscriber_error_cb(self, l->data, err);
+
+    g_list_free_full(subs, (GDestroyNotify) soup_subscriber_free);
+}
+
+/* NOTE: Each subscriber asking for a stream gets its own one over the
+ * same bytes */
+static void
+call_bytes_cb(GtHTTPSoup* self, SoupCallbackData* msg, GBytes* bytes)
+{
+    GList* subs = take_subscribers(msg);
+
+    for (GList* l = subs; l != NULL; l = l->next)
+    {
+        SoupSubscriber* sub = l->data;
+
+        if (sub->flags & GT_HTTP_FLAG_RETURN_STREAM)
+        {
+            g_autoptr(GInputStream) istream = g_memory_input_stream_new_from_bytes(bytes);
+
+            sub->cb_stream(GT_HTTP(self), istream, NULL, sub->udata);
+        }
+        else
+        {
+            sub->cb_data(GT_HTTP(self), g_bytes_get_data(bytes, NULL),
+                g_bytes_get_size(bytes), NULL, sub->udata);
+        }
+    }
+
+    g_list_free_full(subs, (GDestroyNotify) soup_subscriber_free);
+}
+
+/* NOTE: Stops later callers from joining msg */
+static void
+forget_request(GtHTTPSoup* self, SoupCallbackData* msg)
+{
+    GtHTTPSoupPrivate* priv = gt_http_soup_get_instance_private(self);
+
+    if (g_hash_table_lookup(priv->pending_table, msg->key) == msg)
+        g_hash_table_remove(priv->pending_table, msg->key);
+}
+
+static gchar*
+request_key(const gchar* uri, gchar** headers, gint flags)
+{
+    GString* key = g_string_new(uri);
+
+    for (guint i = 0; headers[i] != NULL; i += 2)
+        g_string_append_printf(key, "\n%s: %s", headers[i], headers[i+1]);
+
+    /* NOTE: Whether the response is cached decides how it's read,
+     * so it has to be the same for everyone sharing it */
+    if (flags & GT_HTTP_FLAG_CACHE_RESPONSE)
+        g_string_append(key, "\ncache");
+
+    return g_string_free(key, FALSE);
+}
+
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(SoupCallbackData, soup_callback_data_free);
 
 static inline void send_next_message(GtHTTPSoup* self);
@@ -220,7 +357,7 @@ download_stream_fill_cb(GObject* source,
             WARNING("%s", err->message);
         }
 
-        CALL_ERROR_CB(msg, err);
+        call_error_cb(self, msg, err);
 
         return;
     }
@@ -235,6 +372,7 @@ download_stream_fill_cb(GObject* source,
     {
         gsize length;
         gconstpointer data = g_buffered_input_stream_peek_buffer(bistream, &length);
+        g_autoptr(GBytes) bytes = NULL;
 
         if (msg->flags & GT_HTTP_FLAG_CACHE_RESPONSE)
         {
@@ -248,12 +386,9 @@ download_stream_fill_cb(GObject* source,
             gt_cache_save_data(priv->cache, msg->uri, data, length, last_updated, expiry, etag);
         }
 
-        if (msg->flags & GT_HTTP_FLAG_RETURN_STREAM)
-            msg->cb_stream(GT_HTTP(self), G_INPUT_STREAM(bistream), NULL, msg->udata);
-        else if(msg->flags & GT_HTTP_FLAG_RETURN_DATA)
-            msg->cb_data(GT_HTTP(self), data, length, NULL, msg->udata);
-        else
-            RETURN_IF_REACHED();
+        bytes = g_bytes_new(data, length);
+
+        call_bytes_cb(self, msg, bytes);
     }
 }
 
@@ -285,7 +420,8 @@ download_response(GtHTTPSoup* self, GInputStream* istream, SoupCallbackData* msg
                 "Content length '%ld' greater than buffer size, not downloading response", msg->content_length);
             WARNING("%s", err->message);
 
-            CALL_ERROR_CB(msg, err);
+            call_error_cb(self, msg, err);
+            soup_callback_data_free(msg);
 
             return;
         }
@@ -295,46 +431,149 @@ download_response(GtHTTPSoup* self, GInputStream* istream, SoupCallbackData* msg
     }
     else
     {
-        g_autoptr(GError) err = NULL;
-        g_autoptr(GInputStream) fistream = gt_cache_get_data_stream(priv->cache, msg->uri, &err);
+        GList* subs = take_subscribers(msg);
 
         DEBUG("Cache hit for '%s'", msg->uri);
 
-        if (err)
+        /* NOTE: Every subscriber reads the cached file on its own */
+        for (GList* l = subs; l != NULL; l = l->next)
         {
-            g_prefix_error(&err, "Couldn't get data stream for cached file because: ");
-            WARNING("%s", err->message);
+            SoupSubscriber* sub = l->data;
+            g_autoptr(GError) err = NULL;
+            g_autoptr(GInputStream) fistream = NULL;
 
-            CALL_ERROR_CB(msg, err);
-        }
-        else
-        {
-            if (msg->flags & GT_HTTP_FLAG_RETURN_STREAM)
-                msg->cb_stream(GT_HTTP(self), g_steal_pointer(&fistream), NULL, msg->udata);
             /* TODO: Implement returning data here */
+            if (!(sub->flags & GT_HTTP_FLAG_RETURN_STREAM))
+            {
+                g_set_error(&err, GT_HTTP_ERROR, GT_HTTP_ERROR_UNKNOWN,
+                    "Returning cached data for '%s' isn't supported", msg->uri);
+                WARNING("%s", err->message);
+
+                call_subscriber_error_cb(self, sub, err);
+
+                continue;
+            }
+
+            fistream = gt_cache_get_data_stream(priv->cache, msg->uri, &err);
+
+            if (err)
+            {
+                g_prefix_error(&err, "Couldn't get data stream for cached file because: ");
+                WARNING("%s", err->message);
+
+                call_subscriber_error_cb(self, sub, err);
+            }
             else
-                RETURN_IF_REACHED();
-            soup_callback_data_free(msg);
+                sub->cb_stream(GT_HTTP(self), fistream, NULL, sub->udata);
         }
+
+        g_list_free_full(subs, (GDestroyNotify) soup_subscriber_free);
+        soup_callback_data_free(msg);
     }
 }
 
+static void
+read_response_cb(GObject* source,
+    GAsyncResult* res, gpointer udata)
+{
+    RETURN_IF_FAIL(G_IS_MEMORY_OUTPUT_STREAM(source));
+    RETURN_IF_FAIL(G_IS_ASYNC_RESULT(res));
+    RETURN_IF_FAIL(udata != NULL);
+
+    g_autoptr(SoupCallbackData) msg = udata;
+    g_autoptr(GtHTTPSoup) self = g_weak_ref_get(msg->self);
+    g_autoptr(GBytes) bytes = NULL;
+    g_autoptr(GError) err = NULL;
 
-/* NOTE: This function is to remove a message from the queue if it has
- * been cancelled but not sent yet */
+    if (!self) { TRACE("Unreffed while waiting"); return; }
+
+    g_output_stream_splice_finish(G_OUTPUT_STREAM(source), res, &err);
+
+    if (err)
+    {
+        if (!g_error_matches(err, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        {
+            g_prefix_error(&err, "Unable to read response from '%s' because: ", msg->uri);
+
+            WARNING("%s", err->message);
+        }
+
+        call_error_cb(self, msg, err);
+
+        return;
+    }
+
+    bytes = g_memory_output_stream_steal_as_bytes(G_MEMORY_OUTPUT_STREAM(source));
+
+    call_bytes_cb(self, msg, bytes);
+}
+
+/* NOTE: Reads the whole response so it can be handed to every
+ * subscriber of a shared request */
+static void
+read_response(GtHTTPSoup* self, GInputStream* istream, SoupCallbackData* msg)
+{
+    g_autoptr(GOutputStream) output = g_memory_output_stream_new_resizable();
+
+    g_output_stream_splice_async(output, istream,
+        G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE | G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+        G_PRIORITY_DEFAULT, msg->cancel, read_response_cb, msg);
+}
+
+static gboolean
+msg_cancelled_idle_cb(gpointer udata)
+{
+    g_autoptr(SoupSubscriber) sub = udata;
+    g_autoptr(GtHTTPSoup) self = g_weak_ref_get(sub->self);
+    g_autoptr(GError) err = NULL;
+
+    if (sub->cancel_cb_id > 0)
+        g_cancellable_disconnect(sub->cancel, sub->cancel_cb_id);
+    sub->cancel_cb_id = 0;
+
+    if (!self) {TRACE("Unreffed"); return G_SOURCE_REMOVE;}
+
+    g_set_error(&err, G_IO_ERROR, G_IO_ERROR_CANCELLED, "Cancelled");
+
+    call_subscriber_error_cb(self, sub, err);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* NOTE: This function is to detach a subscriber from its request when
+ * it's cancelled. The callback is still called so that whoever is
+ * waiting on it, like a GTask, gets to finish. It's called from an idle
+ * as the handler can't disconnect itself. The request itself is only
+ * dropped, or cancelled if already sent, once nobody is left waiting on
+ * it, so cancelling one caller doesn't affect the others sharing it */
 static void
 msg_cancelled_cb(GCancellable* cancel, gpointer udata)
 {
     RETURN_IF_FAIL(udata != NULL);
 
-    SoupCallbackData* data = udata;
-    g_autoptr(GtHTTPSoup) self = g_weak_ref_get(data->self);
+    SoupSubscriber* sub = udata;
+    SoupCallbackData* msg = sub->msg;
+    g_autoptr(GtHTTPSoup) self = g_weak_ref_get(sub->self);
 
     if (!self) {TRACE("Unreffed"); return;}
+    if (!msg) {TRACE("Already called back"); return;}
 
     GtHTTPSoupPrivate* priv = gt_http_soup_get_instance_private(self);
 
-    g_queue_remove(priv->message_queue, data);
+    msg->subscribers = g_list_remove(msg->subscribers, sub);
+    sub->msg = NULL;
+
+    g_idle_add(msg_cancelled_idle_cb, sub);
+
+    if (msg->subscribers)
+        return;
+
+    forget_request(self, msg);
+
+    if (g_queue_remove(priv->message_queue, msg))
+        soup_callback_data_free(msg);
+    else
+        g_cancellable_cancel(msg->cancel);
 }
 
 static void
@@ -356,14 +595,17 @@ soup_message_cb(GObject* source,
 
     decrement_inflight_for_category(self, msg->category);
 
+    /* NOTE: The response is being handed out now, anyone asking for
+     * it from here on gets a new request */
+    forget_request(self, msg);
+
     istream = soup_session_send_finish(priv->soup, res, &err);
 
-    /* NOTE: Manually handle cancelled request here */
+    /* NOTE: Everyone waiting on this request has been cancelled and
+     * already called back */
     if (g_cancellable_is_cancelled(msg->cancel))
     {
-        g_set_error(&err, G_IO_ERROR, G_IO_ERROR_CANCELLED, "Cancelled");
-
-        CALL_ERROR_CB(msg, err);
+        TRACE("Dropping response from '%s' as it was cancelled", msg->uri);
 
         goto send_next_message;
     }
@@ -378,7 +620,7 @@ soup_message_cb(GObject* source,
             WARNING("%s", err->message);
         }
 
-        CALL_ERROR_CB(msg, err);
+        call_error_cb(self, msg, err);
 
         goto send_next_message;
     }
@@ -400,7 +642,7 @@ soup_message_cb(GObject* source,
 
         WARNING("%s", err->message);
 
-        CALL_ERROR_CB(msg, err);
+        call_error_cb(self, msg, err);
 
         goto send_next_message;
     }
@@ -411,8 +653,18 @@ soup_message_cb(GObject* source,
         msg->content_length = soup_message_headers_get_content_length(msg->soup_message->response_headers);
         download_response(self, istream, g_steal_pointer(&msg));
     }
-    else if (msg->flags & GT_HTTP_FLAG_RETURN_STREAM)
-        msg->cb_stream(GT_HTTP(self), istream, NULL, msg->udata);
+    else if (msg->subscribers && msg->subscribers->next)
+        read_response(self, istream, g_steal_pointer(&msg));
+    else if (msg->subscribers)
+    {
+        g_autoptr(SoupSubscriber) sub = NULL;
+        GList* subs = take_subscribers(msg);
+
+        sub = subs->data;
+        g_list_free(subs);
+
+        sub->cb_stream(GT_HTTP(self), istream, NULL, sub->udata);
+    }
 
 send_next_message:
     send_next_message(self);
@@ -440,10 +692,10 @@ send_next_message(GtHTTPSoup* self)
 
     if (next_msg)
     {
-        g_cancellable_disconnect(next_msg->cancel, next_msg->cancel_cb_id);
-
         increment_inflight_for_category(self, next_msg->category);
 
+        priv->requests_sent++;
+
         /* NOTE: Cancelling a async request will cause SoupSession to
          * segfault so we don't allow cancelling here. Instead we will
          * handle it manually
@@ -455,6 +707,8 @@ send_next_message(GtHTTPSoup* self)
     }
 }
 
+/* NOTE: Identical requests made while one is queued or in flight share
+ * it instead of being sent again, see SoupCallbackData */
 static void
 get_with_category(GtHTTP* http, const gchar* uri, const gchar* category, gchar** headers,
     GCancellable* cancel, GCallback cb, gpointer udata, gint flags)
@@ -462,35 +716,63 @@ get_with_category(GtHTTP* http, const gchar* uri, const gchar* category, gchar**
     RETURN_IF_FAIL(GT_HTTP_SOUP(http));
     RETURN_IF_FAIL(!utils_str_empty(uri));
     RETURN_IF_FAIL(!utils_str_empty(category));
-    RETURN_IF_FAIL(flags != 0);
+    RETURN_IF_FAIL(flags & (GT_HTTP_FLAG_RETURN_STREAM | GT_HTTP_FLAG_RETURN_DATA));
 
     GtHTTPSoup* self = GT_HTTP_SOUP(http);
     GtHTTPSoupPrivate* priv = gt_http_soup_get_instance_private(self);
 
-    g_autoptr(SoupMessage) soup_msg = NULL;
-    g_autoptr(SoupCallbackData) data = NULL;
+    g_autofree gchar* req_key = request_key(uri, headers, flags);
+    SoupSubscriber* sub = soup_subscriber_new(self, cancel, cb, udata, flags);
+    SoupCallbackData* msg = NULL; /* NOTE: Owned by the queue or the table */
+    gboolean send = FALSE;
 
-    soup_msg = soup_message_new(SOUP_METHOD_GET, uri);
-
-    for (guint i = 0; ; i += 2)
+    if (cancel && g_cancellable_is_cancelled(cancel))
     {
-        const gchar* key = headers[i];
+        g_idle_add(msg_cancelled_idle_cb, sub);
+        return;
+    }
 
-        if (!key) break;
+    msg = g_hash_table_lookup(priv->pending_table, req_key);
 
-        const gchar* val = headers[i+1];
+    if (msg)
+    {
+        priv->requests_coalesced++;
 
-        soup_message_headers_append(soup_msg->request_headers, key, val);
+        DEBUG("Joining request to '%s', '%u' of '%u' requests saved",
+            uri, priv->requests_coalesced, priv->requests_sent + priv->requests_coalesced);
     }
+    else
+    {
+        g_autoptr(SoupMessage) soup_msg = soup_message_new(SOUP_METHOD_GET, uri);
 
-    data = soup_callback_data_new(self, soup_msg,
-        category, cancel, cb, udata, flags);
+        for (guint i = 0; ; i += 2)
+        {
+            const gchar* key = headers[i];
 
-    data->cancel_cb_id = g_cancellable_connect(cancel, G_CALLBACK(msg_cancelled_cb), data, NULL);
+            if (!key) break;
 
-    g_queue_push_tail(priv->message_queue, g_steal_pointer(&data));
+            const gchar* val = headers[i+1];
 
-    send_next_message(self);
+            soup_message_headers_append(soup_msg->request_headers, key, val);
+        }
+
+        msg = soup_callback_data_new(self, soup_msg, req_key, category);
+
+        g_hash_table_insert(priv->pending_table, msg->key, msg);
+        g_queue_push_tail(priv->message_queue, msg);
+
+        send = TRUE;
+    }
+
+    msg->flags |= flags;
+    msg->subscribers = g_list_append(msg->subscribers, sub);
+    sub->msg = msg;
+
+    if (cancel)
+        sub->cancel_cb_id = g_cancellable_connect(cancel, G_CALLBACK(msg_cancelled_cb), sub, NULL);
+
+    if (send)
+        send_next_message(self);
 }
 
 static void
@@ -510,6 +792,7 @@ dispose(GObject* obj)
 
     g_object_unref(priv->soup);
     g_hash_table_unref(priv->inflight_table);
+    g_hash_table_unref(priv->pending_table);
     g_object_unref(priv->cache);
 
     G_OBJECT_CLASS(gt_http_soup_parent_class)->dispose(obj);
@@ -548,6 +831,12 @@ get_property(GObject* obj,
         case PROP_CACHE_DIRECTORY:
             g_value_set_string(val, priv->cache_directory);
             break;
+        case PROP_REQUESTS_SENT:
+            g_value_set_uint(val, priv->requests_sent);
+            break;
+        case PROP_REQUESTS_COALESCED:
+            g_value_set_uint(val, priv->requests_coalesced);
+            break;
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop, pspec);
     }
@@ -606,6 +895,17 @@ gt_http_soup_class_init(GtHTTPSoupClass* klass)
         "Cache directory", "Directory where cached files should be placed",
         default_cache_directory, G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
 
+    props[PROP_REQUESTS_SENT] = g_param_spec_uint("requests-sent",
+        "Requests sent", "Number of requests that were sent",
+        0, G_MAXUINT, 0, G_PARAM_READABLE);
+
+    props[PROP_REQUESTS_COALESCED] = g_param_spec_uint("requests-coalesced",
+        "Requests coalesced", "Number of requests that shared one already queued or in flight instead of being sent",
+        0, G_MAXUINT, 0, G_PARAM_READABLE);
+
+    g_object_class_install_property(obj_class, PROP_REQUESTS_SENT, props[PROP_REQUESTS_SENT]);
+    g_object_class_install_property(obj_class, PROP_REQUESTS_COALESCED, props[PROP_REQUESTS_COALESCED]);
+
     g_object_class_override_property(obj_class, PROP_MAX_INFLIGHT_PER_CATEGORY, "max-inflight-per-category");
     g_object_class_override_property(obj_class, PROP_CACHE_DIRECTORY, "cache-directory");
 }
@@ -618,6 +918,7 @@ gt_http_soup_init(GtHTTPSoup* self)
     priv->soup = soup_session_new();
     priv->message_queue = g_queue_new();
     priv->inflight_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    priv->pending_table = g_hash_table_new(g_str_hash, g_str_equal); /* NOTE: Keys are owned by the requests */
     priv->cache = GT_CACHE(gt_cache_file_new()); /* TODO: Use libpeas to load this dynamically */
 }
 
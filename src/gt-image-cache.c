@@ -0,0 +1,220 @@
+/*
+ *  This file is part of GNOME Twitch - 'Enjoy Twitch on your GNU/Linux desktop'
+ *  Copyright © 2017 Vincent Szolnoky <vinszent@vinszent.com>
+ *
+ *  GNOME Twitch is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GNOME Twitch is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNOME Twitch. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gt-image-cache.h"
+
+#define TAG "GtImageCache"
+#include "gnome-twitch/gt-log.h"
+
+/* NOTE: Entries of evicted images are kept only if the image is on
+ * disk, they're small next to the decoded pixels */
+typedef struct
+{
+    gchar* key;
+    gchar* filename; // NULL if the image isn't on disk
+    GdkPixbuf* pixbuf; // NULL once evicted
+    gsize bytes;
+    GList link; // In the LRU queue while resident
+} CacheEntry;
+
+struct _GtImageCache
+{
+    GMutex mutex;
+    GHashTable* table;
+    GQueue lru; // Resident entries, most recently used first
+    gsize budget;
+    gsize resident_bytes;
+    guint64 hits;
+    guint64 disk_hits;
+    guint64 misses;
+    guint64 evictions;
+};
+
+static void
+cache_entry_free(CacheEntry* entry)
+{
+    g_free(entry->key);
+    g_free(entry->filename);
+    g_clear_object(&entry->pixbuf);
+    g_slice_free(CacheEntry, entry);
+}
+
+static void
+evict(GtImageCache* cache)
+{
+    /* NOTE: The most recently used image is kept even if it doesn't
+     * fit on its own, it's about to be shown */
+    while (cache->resident_bytes > cache->budget && cache->lru.length > 1)
+    {
+        GList* link = cache->lru.tail;
+        CacheEntry* entry = link->data;
+
+        g_queue_unlink(&cache->lru, link);
+
+        TRACE("Evicting image '%s' of '%" G_GSIZE_FORMAT "' bytes", entry->key, entry->bytes);
+
+        cache->resident_bytes -= entry->bytes;
+        cache->evictions++;
+        entry->bytes = 0;
+        g_clear_object(&entry->pixbuf);
+
+        if (!entry->filename)
+            g_hash_table_remove(cache->table, entry->key);
+    }
+}
+
+GtImageCache*
+gt_image_cache_new(gsize budget)
+{
+    GtImageCache* cache = g_slice_new0(GtImageCache);
+
+    g_mutex_init(&cache->mutex);
+    g_queue_init(&cache->lru);
+    cache->table = g_hash_table_new_full(g_str_hash, g_str_equal,
+        NULL, (GDestroyNotify) cache_entry_free);
+    cache->budget = budget;
+
+    return cache;
+}
+
+void
+gt_image_cache_free(GtImageCache* cache)
+{
+    g_assert_nonnull(cache);
+
+    g_hash_table_unref(cache->table);
+    g_mutex_clear(&cache->mutex);
+    g_slice_free(GtImageCache, cache);
+}
+
+void
+gt_image_cache_set_budget(GtImageCache* cache, gsize budget)
+{
+    g_assert_nonnull(cache);
+
+    g_mutex_lock(&cache->mutex);
+
+    cache->budget = budget;
+    evict(cache);
+
+    g_mutex_unlock(&cache->mutex);
+}
+
+/* NOTE: Returns a new reference to the image if it's in memory. If
+ * it was evicted but is on disk, NULL is returned and filename is set
+ * to where it can be loaded from */
+GdkPixbuf*
+gt_image_cache_lookup(GtImageCache* cache, const gchar* key, gchar** filename)
+{
+    g_assert_nonnull(cache);
+    g_assert_nonnull(key);
+
+    GdkPixbuf* ret = NULL;
+    CacheEntry* entry;
+
+    g_mutex_lock(&cache->mutex);
+
+    entry = g_hash_table_lookup(cache->table, key);
+
+    if (entry && entry->pixbuf)
+    {
+        cache->hits++;
+
+        g_queue_unlink(&cache->lru, &entry->link);
+        g_queue_push_head_link(&cache->lru, &entry->link);
+
+        ret = g_object_ref(entry->pixbuf);
+    }
+    else if (entry)
+    {
+        cache->disk_hits++;
+
+        if (filename)
+            *filename = g_strdup(entry->filename);
+    }
+    else
+        cache->misses++;
+
+    g_mutex_unlock(&cache->mutex);
+
+    return ret;
+}
+
+/* NOTE: Filename is where the image is saved on disk, NULL if it
+ * isn't. Replaces any image already cached under key */
+void
+gt_image_cache_insert(GtImageCache* cache, const gchar* key,
+    GdkPixbuf* pixbuf, const gchar* filename)
+{
+    g_assert_nonnull(cache);
+    g_assert_nonnull(key);
+    g_assert(GDK_IS_PIXBUF(pixbuf));
+
+    CacheEntry* entry;
+
+    g_mutex_lock(&cache->mutex);
+
+    entry = g_hash_table_lookup(cache->table, key);
+
+    if (!entry)
+    {
+        entry = g_slice_new0(CacheEntry);
+        entry->key = g_strdup(key);
+        entry->link.data = entry;
+
+        g_hash_table_insert(cache->table, entry->key, entry);
+    }
+    else if (entry->pixbuf)
+    {
+        g_queue_unlink(&cache->lru, &entry->link);
+
+        cache->resident_bytes -= entry->bytes;
+        g_clear_object(&entry->pixbuf);
+    }
+
+    g_free(entry->filename);
+    entry->filename = g_strdup(filename);
+    entry->pixbuf = g_object_ref(pixbuf);
+    entry->bytes = gdk_pixbuf_get_byte_length(pixbuf);
+
+    g_queue_push_head_link(&cache->lru, &entry->link);
+    cache->resident_bytes += entry->bytes;
+
+    evict(cache);
+
+    g_mutex_unlock(&cache->mutex);
+}
+
+void
+gt_image_cache_get_stats(GtImageCache* cache, GtImageCacheStats* stats)
+{
+    g_assert_nonnull(cache);
+    g_assert_nonnull(stats);
+
+    g_mutex_lock(&cache->mutex);
+
+    stats->hits = cache->hits;
+    stats->disk_hits = cache->disk_hits;
+    stats->misses = cache->misses;
+    stats->evictions = cache->evictions;
+    stats->n_images = cache->lru.length;
+    stats->resident_bytes = cache->resident_bytes;
+    stats->budget = cache->budget;
+
+    g_mutex_unlock(&cache->mutex);
+}
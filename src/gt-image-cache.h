@@ -0,0 +1,55 @@
+/*
+ *  This file is part of GNOME Twitch - 'Enjoy Twitch on your GNU/Linux desktop'
+ *  Copyright © 2017 Vincent Szolnoky <vinszent@vinszent.com>
+ *
+ *  GNOME Twitch is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GNOME Twitch is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNOME Twitch. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GT_IMAGE_CACHE_H
+#define GT_IMAGE_CACHE_H
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+G_BEGIN_DECLS
+
+/* NOTE: A thread safe cache of decoded images with a memory budget in
+ * front of the images saved on disk. Once the budget is exceeded the
+ * least recently used images are dropped from memory, images that
+ * were saved to disk are remembered so they can be loaded from there
+ * again instead of the network */
+typedef struct _GtImageCache GtImageCache;
+
+typedef struct
+{
+    guint64 hits; // Found in memory
+    guint64 disk_hits; // Evicted but still on disk
+    guint64 misses;
+    guint64 evictions;
+    guint n_images; // Resident in memory
+    gsize resident_bytes;
+    gsize budget;
+} GtImageCacheStats;
+
+GtImageCache* gt_image_cache_new(gsize budget);
+void          gt_image_cache_free(GtImageCache* cache);
+void          gt_image_cache_set_budget(GtImageCache* cache, gsize budget);
+GdkPixbuf*    gt_image_cache_lookup(GtImageCache* cache, const gchar* key, gchar** filename);
+void          gt_image_cache_insert(GtImageCache* cache, const gchar* key, GdkPixbuf* pixbuf, const gchar* filename);
+void          gt_image_cache_get_stats(GtImageCache* cache, GtImageCacheStats* stats);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(GtImageCache, gt_image_cache_free);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,1018 @@
+/*
+ *  This file is part of GNOME Twitch - 'Enjoy Twitch on your GNU/Linux desktop'
+ *  Copyright © 2017 Vincent Szolnoky <vinszent@vinszent.com>
+ *
+ *  GNOME Twitch is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GNOME Twitch is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNOME Twitch. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* NOTE: Replays chat into a real GtIrc through a loopback server that
+ * speaks just enough of Twitch's IRC dialect to log in, join and
+ * ping. Reports the sustained dispatch rate, the latency from the
+ * server writing a message until it's dispatched on the main loop and
+ * the depth of the dispatch queue over time. With more than one
+ * channel the chat is spread over channels that are joined on top of
+ * the main one with gt_irc_add_channel, so they share its connection
+ * pair, and the count dispatched per channel is reported.
+ *
+ * Before replaying, the heap allocations it takes to parse the lines
+ * are counted, both with GtIrc's parser and with the parser it had
+ * before messages were parsed into a single block. Doesn't need a network
+ * connection, badges and emotes are stripped from the replayed lines
+ * as resolving them would hit the Twitch API. */
+
+#include <gtk/gtk.h>
+#include <string.h>
+#include <stdlib.h>
+#include <locale.h>
+#include "gt-app.h"
+#include "gt-irc.h"
+#include "utils.h"
+
+#define TAG "GtIrcBench"
+#include "gnome-twitch/gt-log.h"
+
+#define BENCH_CHANNEL "#bench"
+#define BENCH_ROOM_ID "1"
+#define PING_INTERVAL 1 // In seconds
+#define PACE_INTERVAL 1000 // In microseconds
+#define UNPACED_CHUNK 100
+#define SAMPLE_INTERVAL 100 // In milliseconds
+#define REPORT_INTERVAL 10 // In samples
+#define STALL_TIMEOUT 10 // In seconds
+#define ALLOC_ROUNDS 16 // Times the lines are parsed when counting allocations
+
+GtApp* main_app;
+gchar* ORIGINAL_LOCALE;
+
+static gchar* log_path = NULL;
+static gint rate = 2000;
+static gint count = 20000;
+static gint budget = 0;
+static gint queue_limit = -1;
+static gchar* policy = NULL;
+static gboolean shared_io = FALSE;
+static gint n_channels = 1;
+static gboolean verbose = FALSE;
+
+static GOptionEntry options[] =
+{
+    {"log", 'l', G_OPTION_FLAG_NONE, G_OPTION_ARG_FILENAME, &log_path, "Chat log of raw IRC lines to replay", "FILE"},
+    {"rate", 'r', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &rate, "Messages per second to replay, 0 for as fast as possible", "N"},
+    {"count", 'c', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &count, "Number of messages to replay", "N"},
+    {"dispatch-budget", 'b', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &budget, "Dispatch budget of GtIrc in milliseconds", "MS"},
+    {"queue-limit", 'q', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &queue_limit, "Queue limit of GtIrc, 0 for no limit", "N"},
+    {"overload-policy", 'p', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &policy, "Overload policy of GtIrc, one of drop-oldest, sample or collapse", "POLICY"},
+    {"shared-io", 's', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, &shared_io, "Read from the shared I/O thread instead of worker threads", NULL},
+    {"channels", 'n', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &n_channels, "Number of channels to spread the chat over, joined on one connection pair", "N"},
+    {"verbose", 'v', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, &verbose, "Print log messages from GtIrc", NULL},
+    {NULL}
+};
+
+static const gchar* synthetic_texts[] =
+{
+    "PogChamp",
+    "LUL that was close",
+    "is this the same run as yesterday?",
+    "gg",
+    "can someone explain what just happened, I was afk for a second and missed the whole thing",
+    "Kappa Kappa Kappa",
+    "first time catching the stream live, hello from the other side of the planet",
+    "!uptime",
+};
+
+typedef struct
+{
+    gchar* tags;
+    gchar* prefix;
+    gchar* text;
+} ReplayLine;
+
+/* NOTE: Emotes put back into the lines when counting allocations, so
+ * the emote lists are built as well */
+static const struct
+{
+    const gchar* code;
+    gint id;
+} alloc_emotes[] =
+{
+    {"Kappa", 25},
+    {"PogChamp", 88},
+    {"LUL", 425618},
+};
+
+typedef struct
+{
+    GOutputStream* ostream;
+    GMutex mutex;
+    gboolean tags;
+    gint joins;
+} BenchConnection;
+
+typedef struct
+{
+    GPtrArray* lines;
+    GPtrArray* joined;
+    GMutex mutex;
+    GThread* replay_thread;
+    gint joins;
+    gint connections;
+    gint sent;
+    gint pongs;
+} BenchServer;
+
+typedef struct _BenchStats BenchStats;
+
+typedef struct
+{
+    BenchStats* stats;
+    GtTwitchChatSource* source;
+    gint received;
+} BenchChannel;
+
+struct _BenchStats
+{
+    GMainLoop* loop;
+    GtIrc* irc;
+    BenchServer* server;
+    BenchChannel* channels; // The first one is the main channel
+    GArray* latencies;
+    GArray* depths;
+    gint64 first;
+    gint64 last;
+    gint64 last_progress;
+    gint received;
+    gint batches;
+    guint max_depth;
+};
+
+static void
+replay_line_free(ReplayLine* line)
+{
+    g_free(line->tags);
+    g_free(line->prefix);
+    g_free(line->text);
+    g_free(line);
+}
+
+/* NOTE: Keeps the tags of a recorded PRIVMSG except for the ones we
+ * need to control, anything that isn't a PRIVMSG is skipped */
+static ReplayLine*
+replay_line_new(const gchar* raw)
+{
+    g_autofree gchar* copy = g_strdup(raw);
+    gchar* line = g_strstrip(copy);
+    g_autoptr(GString) tags = g_string_new("badges=;emotes=;room-id=" BENCH_ROOM_ID);
+    ReplayLine* ret;
+    gchar* prefix;
+    gchar* text;
+
+    if (line[0] == '@')
+    {
+        gchar* section = strsep(&line, " ");
+        gchar* tag;
+
+        section++;
+
+        while ((tag = strsep(&section, ";")) != NULL)
+        {
+            if (g_str_has_prefix(tag, "badges=") ||
+                g_str_has_prefix(tag, "emotes=") ||
+                g_str_has_prefix(tag, "room-id=") ||
+                g_str_has_prefix(tag, "tmi-sent-ts=") ||
+                utils_str_empty(tag))
+            {
+                continue;
+            }
+
+            g_string_append_printf(tags, ";%s", tag);
+        }
+    }
+
+    if (!line || line[0] != ':')
+        return NULL;
+
+    line++;
+    prefix = strsep(&line, " ");
+
+    if (!line || !g_str_has_prefix(line, "PRIVMSG "))
+        return NULL;
+
+    if ((text = strstr(line, " :")) == NULL)
+        return NULL;
+
+    ret = g_new(ReplayLine, 1);
+    ret->tags = g_string_free(g_steal_pointer(&tags), FALSE);
+    ret->prefix = g_strdup(prefix);
+    ret->text = g_strdup(text + 2);
+
+    return ret;
+}
+
+static GPtrArray*
+load_lines(const gchar* path, GError** error)
+{
+    GPtrArray* ret = g_ptr_array_new_with_free_func((GDestroyNotify) replay_line_free);
+    ReplayLine* line;
+
+    if (path)
+    {
+        g_autofree gchar* contents = NULL;
+        g_auto(GStrv) raw_lines = NULL;
+
+        if (!g_file_get_contents(path, &contents, NULL, error))
+        {
+            g_ptr_array_unref(ret);
+
+            return NULL;
+        }
+
+        raw_lines = g_strsplit(contents, "\n", -1);
+
+        for (gchar** l = raw_lines; *l != NULL; l++)
+        {
+            if ((line = replay_line_new(*l)) != NULL)
+                g_ptr_array_add(ret, line);
+        }
+    }
+    else
+    {
+        for (guint i = 0; i < 64; i++)
+        {
+            g_autofree gchar* raw = g_strdup_printf(
+                "@badges=;color=#%06X;display-name=Bench%u;emotes=;id=%08x-bench;mod=0;room-id=" BENCH_ROOM_ID
+                ";subscriber=%u;tmi-sent-ts=0;turbo=0;user-id=%u;user-type= "
+                ":bench%u!bench%u@bench%u.tmi.twitch.tv PRIVMSG " BENCH_CHANNEL " :%s",
+                g_random_int_range(0, 0xFFFFFF), i, g_random_int(), i % 2, 1000 + i,
+                i, i, i, synthetic_texts[i % G_N_ELEMENTS(synthetic_texts)]);
+
+            g_ptr_array_add(ret, replay_line_new(raw));
+        }
+    }
+
+    return ret;
+}
+
+#ifdef __GLIBC__
+
+/* NOTE: Replaces the allocator functions of the whole process to
+ * count the calls made by a thread while it has counting switched
+ * on, G_SLICE=always-malloc makes GSlice go through them too */
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t n, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+
+static __thread gboolean counting_allocs = FALSE;
+static __thread guint64 n_allocs = 0;
+
+void*
+malloc(size_t size)
+{
+    if (counting_allocs) n_allocs++;
+
+    return __libc_malloc(size);
+}
+
+void*
+calloc(size_t n, size_t size)
+{
+    if (counting_allocs) n_allocs++;
+
+    return __libc_calloc(n, size);
+}
+
+void*
+realloc(void* ptr, size_t size)
+{
+    if (counting_allocs) n_allocs++;
+
+    return __libc_realloc(ptr, size);
+}
+
+#define HAVE_ALLOC_COUNTING 1
+
+#endif
+
+/* NOTE: The message GtIrc parsed lines into before they were carved
+ * out of a single block, only PRIVMSGs are handled */
+typedef struct
+{
+    gchar* line;
+    gchar* nick;
+    gchar* user;
+    gchar* host;
+    GtIrcCommandPrivmsg* cmd; // Only allocated, the fields below were in it
+    gchar* target;
+    gchar* msg;
+    gchar* colour;
+    gchar* display_name;
+    GList* badges;
+    GList* emotes;
+} LegacyPrivmsg;
+
+/* NOTE: Stands in for the tag index, which never allocated */
+static const gchar*
+legacy_get_tag(gchar** keys, gchar** values, guint n_tags, const gchar* key)
+{
+    for (guint i = 0; i < n_tags; i++)
+    {
+        if (g_strcmp0(keys[i], key) == 0)
+            return values[i];
+    }
+
+    return NULL;
+}
+
+static void
+legacy_privmsg_free(LegacyPrivmsg* msg)
+{
+    g_free(msg->line);
+    g_free(msg->nick);
+    g_free(msg->user);
+    g_free(msg->host);
+    g_free(msg->cmd);
+    g_free(msg->target);
+    g_free(msg->msg);
+    g_free(msg->colour);
+    g_free(msg->display_name);
+    g_list_free(msg->badges);
+    gt_chat_emote_list_free(msg->emotes);
+    g_free(msg);
+}
+
+/* NOTE: The allocations of the old parser without the badge and emote
+ * lookups, which the lines don't need. The line is copied first like
+ * reading it from the data input stream used to */
+static LegacyPrivmsg*
+legacy_parse_line(const gchar* raw, gsize len)
+{
+    LegacyPrivmsg* msg = g_new0(LegacyPrivmsg, 1);
+    gchar* keys[32];
+    gchar* values[32];
+    guint n_tags = 0;
+    gchar* line = msg->line = g_strndup(raw, len);
+    gchar* prefix;
+    gchar* tag;
+
+    if (line[0] == '@')
+    {
+        gchar* section;
+
+        line++;
+        section = strsep(&line, " ");
+
+        while ((tag = strsep(&section, ";")) != NULL && n_tags < G_N_ELEMENTS(keys))
+        {
+            keys[n_tags] = strsep(&tag, "=");
+            values[n_tags] = tag;
+            n_tags++;
+        }
+    }
+
+    if (line[0] == ':')
+    {
+        line++;
+        prefix = strsep(&line, " ");
+
+        if (g_strrstr(prefix, "!"))
+            msg->nick = g_strdup(strsep(&prefix, "!"));
+        if (g_strrstr(prefix, "@"))
+            msg->user = g_strdup(strsep(&prefix, "@"));
+
+        msg->host = g_strdup(prefix);
+    }
+
+    strsep(&line, " "); // Command
+
+    msg->cmd = g_new0(GtIrcCommandPrivmsg, 1);
+    msg->target = g_strdup(strsep(&line, " "));
+    strsep(&line, ":");
+    msg->msg = g_strdup(line);
+
+    gchar** badgesv = g_strsplit(legacy_get_tag(keys, values, n_tags, "badges"), ",", -1);
+
+    for (gchar** c = badgesv; *c != NULL; c++)
+    {
+        gchar** badgev = g_strsplit(*c, "/", -1);
+
+        g_strfreev(badgev);
+    }
+
+    g_strfreev(badgesv);
+
+    msg->colour = g_strdup(legacy_get_tag(keys, values, n_tags, "color"));
+    msg->display_name = g_strdup(legacy_get_tag(keys, values, n_tags, "display-name"));
+
+    gchar* emotes = g_strdup(legacy_get_tag(keys, values, n_tags, "emotes"));
+    gchar* _emotes = emotes;
+    gchar* e;
+
+    while ((e = strsep(&emotes, "/")) != NULL)
+    {
+        gint id;
+        gchar* indexes;
+        gchar* i;
+
+        id = atoi(strsep(&e, ":"));
+        indexes = strsep(&e, ":");
+
+        while ((i = strsep(&indexes, ",")) != NULL)
+        {
+            GtChatEmote* emp = gt_chat_emote_new();
+            emp->start = atoi(strsep(&i, "-"));
+            emp->end = atoi(strsep(&i, "-"));
+            emp->id = id;
+
+            msg->emotes = g_list_append(msg->emotes, emp);
+        }
+    }
+
+    g_free(_emotes);
+
+    return msg;
+}
+
+/* NOTE: Like a line replayed to a connection with tags, but with the
+ * emotes in the text marked */
+static gchar*
+alloc_line_new(ReplayLine* line)
+{
+    g_autoptr(GString) emotes = g_string_new(NULL);
+    g_autoptr(GString) ret = g_string_new(NULL);
+
+    for (guint i = 0; i < G_N_ELEMENTS(alloc_emotes); i++)
+    {
+        gsize len = strlen(alloc_emotes[i].code);
+        gboolean first = TRUE;
+
+        for (const gchar* c = strstr(line->text, alloc_emotes[i].code); c;
+             c = strstr(c + len, alloc_emotes[i].code))
+        {
+            if (first)
+            {
+                g_string_append_printf(emotes, "%s%d:", emotes->len > 0 ? "/" : "", alloc_emotes[i].id);
+                first = FALSE;
+            }
+            else
+                g_string_append_c(emotes, ',');
+
+            g_string_append_printf(emotes, "%ld-%ld",
+                (glong) (c - line->text), (glong) (c - line->text + len - 1));
+        }
+    }
+
+    /* NOTE: The tags always start with empty badges and emotes */
+    g_string_printf(ret, "@badges=;emotes=%s;%s;tmi-sent-ts=0 :%s PRIVMSG " BENCH_CHANNEL " :%s",
+        emotes->str, line->tags + strlen("badges=;emotes=;"), line->prefix, line->text);
+
+    return g_string_free(g_steal_pointer(&ret), FALSE);
+}
+
+static void
+count_allocs(GtIrc* irc, GPtrArray* lines)
+{
+#ifdef HAVE_ALLOC_COUNTING
+    g_autoptr(GPtrArray) raw = g_ptr_array_new_with_free_func(g_free);
+    guint64 legacy = 0;
+    guint64 current = 0;
+    guint64 n = 0;
+
+    for (guint i = 0; i < lines->len; i++)
+        g_ptr_array_add(raw, alloc_line_new(g_ptr_array_index(lines, i)));
+
+    for (gint round = 0; round < ALLOC_ROUNDS; round++)
+    {
+        for (guint i = 0; i < raw->len; i++)
+        {
+            const gchar* line = g_ptr_array_index(raw, i);
+            gsize len = strlen(line);
+            LegacyPrivmsg* legacy_msg;
+            GtIrcMessage* msg;
+
+            n_allocs = 0;
+            counting_allocs = TRUE;
+            legacy_msg = legacy_parse_line(line, len);
+            counting_allocs = FALSE;
+            legacy += n_allocs;
+
+            n_allocs = 0;
+            counting_allocs = TRUE;
+            msg = gt_irc_message_parse(irc, line, len);
+            counting_allocs = FALSE;
+            current += n_allocs;
+
+            legacy_privmsg_free(legacy_msg);
+            gt_irc_message_free(msg);
+
+            n++;
+        }
+    }
+
+    g_print("Allocs per message: %.2f before single block parsing, %.2f now\n",
+        (gdouble) legacy / n, (gdouble) current / n);
+#else
+    g_print("Allocs per message: not counted, needs glibc\n");
+#endif
+}
+
+static gchar*
+channel_name(gint i)
+{
+    return i == 0 ? g_strdup(BENCH_CHANNEL) : g_strdup_printf(BENCH_CHANNEL "%d", i);
+}
+
+static gboolean
+connection_write(BenchConnection* conn, const gchar* data, gsize len)
+{
+    gboolean ret;
+
+    g_mutex_lock(&conn->mutex);
+    ret = g_output_stream_write_all(conn->ostream, data, len, NULL, NULL, NULL);
+    g_mutex_unlock(&conn->mutex);
+
+    return ret;
+}
+
+static void
+connection_printf(BenchConnection* conn, const gchar* format, ...)
+{
+    g_autofree gchar* data = NULL;
+    va_list args;
+
+    va_start(args, format);
+    data = g_strdup_vprintf(format, args);
+    va_end(args);
+
+    connection_write(conn, data, strlen(data));
+}
+
+/* NOTE: Like Twitch, every joined connection gets the chat and only
+ * the ones that requested tags get them */
+static gpointer
+replay_thread_func(BenchServer* server)
+{
+    g_autoptr(GString) tagged = g_string_new(NULL);
+    g_autoptr(GString) plain = g_string_new(NULL);
+    g_autoptr(GPtrArray) channels = g_ptr_array_new_with_free_func(g_free);
+    gint64 start = g_get_monotonic_time();
+    gint64 last_ping = start;
+    gint sent = 0;
+
+    for (gint i = 0; i < n_channels; i++)
+        g_ptr_array_add(channels, channel_name(i));
+
+    while (sent < count)
+    {
+        gint64 now = g_get_monotonic_time();
+        gint due;
+
+        if (rate > 0)
+            due = MIN(count, (now - start)*rate/G_USEC_PER_SEC + 1);
+        else
+            due = MIN(count, sent + UNPACED_CHUNK);
+
+        g_string_truncate(tagged, 0);
+        g_string_truncate(plain, 0);
+
+        for (; sent < due; sent++)
+        {
+            ReplayLine* line = g_ptr_array_index(server->lines, sent % server->lines->len);
+            const gchar* chan = g_ptr_array_index(channels, sent % n_channels);
+
+            g_string_append_printf(tagged, "@%s;tmi-sent-ts=%" G_GINT64_FORMAT " :%s PRIVMSG %s :%s\r\n",
+                line->tags, g_get_monotonic_time(), line->prefix, chan, line->text);
+            g_string_append_printf(plain, ":%s PRIVMSG %s :%s\r\n",
+                line->prefix, chan, line->text);
+        }
+
+        if (now - last_ping >= PING_INTERVAL*G_USEC_PER_SEC)
+        {
+            g_string_append(tagged, "PING :tmi.twitch.tv\r\n");
+            g_string_append(plain, "PING :tmi.twitch.tv\r\n");
+
+            last_ping = now;
+        }
+
+        for (guint i = 0; i < server->joined->len; i++)
+        {
+            BenchConnection* conn = g_ptr_array_index(server->joined, i);
+            GString* data = conn->tags ? tagged : plain;
+
+            if (data->len > 0 && !connection_write(conn, data->str, data->len))
+            {
+                WARNING("Unable to write to client, stopping replay");
+
+                return NULL;
+            }
+        }
+
+        g_atomic_int_set(&server->sent, sent);
+
+        if (rate > 0)
+            g_usleep(PACE_INTERVAL);
+    }
+
+    return NULL;
+}
+
+static void
+handle_client_line(BenchServer* server, BenchConnection* conn, const gchar* line)
+{
+    if (g_str_has_prefix(line, "NICK "))
+    {
+        const gchar* nick = line + strlen("NICK ");
+
+        connection_printf(conn,
+            ":tmi.twitch.tv 001 %s :Welcome, GLHF!\r\n"
+            ":tmi.twitch.tv 002 %s :Your host is tmi.twitch.tv\r\n"
+            ":tmi.twitch.tv 003 %s :This server is rather new\r\n"
+            ":tmi.twitch.tv 004 %s :-\r\n"
+            ":tmi.twitch.tv 375 %s :-\r\n"
+            ":tmi.twitch.tv 372 %s :You are in a maze of twisty passages, all alike.\r\n"
+            ":tmi.twitch.tv 376 %s :>\r\n",
+            nick, nick, nick, nick, nick, nick, nick);
+    }
+    else if (g_str_has_prefix(line, "CAP REQ :"))
+    {
+        const gchar* cap = line + strlen("CAP REQ :");
+
+        if (g_strcmp0(cap, "twitch.tv/tags") == 0)
+            conn->tags = TRUE;
+
+        connection_printf(conn, ":tmi.twitch.tv CAP * ACK :%s\r\n", cap);
+    }
+    else if (g_str_has_prefix(line, "JOIN "))
+    {
+        const gchar* chan = line + strlen("JOIN ");
+
+        connection_printf(conn, ":justinfan!justinfan@justinfan.tmi.twitch.tv JOIN %s\r\n", chan);
+
+        if (conn->tags)
+        {
+            connection_printf(conn, "@broadcaster-lang=;emote-only=0;followers-only=-1;r9k=0;rituals=0;room-id="
+                BENCH_ROOM_ID ";slow=0;subs-only=0 :tmi.twitch.tv ROOMSTATE %s\r\n", chan);
+        }
+
+        /* NOTE: GtIrc always opens a receive and a send connection,
+         * start replaying once both have joined every channel */
+        g_mutex_lock(&server->mutex);
+
+        if (conn->joins++ == 0)
+            g_ptr_array_add(server->joined, conn);
+
+        if (++server->joins == 2*n_channels)
+            server->replay_thread = g_thread_new("gt-irc-bench-replay", (GThreadFunc) replay_thread_func, server);
+
+        g_mutex_unlock(&server->mutex);
+    }
+    else if (g_str_has_prefix(line, "PONG"))
+        g_atomic_int_inc(&server->pongs);
+}
+
+static gboolean
+connection_run_cb(GThreadedSocketService* service,
+    GSocketConnection* connection, GObject* source, gpointer udata)
+{
+    BenchServer* server = udata;
+    g_autoptr(GDataInputStream) istream = NULL;
+    BenchConnection* conn;
+    gchar* line;
+
+    g_atomic_int_inc(&server->connections);
+
+    /* NOTE: Leaked on purpose, the replay thread might still be
+     * writing to it after the client has gone */
+    conn = g_new0(BenchConnection, 1);
+    conn->ostream = g_object_ref(g_io_stream_get_output_stream(G_IO_STREAM(connection)));
+    g_mutex_init(&conn->mutex);
+    g_object_ref(connection);
+
+    istream = g_data_input_stream_new(g_io_stream_get_input_stream(G_IO_STREAM(connection)));
+    g_data_input_stream_set_newline_type(istream, G_DATA_STREAM_NEWLINE_TYPE_CR_LF);
+
+    while ((line = g_data_input_stream_read_line(istream, NULL, NULL, NULL)) != NULL)
+    {
+        handle_client_line(server, conn, line);
+
+        g_free(line);
+    }
+
+    return TRUE;
+}
+
+static gboolean batch_cb(GPtrArray* msgs, gpointer udata);
+
+/* NOTE: Extra channels are joined on the main one's connection pair */
+static void
+state_cb(GObject* source,
+    GParamSpec* pspec, gpointer udata)
+{
+    GtIrc* irc = GT_IRC(source);
+    BenchStats* stats = udata;
+
+    if (gt_irc_get_state(irc) != GT_IRC_STATE_LOGGED_IN)
+        return;
+
+    gt_irc_join(irc, BENCH_CHANNEL);
+
+    for (gint i = 1; i < n_channels; i++)
+    {
+        g_autofree gchar* name = channel_name(i);
+        BenchChannel* chan = &stats->channels[i];
+
+        chan->source = gt_irc_add_channel(irc, name + 1, NULL);
+
+        g_source_set_callback((GSource*) chan->source, (GSourceFunc) batch_cb, chan, NULL);
+    }
+}
+
+static guint
+total_shed(BenchStats* stats)
+{
+    guint ret = 0;
+
+    for (gint i = 0; i < n_channels; i++)
+    {
+        if (stats->channels[i].source)
+            ret += gt_twitch_chat_source_get_shed_messages(stats->channels[i].source);
+    }
+
+    return ret;
+}
+
+static guint
+total_queue_length(BenchStats* stats)
+{
+    guint ret = 0;
+
+    for (gint i = 0; i < n_channels; i++)
+    {
+        if (stats->channels[i].source)
+            ret += gt_twitch_chat_source_get_queue_length(stats->channels[i].source);
+    }
+
+    return ret;
+}
+
+static gboolean
+batch_cb(GPtrArray* msgs, gpointer udata)
+{
+    BenchChannel* chan = udata;
+    BenchStats* stats = chan->stats;
+    gint64 now = g_get_monotonic_time();
+
+    for (guint i = 0; i < msgs->len; i++)
+    {
+        GtIrcMessage* msg = g_ptr_array_index(msgs, i);
+        const gchar* ts;
+        gint64 latency;
+
+        if (msg->cmd_type != GT_IRC_COMMAND_PRIVMSG)
+            continue;
+
+        if ((ts = gt_irc_message_get_tag(msg, GT_IRC_TAG_TMI_SENT_TS)) == NULL)
+            continue;
+
+        if (stats->received == 0)
+            stats->first = now;
+
+        latency = now - g_ascii_strtoll(ts, NULL, 10);
+
+        g_array_append_val(stats->latencies, latency);
+
+        stats->last = now;
+        stats->last_progress = now;
+        stats->received++;
+        chan->received++;
+    }
+
+    stats->batches++;
+
+    /* NOTE: Messages shed by the queue never make it here */
+    if (stats->received + total_shed(stats) >= (guint) count)
+        g_main_loop_quit(stats->loop);
+
+    return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+sample_cb(gpointer udata)
+{
+    BenchStats* stats = udata;
+    guint depth = total_queue_length(stats);
+
+    g_array_append_val(stats->depths, depth);
+    stats->max_depth = MAX(stats->max_depth, depth);
+
+    if (stats->depths->len % REPORT_INTERVAL == 0)
+    {
+        g_print("t=%5.1fs sent=%-8d dispatched=%-8d queue=%u\n",
+            stats->depths->len*SAMPLE_INTERVAL/1000.0,
+            g_atomic_int_get(&stats->server->sent), stats->received, depth);
+    }
+
+    if (g_get_monotonic_time() - stats->last_progress > STALL_TIMEOUT*G_USEC_PER_SEC)
+    {
+        g_printerr("No messages dispatched for %d seconds, giving up\n", STALL_TIMEOUT);
+
+        g_main_loop_quit(stats->loop);
+
+        return G_SOURCE_REMOVE;
+    }
+
+    return G_SOURCE_CONTINUE;
+}
+
+static gint
+compare_int64(const gint64* a, const gint64* b)
+{
+    return *a < *b ? -1 : *a > *b;
+}
+
+static void
+log_cb(const gchar* domain, GLogLevelFlags level,
+    const gchar* msg, gpointer udata)
+{
+    if (verbose || level <= G_LOG_LEVEL_WARNING ||
+        (level >= 1 << G_LOG_LEVEL_USER_SHIFT && level <= GT_LOG_LEVEL_WARNING))
+    {
+        g_printerr("%s\n", msg);
+    }
+}
+
+int
+main(int argc, char** argv)
+{
+    g_autoptr(GOptionContext) ctx = NULL;
+    g_autoptr(GSocketService) service = NULL;
+    g_autoptr(GSocketAddress) addr = NULL;
+    g_autoptr(GSocketAddress) bound = NULL;
+    g_autoptr(GError) err = NULL;
+    g_autofree gchar* rate_str = NULL;
+    BenchServer server = {0};
+    BenchStats stats = {0};
+    gdouble elapsed;
+    guint64 depth_sum = 0;
+    guint n;
+
+    ctx = g_option_context_new("- replay chat into GtIrc over loopback");
+    g_option_context_add_main_entries(ctx, options, NULL);
+
+    if (!g_option_context_parse(ctx, &argc, &argv, &err))
+    {
+        g_printerr("%s\n", err->message);
+
+        return EXIT_FAILURE;
+    }
+
+    count = MAX(count, 1);
+    n_channels = MAX(n_channels, 1);
+
+    g_log_set_default_handler((GLogFunc) log_cb, NULL);
+
+    /* NOTE: Keep the benchmark away from the user's settings */
+    g_setenv("GSETTINGS_BACKEND", "memory", TRUE);
+    g_setenv("G_SLICE", "always-malloc", TRUE);
+
+    ORIGINAL_LOCALE = g_strdup(setlocale(LC_NUMERIC, NULL));
+
+    main_app = gt_app_new();
+    main_app->twitch = gt_twitch_new();
+
+    server.lines = load_lines(log_path, &err);
+
+    if (err)
+    {
+        g_printerr("Unable to load chat log: %s\n", err->message);
+
+        return EXIT_FAILURE;
+    }
+
+    if (server.lines->len == 0)
+    {
+        g_printerr("No PRIVMSG lines to replay in '%s'\n", log_path);
+
+        return EXIT_FAILURE;
+    }
+
+    server.joined = g_ptr_array_new();
+    g_mutex_init(&server.mutex);
+
+    service = g_threaded_socket_service_new(4);
+    addr = g_inet_socket_address_new_from_string("127.0.0.1", 0);
+
+    if (!g_socket_listener_add_address(G_SOCKET_LISTENER(service), addr,
+            G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_TCP, NULL, &bound, &err))
+    {
+        g_printerr("Unable to listen on loopback: %s\n", err->message);
+
+        return EXIT_FAILURE;
+    }
+
+    g_signal_connect(service, "run", G_CALLBACK(connection_run_cb), &server);
+    g_socket_service_start(service);
+
+    stats.loop = g_main_loop_new(NULL, FALSE);
+    stats.server = &server;
+    stats.latencies = g_array_sized_new(FALSE, FALSE, sizeof(gint64), count);
+    stats.depths = g_array_new(FALSE, FALSE, sizeof(guint));
+    stats.last_progress = g_get_monotonic_time();
+    stats.irc = gt_irc_new();
+    stats.channels = g_new0(BenchChannel, n_channels);
+
+    for (gint i = 0; i < n_channels; i++)
+        stats.channels[i].stats = &stats;
+
+    stats.channels[0].source = stats.irc->source;
+
+    if (budget > 0)
+        g_object_set(stats.irc, "dispatch-budget", budget, NULL);
+
+    g_object_set(stats.irc, "shared-io", shared_io, NULL);
+
+    if (queue_limit >= 0)
+        g_object_set(stats.irc, "queue-limit", queue_limit, NULL);
+
+    if (policy)
+    {
+        GEnumClass* enum_class = g_type_class_ref(GT_TYPE_IRC_OVERLOAD_POLICY);
+        GEnumValue* value = g_enum_get_value_by_nick(enum_class, policy);
+
+        if (!value)
+        {
+            g_printerr("Unknown overload policy '%s'\n", policy);
+
+            return EXIT_FAILURE;
+        }
+
+        g_object_set(stats.irc, "overload-policy", value->value, NULL);
+
+        g_type_class_unref(enum_class);
+    }
+
+    g_signal_connect(stats.irc, "notify::state", G_CALLBACK(state_cb), &stats);
+    g_source_set_callback((GSource*) stats.irc->source, (GSourceFunc) batch_cb, &stats.channels[0], NULL);
+
+    g_timeout_add(SAMPLE_INTERVAL, sample_cb, &stats);
+
+    count_allocs(stats.irc, server.lines);
+
+    rate_str = rate > 0 ? g_strdup_printf("%d msgs/s", rate) : g_strdup("full speed");
+
+    g_print("Replaying %d messages at %s from %u distinct lines over %d channels\n",
+        count, rate_str, server.lines->len, n_channels);
+
+    gt_irc_connect(stats.irc, "127.0.0.1",
+        g_inet_socket_address_get_port(G_INET_SOCKET_ADDRESS(bound)), NULL, NULL);
+
+    g_main_loop_run(stats.loop);
+
+    if (stats.latencies->len == 0)
+    {
+        g_printerr("No messages were dispatched\n");
+
+        return EXIT_FAILURE;
+    }
+
+    g_array_sort(stats.latencies, (GCompareFunc) compare_int64);
+
+    for (guint i = 0; i < stats.depths->len; i++)
+        depth_sum += g_array_index(stats.depths, guint, i);
+
+    n = stats.latencies->len;
+    elapsed = (gdouble) (stats.last - stats.first) / G_USEC_PER_SEC;
+
+    g_print("\n");
+    g_print("Dispatched:         %d/%d messages in %d batches\n", stats.received, count, stats.batches);
+    g_print("Sustained rate:     %.0f msgs/s\n", elapsed > 0 ? stats.received / elapsed : 0);
+    g_print("Latency p50:        %.3f ms\n", g_array_index(stats.latencies, gint64, n*50/100) / 1000.0);
+    g_print("Latency p99:        %.3f ms\n", g_array_index(stats.latencies, gint64, MIN(n - 1, n*99/100)) / 1000.0);
+    g_print("Latency max:        %.3f ms\n", g_array_index(stats.latencies, gint64, n - 1) / 1000.0);
+    g_print("Queue depth mean:   %.1f\n", stats.depths->len > 0 ? (gdouble) depth_sum / stats.depths->len : 0);
+    g_print("Queue depth max:    %u\n", stats.max_depth);
+    g_print("Shed:               %u\n", total_shed(&stats));
+    g_print("Pongs:              %d\n", g_atomic_int_get(&server.pongs));
+    g_print("Connections:        %d\n", g_atomic_int_get(&server.connections));
+
+    for (gint i = 0; n_channels > 1 && i < n_channels; i++)
+    {
+        g_autofree gchar* name = channel_name(i);
+
+        g_print("Dispatched %-8s %d\n", name, stats.channels[i].received);
+    }
+
+    g_socket_service_stop(service);
+
+    return stats.received + total_shed(&stats) >= (guint) count
+        ? EXIT_SUCCESS : EXIT_FAILURE;
+}
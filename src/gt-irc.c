@@ -59,6 +59,18 @@
 
 #define CR_LF "\r\n"
 
+#define DEFAULT_DISPATCH_BUDGET 4 // In milliseconds
+#define MAX_DISPATCH_BATCH 500
+#define DEFAULT_QUEUE_LIMIT 1000
+#define MAX_QUEUE_LIMIT 100000
+#define SAMPLE_STRIDE 4
+#define READ_BUFFER_SIZE 65536
+#define DEFAULT_IDLE_TIMEOUT 60 // In seconds
+#define DEFAULT_HISTORY_SIZE 200 // In lines
+#define DEFAULT_HISTORY_MEMORY 256 // In KiB
+#define MAX_HISTORY_CHANNELS 16
+#define BADGE_FIELD_MAX 64
+
 #define GT_IRC_ERROR g_quark_from_static_string("gt-irc-error")
 
 enum
@@ -78,8 +90,29 @@ typedef struct
     GThread* worker_thread_recv;
     GThread* worker_thread_send;
 
+    /* NOTE: Used instead of the worker threads when shared_io is set */
+    gboolean shared_io;
+    GSource* watch_recv;
+    GSource* watch_send;
+
     GtChannel* chan;
 
+    /* NOTE: While released the connections stay logged in without a
+     * channel until the idle timeout expires */
+    gint idle_timeout;
+    guint idle_source;
+    gchar* oauth_token;
+
+    /* NOTE: Raw lines recently received per channel, keyed by
+     * '#name', replayed when the channel is joined again */
+    GHashTable* history;
+    GMutex history_mutex;
+    gint history_size;
+    gint history_memory;
+
+    /* NOTE: Channels joined on top of chan, keyed by '#name' */
+    GHashTable* channels;
+
     GtIrcState state;
     gboolean recv_logged_in;
     gboolean send_logged_in;
@@ -91,7 +124,17 @@ struct _GtTwitchChatSource
 {
     GSource parent_instance;
     GAsyncQueue* queue;
-    gboolean resetting_queue;
+
+    gint64 budget;
+    gdouble msg_cost; // Running average of dispatch time per message in microseconds
+
+    GPtrArray* backlog; // Dispatched in one go ahead of the queue
+
+    guint limit; // High-water mark of the queue, 0 for unbounded
+    GtIrcOverloadPolicy policy;
+    guint sampled;
+    guint skipped;
+    gint shed;
 };
 
 typedef struct
@@ -99,14 +142,65 @@ typedef struct
     GtIrc* self;
     GDataInputStream* istream;
     GOutputStream* ostream;
+
+    gchar* buf;
+    gsize size;
+    gsize fill;
 } ChatThreadData;
 
+typedef struct
+{
+    gchar* name; // With the leading '#'
+    gchar* room_id;
+    GtTwitchChatSource* source;
+    gboolean joined;
+} IrcChannel;
+
+typedef struct
+{
+    gchar** lines;
+    guint capacity;
+    guint head; // Index of the oldest line
+    guint len;
+    gsize bytes;
+    gint64 last_used;
+} IrcHistory;
+
+typedef struct
+{
+    GtIrcMessage msg;
+    union
+    {
+        GtIrcCommandNotice notice;
+        GtIrcCommandPrivmsg privmsg;
+        GtIrcCommandPing ping;
+        GtIrcCommandJoin join;
+        GtIrcCommandPart part;
+        GtIrcCommandCap cap;
+        GtIrcCommandReply reply;
+        GtIrcCommandChannelMode chan_mode;
+        GtIrcCommandUserstate userstate;
+        GtIrcCommandRoomstate roomstate;
+        GtIrcCommandClearchat clearchat;
+        GtIrcCommandSkipped skipped;
+    } cmd;
+    gchar line[];
+} GtIrcMessageBlock;
+
 G_DEFINE_TYPE_WITH_PRIVATE(GtIrc, gt_irc, G_TYPE_OBJECT)
 
 enum
 {
     PROP_0,
     PROP_STATE,
+    PROP_DISPATCH_BUDGET,
+    PROP_QUEUE_LIMIT,
+    PROP_OVERLOAD_POLICY,
+    PROP_SHED_MESSAGES,
+    PROP_SHARED_IO,
+    PROP_IDLE_TIMEOUT,
+    PROP_HISTORY_SIZE,
+    PROP_HISTORY_MEMORY,
     NUM_PROPS
 };
 
@@ -140,38 +234,91 @@ gt_irc_state_get_type()
     return type;
 }
 
+static const GEnumValue gt_irc_overload_policy_enum_values[] =
+{
+    {GT_IRC_OVERLOAD_POLICY_DROP_OLDEST, "GT_IRC_OVERLOAD_POLICY_DROP_OLDEST", "drop-oldest"},
+    {GT_IRC_OVERLOAD_POLICY_SAMPLE, "GT_IRC_OVERLOAD_POLICY_SAMPLE", "sample"},
+    {GT_IRC_OVERLOAD_POLICY_COLLAPSE, "GT_IRC_OVERLOAD_POLICY_COLLAPSE", "collapse"},
+    {0, NULL, NULL},
+};
+
+GType
+gt_irc_overload_policy_get_type()
+{
+    static GType type = 0;
+
+    if (!type)
+        type = g_enum_register_static("GtIrcOverloadPolicy", gt_irc_overload_policy_enum_values);
+
+    return type;
+}
+
 static gboolean
 source_prepare(GSource* source,
                gint* timeout)
 {
     GtTwitchChatSource* self = (GtTwitchChatSource*) source;
-    gint len = 0;
-
-    if (!self->resetting_queue)
-        len = g_async_queue_length_unlocked(self->queue);
 
-    return len > 0;
+    return self->backlog || g_async_queue_length_unlocked(self->queue) > 0;
 }
 
+/* NOTE: Hands the callback as many messages as we expect it to get
+ * through within the time budget, going by how long previous batches
+ * took per message */
 static gboolean
 source_dispatch(GSource* source,
                 GSourceFunc callback,
                 gpointer udata)
 {
     GtTwitchChatSource* self = (GtTwitchChatSource*) source;
+    g_autoptr(GPtrArray) batch = NULL;
     GtIrcMessage* msg;
+    guint batch_size;
+    gint64 start;
+    gboolean ret;
 
-    msg = g_async_queue_try_pop(self->queue);
+    g_async_queue_lock(self->queue);
+    batch = self->backlog;
+    self->backlog = NULL;
+    g_async_queue_unlock(self->queue);
 
-    if (!msg)
-        return TRUE;
     if (!callback)
     {
-        gt_irc_message_free(msg);
+        while ((msg = g_async_queue_try_pop(self->queue)) != NULL)
+            gt_irc_message_free(msg);
+
         return TRUE;
     }
 
-    return ((GtTwitchChatSourceFunc) callback)(msg, udata);
+    /* NOTE: The backlog is handed over whole so it's rendered before
+     * any live messages */
+    if (batch)
+        return ((GtTwitchChatSourceBatchFunc) callback)(batch, udata);
+
+    batch_size = self->msg_cost > 0 ? self->budget / self->msg_cost : 1;
+    batch_size = CLAMP(batch_size, 1, MAX_DISPATCH_BATCH);
+
+    batch = g_ptr_array_new_full(batch_size, (GDestroyNotify) gt_irc_message_free);
+
+    while (batch->len < batch_size &&
+        (msg = g_async_queue_try_pop(self->queue)) != NULL)
+    {
+        g_ptr_array_add(batch, msg);
+    }
+
+    if (batch->len == 0)
+        return TRUE;
+
+    start = g_get_monotonic_time();
+
+    ret = ((GtTwitchChatSourceBatchFunc) callback)(batch, udata);
+
+    if (self->msg_cost > 0)
+        self->msg_cost = 0.8*self->msg_cost + 0.2*(g_get_monotonic_time() - start) / batch->len;
+    else
+        self->msg_cost = (gdouble) (g_get_monotonic_time() - start) / batch->len;
+
+    return ret;
 }
 
 static void
@@ -180,6 +327,7 @@ source_finalise(GSource* source)
     GtTwitchChatSource* self = (GtTwitchChatSource*) source;
 
     g_async_queue_unref(self->queue);
+    g_clear_pointer(&self->backlog, g_ptr_array_unref);
 
     g_print("Cleanup source\n");
 }
@@ -203,10 +351,170 @@ gt_twitch_chat_source_new()
     g_source_set_name(source, "GtTwitchChatSource");
 
     ((GtTwitchChatSource*) source)->queue = g_async_queue_new_full((GDestroyNotify) gt_irc_message_free);
+    ((GtTwitchChatSource*) source)->budget = DEFAULT_DISPATCH_BUDGET*G_TIME_SPAN_MILLISECOND;
+    ((GtTwitchChatSource*) source)->msg_cost = 0;
+    ((GtTwitchChatSource*) source)->limit = DEFAULT_QUEUE_LIMIT;
+    ((GtTwitchChatSource*) source)->policy = GT_IRC_OVERLOAD_POLICY_DROP_OLDEST;
 
     return (GtTwitchChatSource*) source;
 }
 
+static const gchar* message_channel(GtIrcMessage* msg);
+
+static GtIrcMessage*
+skipped_message_new(const gchar* channel, guint count)
+{
+    gsize len = channel ? strlen(channel) : 0;
+    GtIrcMessageBlock* block = g_malloc0(sizeof(GtIrcMessageBlock) + len + 1);
+
+    if (channel)
+        memcpy(block->line, channel, len);
+
+    block->msg.cmd_type = GT_IRC_COMMAND_SKIPPED;
+    block->msg.cmd.skipped = &block->cmd.skipped;
+    block->cmd.skipped.channel = block->line;
+    block->cmd.skipped.count = count;
+
+    return &block->msg;
+}
+
+/* NOTE: Called with the queue locked when it's at the high-water
+ * mark, returns the message to push in its place if any */
+static GtIrcMessage*
+shed_message(GtTwitchChatSource* self, GtIrcMessage* msg, guint len)
+{
+    GtIrcMessage* oldest;
+
+    switch (self->policy)
+    {
+        case GT_IRC_OVERLOAD_POLICY_DROP_OLDEST:
+            oldest = g_async_queue_try_pop_unlocked(self->queue);
+
+            /* NOTE: Don't lose anything that changes the state of
+             * the chat, drop the new line instead */
+            if (oldest->cmd_type != GT_IRC_COMMAND_PRIVMSG)
+            {
+                g_async_queue_push_front_unlocked(self->queue, oldest);
+                oldest = msg;
+                msg = NULL;
+            }
+
+            gt_irc_message_free(oldest);
+            break;
+        case GT_IRC_OVERLOAD_POLICY_SAMPLE:
+            /* NOTE: Let every few lines through until the queue is
+             * twice the mark, which keeps it bounded */
+            if (len < 2*self->limit && ++self->sampled % SAMPLE_STRIDE == 0)
+                return msg;
+
+            gt_irc_message_free(msg);
+            msg = NULL;
+            break;
+        case GT_IRC_OVERLOAD_POLICY_COLLAPSE:
+            self->skipped++;
+
+            gt_irc_message_free(msg);
+            msg = NULL;
+            break;
+        default:
+            g_assert_not_reached();
+    }
+
+    g_atomic_int_inc(&self->shed);
+
+    return msg;
+}
+
+/* NOTE: Only chat lines are shed, anything else changes the state of
+ * the chat and is always queued */
+static void
+gt_twitch_chat_source_push(GtTwitchChatSource* self, GtIrcMessage* msg)
+{
+    GMainContext* ctx;
+    gint len;
+
+    g_async_queue_lock(self->queue);
+
+    len = g_async_queue_length_unlocked(self->queue);
+
+    if (self->limit > 0 && len >= (gint) self->limit &&
+        msg->cmd_type == GT_IRC_COMMAND_PRIVMSG)
+    {
+        msg = shed_message(self, msg, len);
+    }
+
+    if (msg)
+    {
+        if (self->skipped > 0)
+        {
+            g_async_queue_push_unlocked(self->queue,
+                skipped_message_new(message_channel(msg), self->skipped));
+
+            self->skipped = 0;
+        }
+
+        g_async_queue_push_unlocked(self->queue, msg);
+    }
+
+    g_async_queue_unlock(self->queue);
+
+    /* NOTE: Only the first message needs to wake up the main loop,
+     * the rest are picked up by the same dispatch */
+    if (len == 0 && msg &&
+        (ctx = g_source_get_context((GSource*) self)) != NULL)
+    {
+        g_main_context_wakeup(ctx);
+    }
+}
+
+guint
+gt_twitch_chat_source_get_shed_messages(GtTwitchChatSource* self)
+{
+    return g_atomic_int_get(&self->shed);
+}
+
+static void
+gt_twitch_chat_source_reset(GtTwitchChatSource* self)
+{
+    GtIrcMessage* msg;
+
+    g_async_queue_lock(self->queue);
+
+    while ((msg = g_async_queue_try_pop_unlocked(self->queue)) != NULL)
+        gt_irc_message_free(msg);
+
+    g_clear_pointer(&self->backlog, g_ptr_array_unref);
+    self->skipped = 0;
+
+    g_async_queue_unlock(self->queue);
+}
+
+static void
+gt_twitch_chat_source_set_backlog(GtTwitchChatSource* self, GPtrArray* backlog)
+{
+    GMainContext* ctx;
+
+    g_async_queue_lock(self->queue);
+
+    if (self->backlog)
+        g_ptr_array_unref(self->backlog);
+
+    self->backlog = backlog;
+
+    g_async_queue_unlock(self->queue);
+
+    if ((ctx = g_source_get_context((GSource*) self)) != NULL)
+        g_main_context_wakeup(ctx);
+}
+
+guint
+gt_twitch_chat_source_get_queue_length(GtTwitchChatSource* self)
+{
+    gint len = g_async_queue_length(self->queue);
+
+    return MAX(len, 0);
+}
+
 static void
 send_raw_printf(GOutputStream* ostream, const gchar* format, ...)
 {
@@ -349,6 +657,113 @@ chat_reply_str_to_enum(const gchar* str_reply)
     return ret;
 }
 
+static const struct
+{
+    const gchar* name;
+    gsize len;
+} irc_tag_names[GT_IRC_TAG_COUNT] =
+{
+#define TAG_NAME(str) {str, sizeof(str) - 1}
+    [GT_IRC_TAG_BADGES]       = TAG_NAME("badges"),
+    [GT_IRC_TAG_COLOUR]       = TAG_NAME("color"),
+    [GT_IRC_TAG_DISPLAY_NAME] = TAG_NAME("display-name"),
+    [GT_IRC_TAG_EMOTES]       = TAG_NAME("emotes"),
+    [GT_IRC_TAG_EMOTE_SETS]   = TAG_NAME("emote-sets"),
+    [GT_IRC_TAG_ID]           = TAG_NAME("id"),
+    [GT_IRC_TAG_MOD]          = TAG_NAME("mod"),
+    [GT_IRC_TAG_ROOM_ID]      = TAG_NAME("room-id"),
+    [GT_IRC_TAG_SUBSCRIBER]   = TAG_NAME("subscriber"),
+    [GT_IRC_TAG_TMI_SENT_TS]  = TAG_NAME("tmi-sent-ts"),
+    [GT_IRC_TAG_TURBO]        = TAG_NAME("turbo"),
+    [GT_IRC_TAG_USER_ID]      = TAG_NAME("user-id"),
+    [GT_IRC_TAG_USER_TYPE]    = TAG_NAME("user-type"),
+#undef TAG_NAME
+};
+
+static inline gint
+irc_tag_lookup(const gchar* key, gsize len)
+{
+    for (gint i = 0; i < GT_IRC_TAG_COUNT; i++)
+    {
+        if (irc_tag_names[i].len == len && memcmp(irc_tag_names[i].name, key, len) == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+/* NOTE: Splits the tag section in a single pass without copying,
+ * keys and values are terminated in place and unknown tags are
+ * skipped */
+static void
+parse_tags(GtIrcTags* tags, gchar* section)
+{
+    gchar* c = section;
+
+    while (*c)
+    {
+        gchar* key = c;
+        gchar* val = NULL;
+        gboolean escaped = FALSE;
+        gsize key_len;
+        gint slot;
+
+        while (*c && *c != '=' && *c != ';') c++;
+
+        key_len = c - key;
+
+        if (*c == '=')
+        {
+            *c++ = '\0';
+            val = c;
+
+            for (; *c && *c != ';'; c++)
+                if (*c == '\\') escaped = TRUE;
+        }
+
+        if (*c == ';')
+            *c++ = '\0';
+
+        slot = irc_tag_lookup(key, key_len);
+
+        if (slot < 0)
+            continue;
+
+        /* NOTE: A key without a value points at its own terminator */
+        tags->values[slot] = val ? val : key + key_len;
+
+        if (escaped)
+            tags->escaped |= 1 << slot;
+    }
+}
+
+static void
+unescape_tag_value(gchar* val)
+{
+    gchar* w = val;
+
+    for (const gchar* r = val; *r; r++)
+    {
+        if (*r != '\\')
+        {
+            *w++ = *r;
+            continue;
+        }
+
+        switch (*++r)
+        {
+            case ':': *w++ = ';'; break;
+            case 's': *w++ = ' '; break;
+            case 'r': *w++ = '\r'; break;
+            case 'n': *w++ = '\n'; break;
+            case '\0': r--; break;
+            default: *w++ = *r; break;
+        }
+    }
+
+    *w = '\0';
+}
+
 gint
 emote_compare(const GtChatEmote* a, const GtChatEmote* b)
 {
@@ -392,13 +807,21 @@ strsep(stringp, delim)
 #endif
 
 
+/* NOTE: The message, its command and every string it points to are
+ * carved out of a single block which holds a copy of the line, so
+ * parsing only has to split the copy in place */
 static GtIrcMessage*
-parse_line(GtIrc* self, gchar* line)
+parse_line(GtIrc* self, const gchar* raw, gsize len)
 {
     GtIrcPrivate* priv = gt_irc_get_instance_private(self);
-    gchar* orig = line;
+    GtIrcMessageBlock* block = g_malloc(sizeof(GtIrcMessageBlock) + len + 1);
+    GtIrcMessage* msg = &block->msg;
+    gchar* line = block->line;
     gchar* prefix = NULL;
-    GtIrcMessage* msg = g_new0(GtIrcMessage, 1);
+
+    memset(block, 0, sizeof(GtIrcMessageBlock));
+    memcpy(line, raw, len);
+    line[len] = '\0';
 
     TRACEF("Received line='%s'", line);
 
@@ -407,7 +830,8 @@ parse_line(GtIrc* self, gchar* line)
     if (line[0] == '@')
     {
         line = line+1;
-        msg->tags = g_strsplit_set(strsep(&line, " "), ";=", -1);
+        parse_tags(&msg->tags, strsep(&line, " "));
+        msg->tags.buf = block->line;
     }
 
     if (line[0] == ':')
@@ -416,11 +840,11 @@ parse_line(GtIrc* self, gchar* line)
         prefix = strsep(&line, " ");
 
         if (g_strrstr(prefix, "!"))
-            msg->nick = g_strdup(strsep(&prefix, "!"));
+            msg->nick = strsep(&prefix, "!");
         if (g_strrstr(prefix, "@"))
-            msg->user = g_strdup(strsep(&prefix, "@"));
+            msg->user = strsep(&prefix, "@");
 
-        msg->host = g_strdup(prefix);
+        msg->host = prefix;
     }
 
     gchar* cmd = strsep(&line, " ");
@@ -429,17 +853,17 @@ parse_line(GtIrc* self, gchar* line)
     switch (msg->cmd_type)
     {
         case GT_IRC_COMMAND_REPLY:
-            msg->cmd.reply = g_new0(GtIrcCommandReply, 1);
+            msg->cmd.reply = &block->cmd.reply;
             msg->cmd.reply->type = chat_reply_str_to_enum(cmd);
-            msg->cmd.reply->reply = g_strdup(line);
+            msg->cmd.reply->reply = line;
             break;
         case GT_IRC_COMMAND_PING:
-            msg->cmd.ping = g_new0(GtIrcCommandPing, 1);
-            msg->cmd.ping->server = g_strdup(line);
+            msg->cmd.ping = &block->cmd.ping;
+            msg->cmd.ping->server = line;
             break;
         case GT_IRC_COMMAND_PRIVMSG:
-            msg->cmd.privmsg = g_new0(GtIrcCommandPrivmsg, 1);
-            msg->cmd.privmsg->target = g_strdup(strsep(&line, " "));
+            msg->cmd.privmsg = &block->cmd.privmsg;
+            msg->cmd.privmsg->target = strsep(&line, " ");
             strsep(&line, ":");
 
             if (line[0] == '\001')
@@ -448,19 +872,21 @@ parse_line(GtIrc* self, gchar* line)
                 line[strlen(line) - 1] = '\0';
             }
 
-            msg->cmd.privmsg->msg = g_strdup(line);
+            msg->cmd.privmsg->msg = line;
 
-            if (!msg->tags)
+            if (!msg->tags.buf)
                 break;
 
             gint user_modes = 0;
+            const gchar* subscriber = gt_irc_message_get_tag(msg, GT_IRC_TAG_SUBSCRIBER);
+            const gchar* turbo = gt_irc_message_get_tag(msg, GT_IRC_TAG_TURBO);
 
-            if (atoi(utils_search_key_value_strv(msg->tags, "subscriber")))
+            if (subscriber && atoi(subscriber))
                 user_modes |= IRC_USER_MODE_SUBSCRIBER;
-            if (atoi(utils_search_key_value_strv(msg->tags, "turbo")))
+            if (turbo && atoi(turbo))
                 user_modes |= IRC_USER_MODE_TURBO;
 
-            const gchar* user_type = utils_search_key_value_strv(msg->tags, "user-type");
+            const gchar* user_type = gt_irc_message_get_tag(msg, GT_IRC_TAG_USER_TYPE);
             if (g_strcmp0(user_type, "mod") == 0) user_modes |= IRC_USER_MODE_MOD;
             else if (g_strcmp0(user_type, "global_mod") == 0) user_modes |= IRC_USER_MODE_GLOBAL_MOD;
             else if (g_strcmp0(user_type, "admin") == 0) user_modes |= IRC_USER_MODE_ADMIN;
@@ -468,134 +894,227 @@ parse_line(GtIrc* self, gchar* line)
 
             msg->cmd.privmsg->user_modes = user_modes;
 
-            const gchar* badges = utils_search_key_value_strv(msg->tags, "badges");
+            const gchar* badges = gt_irc_message_get_tag(msg, GT_IRC_TAG_BADGES);
+            const gchar* room_id = gt_irc_message_get_tag(msg, GT_IRC_TAG_ROOM_ID);
 
-            g_assert_nonnull(badges);
+            /* NOTE: Only the main channel's id is known here, lines for
+             * extra channels without one are shown without badges */
+            if (utils_str_empty(room_id) && priv->chan && msg->cmd.privmsg->target[0] == '#' &&
+                g_strcmp0(msg->cmd.privmsg->target + 1, gt_channel_get_name(priv->chan)) == 0)
+            {
+                room_id = gt_channel_get_id(priv->chan);
+            }
 
-            gchar** badgesv = g_strsplit(badges, ",", -1);
+            g_assert_nonnull(badges);
 
-            for (gchar** c = badgesv; *c != NULL; c++)
+            /* NOTE: Badges look like 'name/version,name/version', they
+             * can't be looked up without the channel */
+            for (const gchar* b = badges; *b && !utils_str_empty(room_id); )
             {
-                gchar** badgev = g_strsplit(*c, "/", -1);
-                const gchar* name = *badgev;
-                const gchar* version = *(badgev+1);
-                g_autoptr(GError) err = NULL;
+                gchar name[BADGE_FIELD_MAX];
+                gchar version[BADGE_FIELD_MAX];
+                gsize name_len = strcspn(b, "/,");
+                gsize version_len = 0;
 
-                GtChatBadge* badge = gt_twitch_fetch_chat_badge(main_app->twitch,
-                    gt_channel_get_id(priv->chan), name, version, &err);
+                if (b[name_len] == '/')
+                    version_len = strcspn(b + name_len + 1, ",");
 
-                if (err)
+                if (name_len == 0 || version_len == 0 ||
+                    name_len >= BADGE_FIELD_MAX || version_len >= BADGE_FIELD_MAX)
                 {
-                    WARNING("Unable to add chat badge because: %s", err->message);
-
-                    g_error_free(err);
-                    err = NULL;
-
-                    g_autoptr(GtkIconInfo) icon_info;
+                    WARNINGF("Skipping malformed badges '%s'", badges);
+                    break;
+                }
 
-                    icon_info = gtk_icon_theme_lookup_icon(gtk_icon_theme_get_default(),
-                        "software-update-urgent-symbolic", 1, 0);
+                memcpy(name, b, name_len);
+                name[name_len] = '\0';
+                memcpy(version, b + name_len + 1, version_len);
+                version[version_len] = '\0';
 
-                    badge = gt_chat_badge_new();
-                    badge->pixbuf = gtk_icon_info_load_icon(icon_info, &err);
+                b += name_len + 1 + version_len;
+                if (*b == ',') b++;
 
-                    //NOTE: At this point we're fucked, maybe we can just set an empty icon?
-                    if (err)
-                        badge->pixbuf = NULL;
-                }
+                /* NOTE: Only looked up, badges of channels whose sets
+                 * aren't loaded yet are filled in later */
+                GtChatBadge* badge = gt_twitch_lookup_chat_badge(main_app->twitch,
+                    room_id, name, version);
 
-                msg->cmd.privmsg->badges = g_list_append(msg->cmd.privmsg->badges, badge);
+                if (!badge)
+                    continue;
 
-                g_strfreev(badgev);
+                msg->cmd.privmsg->badges = g_list_prepend(msg->cmd.privmsg->badges, badge);
             }
 
-            g_strfreev(badgesv);
+            msg->cmd.privmsg->badges = g_list_reverse(msg->cmd.privmsg->badges);
 
-            msg->cmd.privmsg->colour = g_strdup(utils_search_key_value_strv(msg->tags, "color"));
-            msg->cmd.privmsg->display_name = g_strdup(utils_search_key_value_strv(msg->tags, "display-name"));
+            msg->cmd.privmsg->colour = gt_irc_message_get_tag(msg, GT_IRC_TAG_COLOUR);
+            msg->cmd.privmsg->display_name = gt_irc_message_get_tag(msg, GT_IRC_TAG_DISPLAY_NAME);
 
-            gchar* emotes = g_strdup(utils_search_key_value_strv(msg->tags, "emotes"));
-            gchar* _emotes = emotes;
-            gchar* e;
+            /* NOTE: Emotes look like 'id:start-end,start-end/id:start-end' */
+            const gchar* emotes = gt_irc_message_get_tag(msg, GT_IRC_TAG_EMOTES);
 
-            while ((e = strsep(&emotes, "/")) != NULL)
+            for (const gchar* e = emotes; e && *e; )
             {
+                gchar* end;
                 gint id;
-                gchar* indexes;
-                gchar* i;
 
-                id = atoi(strsep(&e, ":"));
-                indexes = strsep(&e, ":");
+                id = strtol(e, &end, 10);
 
-                while ((i = strsep(&indexes, ",")) != NULL)
+                if (end == e || *end != ':')
+                    break;
+
+                e = end + 1;
+
+                for (;;)
                 {
-                    GdkPixbuf* pixbuf = NULL;
-                    GtChatEmote* emp = gt_chat_emote_new();
-                    emp->start = atoi(strsep(&i, "-"));
-                    emp->end = atoi(strsep(&i, "-"));
+                    GtChatEmote* emp;
+                    gint start;
+
+                    start = strtol(e, &end, 10);
+
+                    if (end == e || *end != '-')
+                        break;
+
+                    emp = gt_chat_emote_new();
+                    emp->start = start;
+                    emp->end = strtol(end + 1, &end, 10);
                     emp->id = id;
-                    emp->pixbuf = gt_twitch_download_emote(main_app->twitch, emp->id);
+                    /* NOTE: The pixbuf is left NULL, the chat view
+                     * resolves emotes at the scale it's drawn at */
+
+                    msg->cmd.privmsg->emotes = g_list_prepend(msg->cmd.privmsg->emotes, emp);
+
+                    e = end;
+
+                    if (*e != ',')
+                        break;
 
-                    msg->cmd.privmsg->emotes = g_list_append(msg->cmd.privmsg->emotes, emp);
+                    e++;
                 }
-            }
 
-            g_free(_emotes);
+                if (*e != '/')
+                    break;
+
+                e++;
+            }
 
             msg->cmd.privmsg->emotes = g_list_sort(msg->cmd.privmsg->emotes, (GCompareFunc) emote_compare);
 
             break;
         case GT_IRC_COMMAND_NOTICE:
-            msg->cmd.notice = g_new0(GtIrcCommandNotice, 1);
-            msg->cmd.notice->target = g_strdup(strsep(&line, " "));
+            msg->cmd.notice = &block->cmd.notice;
+            msg->cmd.notice->target = strsep(&line, " ");
             strsep(&line, ":");
-            msg->cmd.notice->msg = g_strdup(strsep(&line, ":"));
+            msg->cmd.notice->msg = strsep(&line, ":");
             break;
         case GT_IRC_COMMAND_JOIN:
-            msg->cmd.join = g_new0(GtIrcCommandJoin, 1);
-            msg->cmd.join->channel = g_strdup(strsep(&line, " "));
+            msg->cmd.join = &block->cmd.join;
+            msg->cmd.join->channel = strsep(&line, " ");
             break;
         case GT_IRC_COMMAND_PART:
-            msg->cmd.part = g_new0(GtIrcCommandPart, 1);
-            msg->cmd.part->channel = g_strdup(strsep(&line, " "));
+            msg->cmd.part = &block->cmd.part;
+            msg->cmd.part->channel = strsep(&line, " ");
             break;
         case GT_IRC_COMMAND_CAP:
-            msg->cmd.cap = g_new0(GtIrcCommandCap, 1);
-            msg->cmd.cap->target = g_strdup(strsep(&line, " "));
-            msg->cmd.cap->sub_command = g_strdup(strsep(&line, " ")); //TODO: Replace with enum
-            msg->cmd.cap->parameter = g_strdup(strsep(&line, " "));
+            msg->cmd.cap = &block->cmd.cap;
+            msg->cmd.cap->target = strsep(&line, " ");
+            msg->cmd.cap->sub_command = strsep(&line, " "); //TODO: Replace with enum
+            msg->cmd.cap->parameter = strsep(&line, " ");
             break;
         case GT_IRC_COMMAND_CHANNEL_MODE:
-            msg->cmd.chan_mode = g_new0(GtIrcCommandChannelMode, 1);
-            msg->cmd.chan_mode->channel = g_strdup(strsep(&line, " "));
-            msg->cmd.chan_mode->modes = g_strdup(strsep(&line, " "));
-            msg->cmd.chan_mode->nick = g_strdup(strsep(&line, " "));
+            msg->cmd.chan_mode = &block->cmd.chan_mode;
+            msg->cmd.chan_mode->channel = strsep(&line, " ");
+            msg->cmd.chan_mode->modes = strsep(&line, " ");
+            msg->cmd.chan_mode->nick = strsep(&line, " ");
             break;
         case GT_IRC_COMMAND_USERSTATE:
-            msg->cmd.userstate = g_new0(GtIrcCommandUserstate, 1);
-            msg->cmd.userstate->channel = g_strdup(strsep(&line, " "));
+            msg->cmd.userstate = &block->cmd.userstate;
+            msg->cmd.userstate->channel = strsep(&line, " ");
             break;
         case GT_IRC_COMMAND_ROOMSTATE:
-            msg->cmd.roomstate = g_new0(GtIrcCommandRoomstate, 1);
-            msg->cmd.roomstate->channel = g_strdup(strsep(&line, " "));
+            msg->cmd.roomstate = &block->cmd.roomstate;
+            msg->cmd.roomstate->channel = strsep(&line, " ");
             break;
         case GT_IRC_COMMAND_CLEARCHAT:
-            msg->cmd.clearchat = g_new0(GtIrcCommandClearchat, 1);
-            msg->cmd.clearchat->channel = g_strdup(strsep(&line, " "));
+            msg->cmd.clearchat = &block->cmd.clearchat;
+            msg->cmd.clearchat->channel = strsep(&line, " ");
             strsep(&line, ":");
-            msg->cmd.clearchat->target = g_strdup(strsep(&line, ":"));
+            msg->cmd.clearchat->target = strsep(&line, ":");
             break;
         default:
             WARNINGF("Unhandled IRC command '%s'", cmd);
             break;
     }
 
-    g_free(orig);
-
     return msg;
 }
 
 
+static const gchar*
+message_channel(GtIrcMessage* msg)
+{
+    switch (msg->cmd_type)
+    {
+        case GT_IRC_COMMAND_PRIVMSG: return msg->cmd.privmsg->target;
+        case GT_IRC_COMMAND_NOTICE: return msg->cmd.notice->target;
+        case GT_IRC_COMMAND_JOIN: return msg->cmd.join->channel;
+        case GT_IRC_COMMAND_PART: return msg->cmd.part->channel;
+        case GT_IRC_COMMAND_CHANNEL_MODE: return msg->cmd.chan_mode->channel;
+        case GT_IRC_COMMAND_USERSTATE: return msg->cmd.userstate->channel;
+        case GT_IRC_COMMAND_ROOMSTATE: return msg->cmd.roomstate->channel;
+        case GT_IRC_COMMAND_CLEARCHAT: return msg->cmd.clearchat->channel;
+        default: return NULL;
+    }
+}
+
+/* NOTE: Routes a message to the source of the channel it targets,
+ * anything that isn't for an extra channel goes to the main source */
+static void
+dispatch_message(GtIrc* self, GtIrcMessage* msg)
+{
+    GtIrcPrivate* priv = gt_irc_get_instance_private(self);
+    const gchar* target = message_channel(msg);
+    GtTwitchChatSource* source = NULL;
+
+    if (target && target[0] == '#')
+    {
+        IrcChannel* entry;
+
+        g_mutex_lock(&priv->mutex);
+
+        if ((entry = g_hash_table_lookup(priv->channels, target)) != NULL)
+            source = (GtTwitchChatSource*) g_source_ref((GSource*) entry->source);
+
+        g_mutex_unlock(&priv->mutex);
+    }
+
+    if (source)
+    {
+        gt_twitch_chat_source_push(source, msg);
+        g_source_unref((GSource*) source);
+    }
+    else if (priv->chan || priv->state >= GT_IRC_STATE_JOINED)
+    {
+        gboolean stale = FALSE;
+
+        /* NOTE: Lines for a channel we've parted can still trickle in
+         * after switching channels on a warm connection */
+        if (target && target[0] == '#')
+        {
+            g_mutex_lock(&priv->mutex);
+            stale = priv->chan && g_strcmp0(target + 1, gt_channel_get_name(priv->chan)) != 0;
+            g_mutex_unlock(&priv->mutex);
+        }
+
+        if (stale)
+            gt_irc_message_free(msg);
+        else
+            gt_twitch_chat_source_push(self->source, msg);
+    }
+    else
+        gt_irc_message_free(msg);
+}
+
 //TODO: Although clunky this would be cleaner if it's split up into
 //two functions one for sending and one for receiving
 static gboolean
@@ -609,18 +1128,23 @@ handle_message(GtIrc* self, GOutputStream* ostream, GtIrcMessage* msg)
         {
             if (msg->cmd_type == GT_IRC_COMMAND_REPLY && msg->cmd.reply->type == GT_CHAT_REPLY_WELCOME)
             {
+                gboolean logged_in;
+
                 priv->recv_logged_in = TRUE;
 
                 g_mutex_lock(&priv->mutex);
 
-                if (priv->state == GT_IRC_STATE_CONNECTED &&
-                    priv->send_logged_in)
-                {
+                logged_in = priv->state == GT_IRC_STATE_CONNECTED &&
+                    priv->send_logged_in;
+
+                if (logged_in)
                     priv->state = GT_IRC_STATE_LOGGED_IN;
-                    g_object_notify_by_pspec(G_OBJECT(self), props[PROP_STATE]);
-                }
 
                 g_mutex_unlock(&priv->mutex);
+
+                /* NOTE: Notify outside of the lock as the handlers take it */
+                if (logged_in)
+                    g_object_notify_by_pspec(G_OBJECT(self), props[PROP_STATE]);
             }
             else
             {
@@ -646,7 +1170,7 @@ handle_message(GtIrc* self, GOutputStream* ostream, GtIrcMessage* msg)
         }
         else
         {
-            if (priv->chan) g_async_queue_push(self->source->queue, msg);
+            dispatch_message(self, msg);
         }
     }
     else if (ostream == priv->ostream_send)
@@ -655,18 +1179,23 @@ handle_message(GtIrc* self, GOutputStream* ostream, GtIrcMessage* msg)
         {
             if (msg->cmd_type == GT_IRC_COMMAND_REPLY && msg->cmd.reply->type == GT_CHAT_REPLY_WELCOME)
             {
+                gboolean logged_in;
+
                 priv->send_logged_in = TRUE;
 
                 g_mutex_lock(&priv->mutex);
 
-                if (priv->state == GT_IRC_STATE_CONNECTED &&
-                    priv->recv_logged_in)
-                {
+                logged_in = priv->state == GT_IRC_STATE_CONNECTED &&
+                    priv->recv_logged_in;
+
+                if (logged_in)
                     priv->state = GT_IRC_STATE_LOGGED_IN;
-                    g_object_notify_by_pspec(G_OBJECT(self), props[PROP_STATE]);
-                }
 
                 g_mutex_unlock(&priv->mutex);
+
+                /* NOTE: Notify outside of the lock as the handlers take it */
+                if (logged_in)
+                    g_object_notify_by_pspec(G_OBJECT(self), props[PROP_STATE]);
             }
             else
             {
@@ -695,47 +1224,437 @@ handle_message(GtIrc* self, GOutputStream* ostream, GtIrcMessage* msg)
     return TRUE;
 }
 
-static void
-read_lines(ChatThreadData* data)
+static IrcHistory*
+irc_history_new(guint capacity)
 {
-    GtIrc* self = GT_IRC(data->self);
-    GtIrcPrivate* priv = gt_irc_get_instance_private(self);
-
-    gsize read = 0;
-    GError* err = NULL;
-
-    if (data->istream == priv->istream_recv)
-        INFO("Running chat worker thread for receive");
-    else if (data->istream == priv->istream_send)
-        INFO("{GtIrc} Running chat worker thread for send");
-
-    for (gchar* line = g_data_input_stream_read_line(data->istream, &read, NULL, &err); !err;
-         line = g_data_input_stream_read_line(data->istream, &read, NULL, &err))
-    {
-        if (priv->state < GT_IRC_STATE_CONNECTED)
-            break;
-
-        if (line)
-        {
-            GtIrcMessage* msg = parse_line(self, line);
+    IrcHistory* ring = g_new0(IrcHistory, 1);
 
-            if (!handle_message(self, data->ostream, msg))
-                break;
-        }
-    }
+    ring->capacity = capacity;
+    ring->lines = g_new(gchar*, capacity);
 
-    if (data->istream == priv->istream_recv)
-        INFO("Stopping chat worker thread for receive");
-    else if (data->istream == priv->istream_send)
-        INFO("Stopping chat worker thread for send");
+    return ring;
 }
 
 static void
-error_encountered_cb(GtIrc* self,
-                     GError* error,
-                     gpointer udata)
+irc_history_free(IrcHistory* ring)
 {
-    gt_irc_disconnect(self);
+    for (guint i = 0; i < ring->len; i++)
+        g_free(ring->lines[(ring->head + i) % ring->capacity]);
+
+    g_free(ring->lines);
+    g_free(ring);
+}
+
+static void
+irc_history_drop_oldest(IrcHistory* ring)
+{
+    gchar* line = ring->lines[ring->head];
+
+    ring->bytes -= strlen(line) + 1;
+    ring->head = (ring->head + 1) % ring->capacity;
+    ring->len--;
+
+    g_free(line);
+}
+
+static void
+irc_history_resize(IrcHistory* ring, guint capacity)
+{
+    gchar** lines;
+
+    while (ring->len > capacity)
+        irc_history_drop_oldest(ring);
+
+    lines = g_new(gchar*, capacity);
+
+    for (guint i = 0; i < ring->len; i++)
+        lines[i] = ring->lines[(ring->head + i) % ring->capacity];
+
+    g_free(ring->lines);
+
+    ring->lines = lines;
+    ring->capacity = capacity;
+    ring->head = 0;
+}
+
+static void
+irc_history_push(IrcHistory* ring, const gchar* line, gsize len, gsize max_bytes)
+{
+    gchar* copy;
+
+    if (len + 1 > max_bytes)
+        return;
+
+    while (ring->len > 0 &&
+        (ring->len == ring->capacity || ring->bytes + len + 1 > max_bytes))
+    {
+        irc_history_drop_oldest(ring);
+    }
+
+    copy = g_malloc(len + 1);
+    memcpy(copy, line, len);
+    copy[len] = '\0';
+
+    ring->lines[(ring->head + ring->len) % ring->capacity] = copy;
+    ring->len++;
+    ring->bytes += len + 1;
+}
+
+static gsize
+irc_history_footprint(IrcHistory* ring)
+{
+    return sizeof(IrcHistory) + ring->capacity*sizeof(gchar*) + ring->bytes;
+}
+
+/* NOTE: Must be called with the history mutex held */
+static gsize
+history_footprint(GtIrc* self)
+{
+    GtIrcPrivate* priv = gt_irc_get_instance_private(self);
+    GHashTableIter iter;
+    IrcHistory* ring;
+    gsize ret = 0;
+
+    g_hash_table_iter_init(&iter, priv->history);
+
+    while (g_hash_table_iter_next(&iter, NULL, (gpointer*) &ring))
+        ret += irc_history_footprint(ring);
+
+    return ret;
+}
+
+static void
+record_history(GtIrc* self, const gchar* target, const gchar* line, gsize len)
+{
+    GtIrcPrivate* priv = gt_irc_get_instance_private(self);
+    guint size = priv->history_size;
+    IrcHistory* ring;
+
+    if (size == 0 || !target || target[0] != '#')
+        return;
+
+    g_mutex_lock(&priv->history_mutex);
+
+    if ((ring = g_hash_table_lookup(priv->history, target)) == NULL)
+    {
+        /* NOTE: Forget the channel that was visited longest ago */
+        if (g_hash_table_size(priv->history) >= MAX_HISTORY_CHANNELS)
+        {
+            GHashTableIter iter;
+            const gchar* key;
+            const gchar* oldest_key = NULL;
+            IrcHistory* oldest = NULL;
+
+            g_hash_table_iter_init(&iter, priv->history);
+
+            while (g_hash_table_iter_next(&iter, (gpointer*) &key, (gpointer*) &ring))
+            {
+                if (!oldest || ring->last_used < oldest->last_used)
+                {
+                    oldest = ring;
+                    oldest_key = key;
+                }
+            }
+
+            g_hash_table_remove(priv->history, oldest_key);
+        }
+
+        ring = irc_history_new(size);
+        g_hash_table_insert(priv->history, g_strdup(target), ring);
+    }
+    else if (ring->capacity != size)
+        irc_history_resize(ring, size);
+
+    ring->last_used = g_get_monotonic_time();
+
+    irc_history_push(ring, line, len, (gsize) priv->history_memory*1024);
+
+    g_mutex_unlock(&priv->history_mutex);
+}
+
+/* NOTE: Hands the recent history of the channel to the main source so
+ * it's shown before anything live */
+static void
+replay_history(GtIrc* self, GtChannel* chan)
+{
+    GtIrcPrivate* priv = gt_irc_get_instance_private(self);
+    g_autofree gchar* key = g_strdup_printf("#%s", gt_channel_get_name(chan));
+    g_autoptr(GPtrArray) lines = NULL;
+    GPtrArray* backlog;
+    IrcHistory* ring;
+
+    g_mutex_lock(&priv->history_mutex);
+
+    if ((ring = g_hash_table_lookup(priv->history, key)) == NULL || ring->len == 0)
+    {
+        g_mutex_unlock(&priv->history_mutex);
+
+        return;
+    }
+
+    lines = g_ptr_array_new_full(ring->len, g_free);
+
+    for (guint i = 0; i < ring->len; i++)
+        g_ptr_array_add(lines, g_strdup(ring->lines[(ring->head + i) % ring->capacity]));
+
+    ring->last_used = g_get_monotonic_time();
+
+    DEBUGF("Replaying '%u' lines of history for channel '%s', history takes up '%" G_GSIZE_FORMAT "' bytes",
+        lines->len, key, history_footprint(self));
+
+    g_mutex_unlock(&priv->history_mutex);
+
+    backlog = g_ptr_array_new_full(lines->len, (GDestroyNotify) gt_irc_message_free);
+
+    for (guint i = 0; i < lines->len; i++)
+    {
+        const gchar* line = g_ptr_array_index(lines, i);
+        GtIrcMessage* msg = parse_line(self, line, strlen(line));
+
+        msg->replayed = TRUE;
+
+        g_ptr_array_add(backlog, msg);
+    }
+
+    gt_twitch_chat_source_set_backlog(self->source, backlog);
+}
+
+static ChatThreadData*
+chat_thread_data_new(GtIrc* self, GDataInputStream* istream, GOutputStream* ostream)
+{
+    ChatThreadData* data = g_new(ChatThreadData, 1);
+
+    data->self = self;
+    data->istream = istream;
+    data->ostream = ostream;
+    data->size = READ_BUFFER_SIZE;
+    data->buf = g_malloc(data->size);
+    data->fill = 0;
+
+    return data;
+}
+
+static void
+chat_thread_data_free(ChatThreadData* data)
+{
+    g_free(data->buf);
+    g_free(data);
+}
+
+/* NOTE: Only grows the buffer if a single line doesn't fit */
+static void
+reserve_read_buffer(ChatThreadData* data)
+{
+    if (data->fill == data->size)
+    {
+        data->size *= 2;
+        data->buf = g_realloc(data->buf, data->size);
+    }
+}
+
+/* NOTE: Parses every complete line in place, only a trailing partial
+ * line is moved to the front of the buffer. Returns FALSE once we
+ * should stop reading */
+static gboolean
+process_lines(ChatThreadData* data, gsize n)
+{
+    GtIrc* self = GT_IRC(data->self);
+    GtIrcPrivate* priv = gt_irc_get_instance_private(self);
+    gchar* start = data->buf;
+    gchar* end;
+    gboolean running = TRUE;
+
+    data->fill += n;
+
+    while (running && (end = memchr(start, '\n', data->buf + data->fill - start)) != NULL)
+    {
+        gsize len = end - start;
+
+        if (len > 0 && start[len - 1] == '\r')
+            len--;
+
+        if (priv->state < GT_IRC_STATE_CONNECTED)
+            running = FALSE;
+        else if (len > 0)
+        {
+            GtIrcMessage* msg = parse_line(self, start, len);
+
+            if (data->ostream == priv->ostream_recv &&
+                msg->cmd_type == GT_IRC_COMMAND_PRIVMSG)
+            {
+                record_history(self, msg->cmd.privmsg->target, start, len);
+            }
+
+            running = handle_message(self, data->ostream, msg);
+        }
+
+        start = end + 1;
+    }
+
+    data->fill -= start - data->buf;
+    memmove(data->buf, start, data->fill);
+
+    return running;
+}
+
+/* NOTE: Reads straight from the socket in large chunks so a single
+ * read usually carries many lines */
+static void
+read_lines(ChatThreadData* data)
+{
+    GtIrc* self = GT_IRC(data->self);
+    GtIrcPrivate* priv = gt_irc_get_instance_private(self);
+
+    GInputStream* istream;
+    GError* err = NULL;
+    gssize n;
+
+    if (data->istream == priv->istream_recv)
+        INFO("Running chat worker thread for receive");
+    else if (data->istream == priv->istream_send)
+        INFO("{GtIrc} Running chat worker thread for send");
+
+    istream = g_filter_input_stream_get_base_stream(G_FILTER_INPUT_STREAM(data->istream));
+
+    do
+    {
+        reserve_read_buffer(data);
+
+        n = g_input_stream_read(istream, data->buf + data->fill,
+            data->size - data->fill, NULL, &err);
+    } while (n > 0 && process_lines(data, n));
+
+    if (err)
+    {
+        DEBUGF("Stopped reading because: %s", err->message);
+
+        g_error_free(err);
+    }
+
+    if (data->istream == priv->istream_recv)
+        INFO("Stopping chat worker thread for receive");
+    else if (data->istream == priv->istream_send)
+        INFO("Stopping chat worker thread for send");
+
+    chat_thread_data_free(data);
+}
+
+/* NOTE: All GtIrc instances with shared_io set watch their sockets
+ * from this one thread instead of blocking two threads each */
+static gpointer
+io_thread_func(GMainContext* ctx)
+{
+    GMainLoop* loop = g_main_loop_new(ctx, FALSE);
+
+    INFO("Running shared chat I/O thread");
+
+    g_main_loop_run(loop);
+
+    return NULL;
+}
+
+static GMainContext*
+get_io_context()
+{
+    static gsize ctx = 0;
+
+    if (g_once_init_enter(&ctx))
+    {
+        GMainContext* _ctx = g_main_context_new();
+
+        g_thread_unref(g_thread_new("gnome-twitch-chat-io", (GThreadFunc) io_thread_func, _ctx));
+
+        g_once_init_leave(&ctx, (gsize) _ctx);
+    }
+
+    return (GMainContext*) ctx;
+}
+
+static gboolean
+socket_readable_cb(GSocket* sock, GIOCondition cond, gpointer udata)
+{
+    ChatThreadData* data = udata;
+    GError* err = NULL;
+    gssize n;
+
+    reserve_read_buffer(data);
+
+    n = g_socket_receive_with_blocking(sock, data->buf + data->fill,
+        data->size - data->fill, FALSE, NULL, &err);
+
+    if (n < 0 && g_error_matches(err, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK))
+    {
+        g_error_free(err);
+
+        return G_SOURCE_CONTINUE;
+    }
+
+    if (n > 0 && process_lines(data, n))
+        return G_SOURCE_CONTINUE;
+
+    if (err)
+    {
+        DEBUGF("Stopped watching socket because: %s", err->message);
+
+        g_error_free(err);
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
+static GSource*
+watch_connection(GtIrc* self, GSocketConnection* conn,
+    GDataInputStream* istream, GOutputStream* ostream)
+{
+    GSocket* sock = g_socket_connection_get_socket(conn);
+    GSource* source;
+
+    /* NOTE: Only affects our reads, the output streams still block
+     * until everything is written */
+    g_socket_set_blocking(sock, FALSE);
+
+    source = g_socket_create_source(sock, G_IO_IN | G_IO_HUP | G_IO_ERR, NULL);
+
+    g_source_set_callback(source, (GSourceFunc) socket_readable_cb,
+        chat_thread_data_new(self, istream, ostream), (GDestroyNotify) chat_thread_data_free);
+    g_source_attach(source, get_io_context());
+
+    return source;
+}
+
+static void
+error_encountered_cb(GtIrc* self,
+                     GError* error,
+                     gpointer udata)
+{
+    gt_irc_disconnect(self);
+}
+
+static void
+irc_channel_free(IrcChannel* entry)
+{
+    g_source_destroy((GSource*) entry->source);
+    g_source_unref((GSource*) entry->source);
+    g_free(entry->name);
+    g_free(entry->room_id);
+    g_free(entry);
+}
+
+/* NOTE: Must be called with the mutex held */
+static void
+join_channel(GtIrc* self, IrcChannel* entry)
+{
+    GtIrcPrivate* priv = gt_irc_get_instance_private(self);
+
+    if (entry->joined || priv->state < GT_IRC_STATE_LOGGED_IN)
+        return;
+
+    MESSAGEF("Joining extra channel='%s'", entry->name);
+
+    send_cmd(priv->ostream_recv, CHAT_CMD_STR_JOIN, entry->name);
+    send_cmd(priv->ostream_send, CHAT_CMD_STR_JOIN, entry->name);
+
+    entry->joined = TRUE;
 }
 
 static void
@@ -749,8 +1668,20 @@ logged_in_cb(GObject* source,
 
     if (priv->state == GT_IRC_STATE_LOGGED_IN)
     {
+        GHashTableIter iter;
+        IrcChannel* entry;
+
         gt_irc_join(self, gt_channel_get_name(priv->chan));
 
+        g_mutex_lock(&priv->mutex);
+
+        g_hash_table_iter_init(&iter, priv->channels);
+
+        while (g_hash_table_iter_next(&iter, NULL, (gpointer*) &entry))
+            join_channel(self, entry);
+
+        g_mutex_unlock(&priv->mutex);
+
         g_signal_handlers_disconnect_by_func(self, logged_in_cb, self);
     }
 }
@@ -782,6 +1713,30 @@ get_property(GObject* obj,
         case PROP_STATE:
             g_value_set_enum(val, priv->state);
             break;
+        case PROP_DISPATCH_BUDGET:
+            g_value_set_int(val, self->source->budget / G_TIME_SPAN_MILLISECOND);
+            break;
+        case PROP_QUEUE_LIMIT:
+            g_value_set_int(val, self->source->limit);
+            break;
+        case PROP_OVERLOAD_POLICY:
+            g_value_set_enum(val, self->source->policy);
+            break;
+        case PROP_SHED_MESSAGES:
+            g_value_set_uint(val, gt_twitch_chat_source_get_shed_messages(self->source));
+            break;
+        case PROP_SHARED_IO:
+            g_value_set_boolean(val, priv->shared_io);
+            break;
+        case PROP_IDLE_TIMEOUT:
+            g_value_set_int(val, priv->idle_timeout);
+            break;
+        case PROP_HISTORY_SIZE:
+            g_value_set_int(val, priv->history_size);
+            break;
+        case PROP_HISTORY_MEMORY:
+            g_value_set_int(val, priv->history_memory);
+            break;
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop, pspec);
     }
@@ -798,6 +1753,27 @@ set_property(GObject* obj,
 
     switch (prop)
     {
+        case PROP_DISPATCH_BUDGET:
+            self->source->budget = g_value_get_int(val)*G_TIME_SPAN_MILLISECOND;
+            break;
+        case PROP_QUEUE_LIMIT:
+            self->source->limit = g_value_get_int(val);
+            break;
+        case PROP_OVERLOAD_POLICY:
+            self->source->policy = g_value_get_enum(val);
+            break;
+        case PROP_SHARED_IO:
+            priv->shared_io = g_value_get_boolean(val);
+            break;
+        case PROP_IDLE_TIMEOUT:
+            priv->idle_timeout = g_value_get_int(val);
+            break;
+        case PROP_HISTORY_SIZE:
+            priv->history_size = g_value_get_int(val);
+            break;
+        case PROP_HISTORY_MEMORY:
+            priv->history_memory = g_value_get_int(val);
+            break;
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop, pspec);
     }
@@ -823,6 +1799,38 @@ gt_irc_class_init(GtIrcClass* klass)
     props[PROP_STATE] = g_param_spec_enum("state", "State", "Current state",
         GT_TYPE_IRC_STATE, GT_IRC_STATE_DISCONNECTED, G_PARAM_READABLE);
 
+    props[PROP_DISPATCH_BUDGET] = g_param_spec_int("dispatch-budget", "Dispatch budget",
+        "Time in milliseconds to spend handling chat messages per main loop iteration",
+        1, 100, DEFAULT_DISPATCH_BUDGET, G_PARAM_READWRITE);
+
+    props[PROP_QUEUE_LIMIT] = g_param_spec_int("queue-limit", "Queue limit",
+        "Number of queued chat messages after which messages are shed, 0 for no limit",
+        0, MAX_QUEUE_LIMIT, DEFAULT_QUEUE_LIMIT, G_PARAM_READWRITE);
+
+    props[PROP_OVERLOAD_POLICY] = g_param_spec_enum("overload-policy", "Overload policy",
+        "How chat messages are shed once the queue limit is reached",
+        GT_TYPE_IRC_OVERLOAD_POLICY, GT_IRC_OVERLOAD_POLICY_DROP_OLDEST, G_PARAM_READWRITE);
+
+    props[PROP_SHED_MESSAGES] = g_param_spec_uint("shed-messages", "Shed messages",
+        "Number of chat messages shed because the queue was full",
+        0, G_MAXUINT, 0, G_PARAM_READABLE);
+
+    props[PROP_SHARED_IO] = g_param_spec_boolean("shared-io", "Shared I/O",
+        "Whether to read from a thread shared by all chats instead of two threads of our own, takes effect on the next connect",
+        FALSE, G_PARAM_READWRITE);
+
+    props[PROP_IDLE_TIMEOUT] = g_param_spec_int("idle-timeout", "Idle timeout",
+        "Seconds to keep released connections logged in, 0 to close them straight away",
+        0, 3600, DEFAULT_IDLE_TIMEOUT, G_PARAM_READWRITE);
+
+    props[PROP_HISTORY_SIZE] = g_param_spec_int("history-size", "History size",
+        "Number of chat lines to remember per channel, 0 to remember none",
+        0, 10000, DEFAULT_HISTORY_SIZE, G_PARAM_READWRITE);
+
+    props[PROP_HISTORY_MEMORY] = g_param_spec_int("history-memory", "History memory",
+        "Memory in KiB the remembered chat lines of a channel may take up",
+        16, 65536, DEFAULT_HISTORY_MEMORY, G_PARAM_READWRITE);
+
     g_object_class_install_properties(obj_class, NUM_PROPS, props);
 }
 
@@ -834,8 +1842,18 @@ gt_irc_init(GtIrc* self)
     priv->recv_logged_in = FALSE;
     priv->send_logged_in = FALSE;
     priv->state = GT_IRC_STATE_DISCONNECTED;
+    priv->idle_timeout = DEFAULT_IDLE_TIMEOUT;
+    priv->history_size = DEFAULT_HISTORY_SIZE;
+    priv->history_memory = DEFAULT_HISTORY_MEMORY;
 
     g_mutex_init(&priv->mutex);
+    g_mutex_init(&priv->history_mutex);
+
+    priv->history = g_hash_table_new_full(g_str_hash, g_str_equal,
+        g_free, (GDestroyNotify) irc_history_free);
+
+    priv->channels = g_hash_table_new_full(g_str_hash, g_str_equal,
+        NULL, (GDestroyNotify) irc_channel_free); // Keys are owned by the entries
 
     self->source = gt_twitch_chat_source_new();
     g_source_attach((GSource*) self->source, g_main_context_default());
@@ -859,6 +1877,9 @@ gt_irc_connect(GtIrc* self,
     MESSAGEF("Connecting with nick='%s', host='%s' and port='%d'",
              nick, host, port);
 
+    g_free(priv->oauth_token);
+    priv->oauth_token = g_strdup(oauth_token);
+
     addr = g_network_address_new(host, port);
     sock_client = g_socket_client_new();
 
@@ -891,21 +1912,23 @@ gt_irc_connect(GtIrc* self,
     priv->ostream_send = g_io_stream_get_output_stream(G_IO_STREAM(priv->irc_conn_send));
     g_object_set_data(G_OBJECT(priv->ostream_send), "type", "send");
 
-    send_data = g_new(ChatThreadData, 2);
-    recv_data = send_data + 1;
-
-    recv_data->self = self;
-    recv_data->istream = priv->istream_recv;
-    recv_data->ostream = priv->ostream_recv;
-
-    send_data->self = self;
-    send_data->istream = priv->istream_send;
-    send_data->ostream = priv->ostream_send;
+    if (priv->shared_io)
+    {
+        priv->watch_recv = watch_connection(self, priv->irc_conn_recv,
+            priv->istream_recv, priv->ostream_recv);
+        priv->watch_send = watch_connection(self, priv->irc_conn_send,
+            priv->istream_send, priv->ostream_send);
+    }
+    else
+    {
+        recv_data = chat_thread_data_new(self, priv->istream_recv, priv->ostream_recv);
+        send_data = chat_thread_data_new(self, priv->istream_send, priv->ostream_send);
 
-    priv->worker_thread_recv = g_thread_new("gnome-twitch-chat-worker-recv",
-                                       (GThreadFunc) read_lines, recv_data);
-    priv->worker_thread_send = g_thread_new("gnome-twitch-chat-worker-send",
-                                       (GThreadFunc) read_lines, send_data);
+        priv->worker_thread_recv = g_thread_new("gnome-twitch-chat-worker-recv",
+            (GThreadFunc) read_lines, recv_data);
+        priv->worker_thread_send = g_thread_new("gnome-twitch-chat-worker-send",
+            (GThreadFunc) read_lines, send_data);
+    }
 
     if (utils_str_empty(oauth_token))
     {
@@ -959,15 +1982,34 @@ gt_irc_disconnect(GtIrc* self)
 //        g_clear_object(&priv->istream_send);
 //        g_clear_object(&priv->ostream_send);
 
-    g_thread_unref(priv->worker_thread_recv);
-    g_thread_unref(priv->worker_thread_send);
+    if (priv->watch_recv)
+    {
+        g_source_destroy(priv->watch_recv);
+        g_source_destroy(priv->watch_send);
+    }
+
+    g_clear_pointer(&priv->watch_recv, g_source_unref);
+    g_clear_pointer(&priv->watch_send, g_source_unref);
+    g_clear_pointer(&priv->worker_thread_recv, g_thread_unref);
+    g_clear_pointer(&priv->worker_thread_send, g_thread_unref);
+
+    if (priv->idle_source > 0)
+    {
+        g_source_remove(priv->idle_source);
+        priv->idle_source = 0;
+    }
+
+    g_clear_pointer(&priv->oauth_token, g_free);
+
+    g_mutex_lock(&priv->mutex);
+    g_clear_object(&priv->chan);
+    g_mutex_unlock(&priv->mutex);
 
-    g_object_unref(priv->chan);
+    g_mutex_lock(&priv->mutex);
+    g_hash_table_remove_all(priv->channels);
+    g_mutex_unlock(&priv->mutex);
 
-    self->source->resetting_queue = TRUE;
-    g_async_queue_unref(self->source->queue);
-    self->source->queue = g_async_queue_new_full((GDestroyNotify) gt_irc_message_free);
-    self->source->resetting_queue = FALSE;
+    gt_twitch_chat_source_reset(self->source);
 
     priv->recv_logged_in = FALSE;
     priv->send_logged_in = FALSE;
@@ -1022,8 +2064,8 @@ gt_irc_part(GtIrc* self)
 
     MESSAGEF("Parting with channel='%s'", name);
 
-    send_cmd(priv->ostream_recv, CHAT_CMD_STR_PART, name);
-    send_cmd(priv->ostream_send, CHAT_CMD_STR_PART, name);
+    send_cmd_printf(priv->ostream_recv, CHAT_CMD_STR_PART, "#%s", name);
+    send_cmd_printf(priv->ostream_send, CHAT_CMD_STR_PART, "#%s", name);
 
     priv->state = GT_IRC_STATE_LOGGED_IN;
     g_object_notify_by_pspec(G_OBJECT(self), props[PROP_STATE]);
@@ -1043,6 +2085,43 @@ gt_irc_connect_and_join_channel(GtIrc* self, GtChannel* chan)
     const GtOAuthInfo* info = NULL;
     g_autoptr(GError) err = NULL;
 
+    info = gt_app_get_oauth_info(main_app);
+
+    /* NOTE: The user logged in or out since the connection was made so
+     * it's for the wrong account */
+    if (gt_irc_is_idle(self) &&
+        g_strcmp0(priv->oauth_token, info ? info->oauth_token : NULL) != 0)
+    {
+        gt_irc_disconnect(self);
+    }
+
+    if (gt_irc_is_idle(self))
+    {
+        MESSAGEF("Reusing warm connection for channel '%s'", gt_channel_get_name(chan));
+
+        gt_twitch_load_chat_badge_sets_for_channel(main_app->twitch, gt_channel_get_id(chan), &err);
+
+        if (err)
+        {
+            WARNINGF("Unable to join channel '%s' because: %s",
+                gt_channel_get_name(chan), err->message);
+
+            g_signal_emit(self, sigs[SIG_ERROR_ENCOUNTERED], 0, err);
+
+            return;
+        }
+
+        g_mutex_lock(&priv->mutex);
+        priv->chan = g_object_ref(chan);
+        g_mutex_unlock(&priv->mutex);
+
+        replay_history(self, chan);
+
+        gt_irc_join(self, gt_channel_get_name(chan));
+
+        return;
+    }
+
     if (priv->state != GT_IRC_STATE_DISCONNECTED)
     {
         WARNING("Trying to connect before being disconnected");
@@ -1071,6 +2150,8 @@ gt_irc_connect_and_join_channel(GtIrc* self, GtChannel* chan)
         return;
     }
 
+    replay_history(self, chan);
+
     servers = gt_twitch_chat_servers(main_app->twitch, gt_channel_get_name(chan), &err);
 
     if (err)
@@ -1093,8 +2174,6 @@ gt_irc_connect_and_join_channel(GtIrc* self, GtChannel* chan)
 
     g_signal_connect(self, "notify::state", G_CALLBACK(logged_in_cb), self);
 
-    info = gt_app_get_oauth_info(main_app);
-
     gt_irc_connect(self, host, port,
         info ? info->oauth_token : NULL,
         info ? info->user_name : NULL);
@@ -1128,8 +2207,16 @@ gt_irc_connect_and_join_channel_async(GtIrc* self, GtChannel* chan,
     g_assert(GT_IS_IRC(self));
     g_assert(GT_IS_CHANNEL(chan));
 
+    GtIrcPrivate* priv = gt_irc_get_instance_private(self);
     GTask* task = NULL;
 
+    /* NOTE: Stop the idle timeout here as it runs on the main thread */
+    if (priv->idle_source > 0)
+    {
+        g_source_remove(priv->idle_source);
+        priv->idle_source = 0;
+    }
+
     task = g_task_new(self, cancel, cb, udata);
     g_task_set_return_on_cancel(task, FALSE);
 
@@ -1138,6 +2225,68 @@ gt_irc_connect_and_join_channel_async(GtIrc* self, GtChannel* chan,
     g_task_run_in_thread(task, connect_and_join_channel_async_cb);
 }
 
+static gboolean
+idle_timeout_cb(gpointer udata)
+{
+    GtIrc* self = GT_IRC(udata);
+    GtIrcPrivate* priv = gt_irc_get_instance_private(self);
+
+    priv->idle_source = 0;
+
+    if (gt_irc_is_idle(self))
+    {
+        MESSAGE("Closing idle connection");
+
+        gt_irc_disconnect(self);
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
+/* NOTE: Parts the channel but keeps the connections logged in so
+ * joining the next channel skips the whole handshake, they're closed
+ * if nothing is joined within the idle timeout */
+void
+gt_irc_release(GtIrc* self)
+{
+    g_assert(GT_IS_IRC(self));
+
+    GtIrcPrivate* priv = gt_irc_get_instance_private(self);
+
+    if (priv->state < GT_IRC_STATE_LOGGED_IN || priv->idle_timeout == 0)
+    {
+        gt_irc_disconnect(self);
+
+        return;
+    }
+
+    if (priv->state == GT_IRC_STATE_JOINED)
+        gt_irc_part(self);
+
+    g_mutex_lock(&priv->mutex);
+    g_clear_object(&priv->chan);
+    g_mutex_unlock(&priv->mutex);
+
+    gt_twitch_chat_source_reset(self->source);
+
+    MESSAGEF("Keeping connection warm for '%d' seconds", priv->idle_timeout);
+
+    if (priv->idle_source > 0)
+        g_source_remove(priv->idle_source);
+
+    priv->idle_source = g_timeout_add_seconds(priv->idle_timeout, idle_timeout_cb, self);
+}
+
+gboolean
+gt_irc_is_idle(GtIrc* self)
+{
+    g_assert(GT_IS_IRC(self));
+
+    GtIrcPrivate* priv = gt_irc_get_instance_private(self);
+
+    return priv->state == GT_IRC_STATE_LOGGED_IN && !priv->chan;
+}
+
 void
 gt_irc_privmsg(GtIrc* self, const gchar* msg)
 {
@@ -1154,6 +2303,146 @@ gt_irc_privmsg(GtIrc* self, const gchar* msg)
         gt_channel_get_name(priv->chan), msg);
 }
 
+static void
+add_channel_async_cb(GTask* task, gpointer source,
+    gpointer task_data, GCancellable* cancel)
+{
+    g_assert(G_IS_TASK(task));
+    g_assert(GT_IS_IRC(source));
+    g_assert_nonnull(task_data);
+
+    GtIrc* self = GT_IRC(source);
+    GtIrcPrivate* priv = gt_irc_get_instance_private(self);
+    gchar** data = task_data; // Name and room id of the channel
+    g_autoptr(GError) err = NULL;
+    IrcChannel* entry;
+
+    /* NOTE: Load the badges before joining so the receive thread
+     * doesn't have to fetch them while parsing */
+    gt_twitch_load_chat_badge_sets_for_channel(main_app->twitch, data[1], &err);
+
+    if (err)
+    {
+        WARNINGF("Unable to load chat badges for channel '%s' because: %s",
+            data[0], err->message);
+    }
+
+    g_mutex_lock(&priv->mutex);
+
+    /* NOTE: The channel might have been removed in the meantime */
+    if ((entry = g_hash_table_lookup(priv->channels, data[0])) != NULL)
+        join_channel(self, entry);
+
+    g_mutex_unlock(&priv->mutex);
+
+    g_task_return_boolean(task, TRUE);
+}
+
+/* NOTE: Joins an extra channel on the same connection. Messages for
+ * it are delivered to the returned source, which stays owned by
+ * GtIrc until the channel is removed or we disconnect. Without a room
+ * id no badges are loaded and the channel is joined straight away */
+GtTwitchChatSource*
+gt_irc_add_channel(GtIrc* self, const gchar* channel, const gchar* room_id)
+{
+    g_assert(GT_IS_IRC(self));
+    g_assert_false(utils_str_empty(channel));
+
+    GtIrcPrivate* priv = gt_irc_get_instance_private(self);
+    g_autoptr(GTask) task = NULL;
+    g_autofree gchar* key = g_strdup_printf("#%s", channel);
+    IrcChannel* entry;
+
+    g_mutex_lock(&priv->mutex);
+
+    if ((entry = g_hash_table_lookup(priv->channels, key)) != NULL)
+    {
+        g_mutex_unlock(&priv->mutex);
+
+        return entry->source;
+    }
+
+    entry = g_new0(IrcChannel, 1);
+    entry->name = g_steal_pointer(&key);
+    entry->room_id = g_strdup(room_id);
+    entry->source = gt_twitch_chat_source_new();
+    entry->source->budget = self->source->budget;
+    entry->source->limit = self->source->limit;
+    entry->source->policy = self->source->policy;
+    entry->joined = FALSE;
+
+    g_source_attach((GSource*) entry->source, g_main_context_default());
+
+    g_hash_table_insert(priv->channels, entry->name, entry);
+
+    if (!room_id)
+        join_channel(self, entry);
+
+    g_mutex_unlock(&priv->mutex);
+
+    if (room_id)
+    {
+        gchar** data = g_new0(gchar*, 3);
+
+        data[0] = g_strdup(entry->name);
+        data[1] = g_strdup(room_id);
+
+        task = g_task_new(self, NULL, NULL, NULL);
+        g_task_set_task_data(task, data, (GDestroyNotify) g_strfreev);
+        g_task_run_in_thread(task, add_channel_async_cb);
+    }
+
+    return entry->source;
+}
+
+void
+gt_irc_remove_channel(GtIrc* self, const gchar* channel)
+{
+    g_assert(GT_IS_IRC(self));
+    g_assert_false(utils_str_empty(channel));
+
+    GtIrcPrivate* priv = gt_irc_get_instance_private(self);
+    g_autofree gchar* key = g_strdup_printf("#%s", channel);
+    IrcChannel* entry;
+
+    g_mutex_lock(&priv->mutex);
+
+    if ((entry = g_hash_table_lookup(priv->channels, key)) != NULL)
+    {
+        if (entry->joined && priv->state >= GT_IRC_STATE_LOGGED_IN)
+        {
+            MESSAGEF("Parting extra channel='%s'", key);
+
+            send_cmd(priv->ostream_recv, CHAT_CMD_STR_PART, key);
+            send_cmd(priv->ostream_send, CHAT_CMD_STR_PART, key);
+        }
+
+        g_hash_table_remove(priv->channels, key);
+    }
+    else
+        WARNINGF("Trying to remove channel='%s' that hasn't been added", key);
+
+    g_mutex_unlock(&priv->mutex);
+}
+
+void
+gt_irc_privmsg_channel(GtIrc* self, const gchar* channel, const gchar* msg)
+{
+    g_assert(GT_IS_IRC(self));
+    g_assert_false(utils_str_empty(channel));
+
+    GtIrcPrivate* priv = gt_irc_get_instance_private(self);
+
+    if (priv->state < GT_IRC_STATE_LOGGED_IN)
+    {
+        WARNING("Trying to privmsg when not logged in");
+
+        return;
+    }
+
+    send_cmd_printf(priv->ostream_send, CHAT_CMD_STR_PRIVMSG, "#%s :%s", channel, msg);
+}
+
 GtIrcState
 gt_irc_get_state(GtIrc* self)
 {
@@ -1164,77 +2453,61 @@ gt_irc_get_state(GtIrc* self)
     return priv->state;
 }
 
+const gchar*
+gt_irc_message_get_tag(GtIrcMessage* msg, GtIrcTagType tag)
+{
+    g_assert_nonnull(msg);
+    g_assert(tag < GT_IRC_TAG_COUNT);
+
+    if (msg->tags.escaped & (1 << tag))
+    {
+        unescape_tag_value(msg->tags.values[tag]);
+        msg->tags.escaped &= ~(1 << tag);
+    }
+
+    return msg->tags.values[tag];
+}
+
+/* NOTE: Parses a line without its line ending the way it would be if
+ * it was received, gt-irc-bench uses it to count the allocations */
+GtIrcMessage*
+gt_irc_message_parse(GtIrc* self, const gchar* line, gsize len)
+{
+    g_assert(GT_IS_IRC(self));
+    g_assert_nonnull(line);
+
+    return parse_line(self, line, len);
+}
+
 void
 gt_irc_message_free(GtIrcMessage* msg)
 {
-    g_free(msg->nick);
-    g_free(msg->user);
-    g_free(msg->host);
-    g_strfreev(msg->tags);
-
-    switch (msg->cmd_type)
+    /* NOTE: Everything but the emote and badge lists lives in the
+     * same block as the message itself */
+    if (msg->cmd_type == GT_IRC_COMMAND_PRIVMSG)
     {
-        case GT_IRC_COMMAND_NOTICE:
-            g_free(msg->cmd.notice->msg);
-            g_free(msg->cmd.notice->target);
-            g_free(msg->cmd.notice);
-            break;
-        case GT_IRC_COMMAND_PING:
-            g_free(msg->cmd.ping->server);
-            g_free(msg->cmd.ping);
-            break;
-        case GT_IRC_COMMAND_PRIVMSG:
-            g_free(msg->cmd.privmsg->msg);
-            g_free(msg->cmd.privmsg->target);
-            g_free(msg->cmd.privmsg->colour);
-            g_free(msg->cmd.privmsg->display_name);
-            gt_chat_emote_list_free(msg->cmd.privmsg->emotes);
-            g_free(msg->cmd.privmsg);
-            break;
-        case GT_IRC_COMMAND_REPLY:
-            g_free(msg->cmd.reply->reply);
-            g_free(msg->cmd.reply);
-            break;
-        case GT_IRC_COMMAND_JOIN:
-            g_free(msg->cmd.join->channel);
-            g_free(msg->cmd.join);
-            break;
-        case GT_IRC_COMMAND_PART:
-            g_free(msg->cmd.part->channel);
-            g_free(msg->cmd.part);
-            break;
-        case GT_IRC_COMMAND_CAP:
-            g_free(msg->cmd.cap->parameter);
-            g_free(msg->cmd.cap->target);
-            g_free(msg->cmd.cap->sub_command);
-            g_free(msg->cmd.cap);
-            break;
-        case GT_IRC_COMMAND_CHANNEL_MODE:
-            g_free(msg->cmd.chan_mode->channel);
-            g_free(msg->cmd.chan_mode->modes);
-            g_free(msg->cmd.chan_mode->nick);
-            g_free(msg->cmd.chan_mode);
-            break;
-        case GT_IRC_COMMAND_USERSTATE:
-            g_free(msg->cmd.userstate->channel);
-            g_free(msg->cmd.userstate);
-            break;
-        case GT_IRC_COMMAND_ROOMSTATE:
-            g_free(msg->cmd.roomstate->channel);
-            g_free(msg->cmd.roomstate);
-            break;
-        case GT_IRC_COMMAND_CLEARCHAT:
-            g_free(msg->cmd.clearchat->channel);
-            g_free(msg->cmd.clearchat->target);
-            g_free(msg->cmd.clearchat);
-            break;
-        default:
-            break;
+        gt_chat_emote_list_free(msg->cmd.privmsg->emotes);
+        g_list_free(msg->cmd.privmsg->badges);
     }
 
     g_free(msg);
 }
 
+gsize
+gt_irc_get_history_footprint(GtIrc* self)
+{
+    g_assert(GT_IS_IRC(self));
+
+    GtIrcPrivate* priv = gt_irc_get_instance_private(self);
+    gsize ret;
+
+    g_mutex_lock(&priv->history_mutex);
+    ret = history_footprint(self);
+    g_mutex_unlock(&priv->history_mutex);
+
+    return ret;
+}
+
 GtIrc*
 gt_irc_new()
 {
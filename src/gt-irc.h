@@ -41,6 +41,17 @@ typedef enum
 
 GType gt_irc_state_get_type();
 
+typedef enum
+{
+    GT_IRC_OVERLOAD_POLICY_DROP_OLDEST,
+    GT_IRC_OVERLOAD_POLICY_SAMPLE,
+    GT_IRC_OVERLOAD_POLICY_COLLAPSE,
+} GtIrcOverloadPolicy;
+
+#define GT_TYPE_IRC_OVERLOAD_POLICY gt_irc_overload_policy_get_type()
+
+GType gt_irc_overload_policy_get_type();
+
 typedef enum
 {
     GT_IRC_COMMAND_NOTICE,
@@ -54,6 +65,7 @@ typedef enum
     GT_IRC_COMMAND_USERSTATE,
     GT_IRC_COMMAND_ROOMSTATE,
     GT_IRC_COMMAND_CLEARCHAT,
+    GT_IRC_COMMAND_SKIPPED, // Not a real command, stands in for collapsed messages
 } GtIrcCommandType;
 
 typedef enum
@@ -69,6 +81,35 @@ typedef enum
     GT_CHAT_REPLY_ENDOFNAMES = 366,
 } GtChatReplyType;
 
+typedef enum
+{
+    GT_IRC_TAG_BADGES,
+    GT_IRC_TAG_COLOUR,
+    GT_IRC_TAG_DISPLAY_NAME,
+    GT_IRC_TAG_EMOTES,
+    GT_IRC_TAG_EMOTE_SETS,
+    GT_IRC_TAG_ID,
+    GT_IRC_TAG_MOD,
+    GT_IRC_TAG_ROOM_ID,
+    GT_IRC_TAG_SUBSCRIBER,
+    GT_IRC_TAG_TMI_SENT_TS,
+    GT_IRC_TAG_TURBO,
+    GT_IRC_TAG_USER_ID,
+    GT_IRC_TAG_USER_TYPE,
+    GT_IRC_TAG_COUNT,
+} GtIrcTagType;
+
+/* NOTE: Index of the known Twitch tags of a message. The values
+ * point into buf, the message's copy of the line with the tag
+ * section split in place, and are only unescaped once they are
+ * accessed */
+typedef struct
+{
+    gchar* buf;
+    gchar* values[GT_IRC_TAG_COUNT];
+    guint32 escaped;
+} GtIrcTags;
+
 typedef struct
 {
     gchar* target;
@@ -103,10 +144,10 @@ typedef struct
     gchar* target;
     gchar* msg;
     gint user_modes;
-    gchar* display_name;
+    const gchar* display_name;
     GList* badges;
     GList* emotes;
-    gchar* colour;
+    const gchar* colour;
 } GtIrcCommandPrivmsg;
 
 typedef struct
@@ -170,13 +211,20 @@ typedef struct
     gchar* target;
 } GtIrcCommandClearchat;
 
+typedef struct
+{
+    gchar* channel;
+    guint count;
+} GtIrcCommandSkipped;
+
 typedef struct
 {
     gchar* nick;
     gchar* user;
     gchar* host;
     GtIrcCommandType cmd_type;
-    gchar** tags;
+    GtIrcTags tags;
+    gboolean replayed; // From the history kept for the channel, not live
     union
     {
         GtIrcCommandNotice* notice;
@@ -190,10 +238,13 @@ typedef struct
         GtIrcCommandUserstate* userstate;
         GtIrcCommandRoomstate* roomstate;
         GtIrcCommandClearchat* clearchat;
+        GtIrcCommandSkipped* skipped;
     } cmd;
 } GtIrcMessage;
 
-typedef gboolean (*GtTwitchChatSourceFunc) (GtIrcMessage* msg, gpointer udata);
+/* NOTE: The messages are owned by the source and freed after the
+ * callback returns */
+typedef gboolean (*GtTwitchChatSourceBatchFunc) (GPtrArray* msgs, gpointer udata);
 
 typedef struct _GtTwitchChatSource GtTwitchChatSource;
 
@@ -211,9 +262,19 @@ void       gt_irc_join(GtIrc* self, const gchar* channel);
 void       gt_irc_connect_and_join_channel(GtIrc* self, GtChannel* chan);
 void       gt_irc_connect_and_join_channel_async(GtIrc* self, GtChannel* chan, GCancellable* cancel, GAsyncReadyCallback cb, gpointer udata);
 void       gt_irc_part(GtIrc* self);
+void       gt_irc_release(GtIrc* self);
+gboolean   gt_irc_is_idle(GtIrc* self);
 void       gt_irc_privmsg(GtIrc* self, const gchar* msg);
+GtTwitchChatSource* gt_irc_add_channel(GtIrc* self, const gchar* channel, const gchar* room_id);
+void       gt_irc_remove_channel(GtIrc* self, const gchar* channel);
+void       gt_irc_privmsg_channel(GtIrc* self, const gchar* channel, const gchar* msg);
 GtIrcState gt_irc_get_state(GtIrc* self);
+const gchar* gt_irc_message_get_tag(GtIrcMessage* msg, GtIrcTagType tag);
+GtIrcMessage* gt_irc_message_parse(GtIrc* self, const gchar* line, gsize len);
 void       gt_irc_message_free(GtIrcMessage* msg);
+gsize      gt_irc_get_history_footprint(GtIrc* self);
+guint      gt_twitch_chat_source_get_queue_length(GtTwitchChatSource* self);
+guint      gt_twitch_chat_source_get_shed_messages(GtTwitchChatSource* self);
 
 G_END_DECLS
 
@@ -0,0 +1,388 @@
+/*
+ *  This file is part of GNOME Twitch - 'Enjoy Twitch on your GNU/Linux desktop'
+ *  Copyright © 2017 Vincent Szolnoky <vinszent@vinszent.com>
+ *
+ *  GNOME Twitch is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GNOME Twitch is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNOME Twitch. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* NOTE: Builds pages of streams, top games and videos shaped like the
+ * ones the Twitch API sends, including the members GNOME Twitch doesn't
+ * read, and decodes them once through JsonParser and the utils_parse_*
+ * functions and once through the generated decoders. Checks that both
+ * give the same data and reports the time per page */
+
+#include <gtk/gtk.h>
+#include <json-glib/json-glib.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gt-app.h"
+#include "gt-json-decoders.h"
+#include "utils.h"
+
+GtApp* main_app;
+gchar* ORIGINAL_LOCALE;
+
+static gint n_items = 100;
+static gint n_pages = 200;
+
+static GOptionEntry options[] =
+{
+    {"items", 'i', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &n_items, "Number of items per page", "N"},
+    {"pages", 'p', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &n_pages, "Number of times to decode each page", "N"},
+    {NULL}
+};
+
+static const gchar* statuses[] =
+{
+    "Ranked grind, road to 3k | !discord !youtube",
+    "\\\"Chill\\\" speedruns \\u2014 any% WR attempts",
+    "Räksmörgås och fika \\ud83d\\ude00 svenska/english",
+    "初見プレイ！ネタバレ禁止 \\/ no spoilers please",
+};
+
+static const gchar* games[] =
+{
+    "Dota 2", "The Legend of Zelda: Breath of the Wild", "Hearthstone", "PLAYERUNKNOWN'S BATTLEGROUNDS",
+};
+
+static void
+append_images(GString* json, const gchar* name, const gchar* base)
+{
+    g_string_append_printf(json,
+        "\"%s\":{\"large\":\"%s-640x360.jpg\",\"medium\":\"%s-320x180.jpg\","
+        "\"small\":\"%s-80x45.jpg\",\"template\":\"%s-{width}x{height}.jpg\"}",
+        name, base, base, base, base);
+}
+
+static void
+append_channel(GString* json, GRand* rand, gint i)
+{
+    gint64 id = 20000000 + i;
+    const gchar* game = games[i % G_N_ELEMENTS(games)];
+
+    g_string_append_printf(json,
+        "{\"mature\":%s,\"status\":\"%s\",\"broadcaster_language\":\"en\","
+        "\"display_name\":\"Streamer%d\",\"game\":\"%s\",\"language\":\"en\","
+        "\"_id\":%" G_GINT64_FORMAT ",\"name\":\"streamer%d\","
+        "\"created_at\":\"2013-06-03T19:12:02Z\",\"updated_at\":\"2017-09-12T16:39:06Z\","
+        "\"partner\":true,\"logo\":\"https://static-cdn.jtvnw.net/jtv_user_pictures/streamer%d-profile_image-300x300.png\","
+        "\"video_banner\":%s,\"profile_banner\":null,\"profile_banner_background_color\":null,"
+        "\"url\":\"https://www.twitch.tv/streamer%d\",\"views\":%d,\"followers\":%d}",
+        i % 3 == 0 ? "true" : "false", statuses[i % G_N_ELEMENTS(statuses)], i, game,
+        id, i, i,
+        i % 2 == 0 ? "null" : "\"https://static-cdn.jtvnw.net/jtv_user_pictures/banner-1920x1080.png\"",
+        i, g_rand_int_range(rand, 0, 10000000), g_rand_int_range(rand, 0, 1000000));
+}
+
+static gchar*
+make_streams_page(GRand* rand)
+{
+    GString* json = g_string_new(NULL);
+
+    g_string_append_printf(json, "{\"_total\":%d,\"streams\":[", n_items * 10);
+
+    for (gint i = 0; i < n_items; i++)
+    {
+        g_autofree gchar* base = g_strdup_printf("https://static-cdn.jtvnw.net/previews-ttv/live_user_streamer%d", i);
+
+        if (i > 0) g_string_append_c(json, ',');
+
+        g_string_append_printf(json,
+            "{\"_id\":%d,\"game\":\"%s\",\"viewers\":%d,\"video_height\":1080,"
+            "\"average_fps\":59.9997,\"delay\":0,\"created_at\":\"2017-09-12T1%d:%02d:%02dZ\","
+            "\"is_playlist\":false,",
+            26000000 + i, games[i % G_N_ELEMENTS(games)], g_rand_int_range(rand, 0, 100000),
+            i % 10, i % 60, (i * 7) % 60);
+        append_images(json, "preview", base);
+        g_string_append(json, ",\"channel\":");
+        append_channel(json, rand, i);
+        g_string_append_c(json, '}');
+    }
+
+    g_string_append(json, "]}");
+
+    return g_string_free(json, FALSE);
+}
+
+static gchar*
+make_top_games_page(GRand* rand)
+{
+    GString* json = g_string_new(NULL);
+
+    g_string_append_printf(json, "{\"_total\":%d,\"top\":[", n_items * 10);
+
+    for (gint i = 0; i < n_items; i++)
+    {
+        g_autofree gchar* box = g_strdup_printf("https://static-cdn.jtvnw.net/ttv-boxart/Game%%20%d", i);
+        g_autofree gchar* logo = g_strdup_printf("https://static-cdn.jtvnw.net/ttv-logoart/Game%%20%d", i);
+
+        if (i > 0) g_string_append_c(json, ',');
+
+        g_string_append_printf(json,
+            "{\"game\":{\"name\":\"%s %d\",\"popularity\":%d,\"_id\":%d,\"giantbomb_id\":%d,",
+            games[i % G_N_ELEMENTS(games)], i, g_rand_int_range(rand, 0, 100000), 30000 + i, 40000 + i);
+        append_images(json, "box", box);
+        g_string_append_c(json, ',');
+        append_images(json, "logo", logo);
+        g_string_append_printf(json,
+            ",\"localized_name\":\"%s\",\"locale\":\"en-us\"},\"viewers\":%d,\"channels\":%d}",
+            games[i % G_N_ELEMENTS(games)], g_rand_int_range(rand, 0, 100000), g_rand_int_range(rand, 0, 1000));
+    }
+
+    g_string_append(json, "]}");
+
+    return g_string_free(json, FALSE);
+}
+
+static gchar*
+make_videos_page(GRand* rand)
+{
+    GString* json = g_string_new(NULL);
+
+    g_string_append_printf(json, "{\"_total\":%d,\"videos\":[", n_items * 10);
+
+    for (gint i = 0; i < n_items; i++)
+    {
+        g_autofree gchar* base = g_strdup_printf("https://static-cdn.jtvnw.net/s3_vods/vod_%d/thumb/thumb0", i);
+
+        if (i > 0) g_string_append_c(json, ',');
+
+        g_string_append_printf(json,
+            "{\"title\":\"%s\",\"description\":null,\"description_html\":null,"
+            "\"broadcast_id\":%d,\"broadcast_type\":\"archive\",\"status\":\"recorded\","
+            "\"tag_list\":\"\",\"views\":%d,\"url\":\"https://www.twitch.tv/videos/%d\","
+            "\"language\":\"en\",\"created_at\":\"2017-09-1%dT12:00:%02dZ\",\"viewable\":\"public\","
+            "\"viewable_at\":null,\"published_at\":\"2017-09-1%dT12:00:%02dZ\",\"_id\":\"v%d\","
+            "\"recorded_at\":\"2017-09-1%dT12:00:%02dZ\",\"game\":\"%s\",\"length\":%d,",
+            statuses[i % G_N_ELEMENTS(statuses)], 26000000 + i, g_rand_int_range(rand, 0, 100000),
+            170000000 + i, i % 10, i % 60, i % 10, i % 60, 170000000 + i, i % 10, i % 60,
+            games[i % G_N_ELEMENTS(games)], g_rand_int_range(rand, 60, 36000));
+        append_images(json, "preview", base);
+        g_string_append_printf(json,
+            ",\"animated_preview_url\":\"%s-preview.mp4\","
+            "\"thumbnails\":{\"large\":[{\"type\":\"generated\",\"url\":\"%s-640x360.jpg\"}],"
+            "\"medium\":[{\"type\":\"generated\",\"url\":\"%s-320x180.jpg\"}]},"
+            "\"fps\":{\"chunked\":59.9997,\"high\":30.0,\"low\":30.0},"
+            "\"resolutions\":{\"chunked\":\"1920x1080\",\"high\":\"1280x720\"},\"channel\":",
+            base, base, base);
+        append_channel(json, rand, i);
+        g_string_append_c(json, '}');
+    }
+
+    g_string_append(json, "]}");
+
+    return g_string_free(json, FALSE);
+}
+
+typedef gpointer (*ParseFunc) (JsonReader* reader, GError** error);
+
+/* NOTE: The way the item containers read pages before the generated
+ * decoders, wrapper is the member items are wrapped in, if any */
+static GList*
+decode_dom(const gchar* json, const gchar* member, const gchar* wrapper,
+    ParseFunc parse, GDestroyNotify free_func, GError** error)
+{
+    g_autoptr(JsonParser) parser = json_parser_new();
+    g_autoptr(JsonReader) reader = NULL;
+    GList* items = NULL;
+
+    if (!json_parser_load_from_data(parser, json, -1, error))
+        return NULL;
+
+    reader = json_reader_new(json_parser_get_root(parser));
+
+    if (!json_reader_read_member(reader, member))
+    {
+        g_propagate_error(error, g_error_copy(json_reader_get_error(reader)));
+        return NULL;
+    }
+
+    for (gint i = 0; i < json_reader_count_elements(reader); i++)
+    {
+        gpointer item;
+
+        json_reader_read_element(reader, i);
+        if (wrapper) json_reader_read_member(reader, wrapper);
+
+        item = parse(reader, error);
+
+        if (!item)
+        {
+            g_list_free_full(items, free_func);
+            return NULL;
+        }
+
+        items = g_list_prepend(items, item);
+
+        if (wrapper) json_reader_end_member(reader);
+        json_reader_end_element(reader);
+    }
+
+    return g_list_reverse(items);
+}
+
+static gboolean
+time_equals(GDateTime* a, GDateTime* b)
+{
+    return a == b || (a && b && g_date_time_equal(a, b));
+}
+
+static gboolean
+channel_equals(GtChannelData* a, GtChannelData* b)
+{
+    return STRING_EQUALS(a->id, b->id) && STRING_EQUALS(a->name, b->name) &&
+        STRING_EQUALS(a->display_name, b->display_name) && STRING_EQUALS(a->status, b->status) &&
+        STRING_EQUALS(a->video_banner_url, b->video_banner_url) && STRING_EQUALS(a->logo_url, b->logo_url) &&
+        STRING_EQUALS(a->profile_url, b->profile_url) && STRING_EQUALS(a->game, b->game) &&
+        STRING_EQUALS(a->preview_url, b->preview_url) && a->viewers == b->viewers &&
+        a->online == b->online && time_equals(a->stream_started_time, b->stream_started_time);
+}
+
+static gboolean
+game_equals(GtGameData* a, GtGameData* b)
+{
+    return STRING_EQUALS(a->id, b->id) && STRING_EQUALS(a->name, b->name) &&
+        STRING_EQUALS(a->preview_url, b->preview_url) && STRING_EQUALS(a->logo_url, b->logo_url);
+}
+
+static gboolean
+vod_equals(GtVODData* a, GtVODData* b)
+{
+    return STRING_EQUALS(a->id, b->id) && STRING_EQUALS(a->broadcast_id, b->broadcast_id) &&
+        time_equals(a->created_at, b->created_at) && time_equals(a->published_at, b->published_at) &&
+        STRING_EQUALS(a->description, b->description) && STRING_EQUALS(a->game, b->game) &&
+        STRING_EQUALS(a->language, b->language) && a->length == b->length &&
+        STRING_EQUALS(a->preview.large, b->preview.large) && STRING_EQUALS(a->preview.medium, b->preview.medium) &&
+        STRING_EQUALS(a->preview.small, b->preview.small) && STRING_EQUALS(a->preview.template, b->preview.template) &&
+        STRING_EQUALS(a->title, b->title) && STRING_EQUALS(a->url, b->url) &&
+        a->views == b->views && STRING_EQUALS(a->tag_list, b->tag_list);
+}
+
+typedef struct
+{
+    const gchar* title;
+    gchar* (*make) (GRand* rand);
+    const gchar* member;
+    const gchar* wrapper;
+    ParseFunc parse;
+    GList* (*decode) (const gchar* data, gsize length, GError** error);
+    GEqualFunc equals;
+    GDestroyNotify free_func;
+} BenchPage;
+
+static gboolean
+bench(const BenchPage* page, GRand* rand)
+{
+    g_autofree gchar* json = page->make(rand);
+    gsize length = strlen(json);
+    g_autoptr(GError) err = NULL;
+    GList* dom_items;
+    GList* gen_items;
+    gboolean same;
+    gint64 start;
+    gdouble dom_usec, gen_usec;
+
+    dom_items = decode_dom(json, page->member, page->wrapper, page->parse, page->free_func, &err);
+
+    if (err)
+    {
+        g_printerr("%s: JsonParser failed: %s\n", page->title, err->message);
+        return FALSE;
+    }
+
+    gen_items = page->decode(json, length, &err);
+
+    if (err)
+    {
+        g_printerr("%s: Generated decoder failed: %s\n", page->title, err->message);
+        g_list_free_full(dom_items, page->free_func);
+        return FALSE;
+    }
+
+    same = g_list_length(dom_items) == g_list_length(gen_items);
+
+    for (GList* a = dom_items, *b = gen_items; same && a != NULL; a = a->next, b = b->next)
+        same = page->equals(a->data, b->data);
+
+    g_list_free_full(dom_items, page->free_func);
+    g_list_free_full(gen_items, page->free_func);
+
+    if (!same)
+    {
+        g_printerr("%s: Decoders disagree\n", page->title);
+        return FALSE;
+    }
+
+    /* NOTE: The utils_parse_* functions need somewhere to put errors */
+    start = g_get_monotonic_time();
+    for (gint i = 0; i < n_pages; i++)
+    {
+        g_list_free_full(decode_dom(json, page->member, page->wrapper, page->parse, page->free_func, &err), page->free_func);
+        g_clear_error(&err);
+    }
+    dom_usec = (gdouble) (g_get_monotonic_time() - start) / n_pages;
+
+    start = g_get_monotonic_time();
+    for (gint i = 0; i < n_pages; i++)
+    {
+        g_list_free_full(page->decode(json, length, &err), page->free_func);
+        g_clear_error(&err);
+    }
+    gen_usec = (gdouble) (g_get_monotonic_time() - start) / n_pages;
+
+    g_print("%-10s %4d items, %4" G_GSIZE_FORMAT " KiB: JsonParser %8.1f us/page, generated %8.1f us/page, %.1fx\n",
+        page->title, n_items, length / 1024, dom_usec, gen_usec, gen_usec > 0 ? dom_usec / gen_usec : 0);
+
+    return TRUE;
+}
+
+gint
+main(int argc, char** argv)
+{
+    g_autoptr(GOptionContext) ctx = NULL;
+    g_autoptr(GError) err = NULL;
+    g_autoptr(GRand) rand = NULL;
+    gboolean ok = TRUE;
+
+    const BenchPage pages[] =
+    {
+        {"Streams", make_streams_page, "streams", NULL, (ParseFunc) utils_parse_stream_from_json,
+         gt_json_decode_streams_page, (GEqualFunc) channel_equals, (GDestroyNotify) gt_channel_data_free},
+        {"Top games", make_top_games_page, "top", "game", (ParseFunc) utils_parse_game_from_json,
+         gt_json_decode_top_games_page, (GEqualFunc) game_equals, (GDestroyNotify) gt_game_data_free},
+        {"Videos", make_videos_page, "videos", NULL, (ParseFunc) utils_parse_vod_from_json,
+         gt_json_decode_videos_page, (GEqualFunc) vod_equals, (GDestroyNotify) gt_vod_data_free},
+    };
+
+    ctx = g_option_context_new("- decode pages of Twitch API responses");
+    g_option_context_add_main_entries(ctx, options, NULL);
+
+    if (!g_option_context_parse(ctx, &argc, &argv, &err))
+    {
+        g_printerr("%s\n", err->message);
+
+        return EXIT_FAILURE;
+    }
+
+    n_items = MAX(n_items, 1);
+    n_pages = MAX(n_pages, 1);
+    rand = g_rand_new_with_seed(42);
+
+    g_print("Decoding each page %d times\n\n", n_pages);
+
+    for (guint i = 0; i < G_N_ELEMENTS(pages); i++)
+        ok = bench(&pages[i], rand) && ok;
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,733 @@
+/*
+ *  This file is part of GNOME Twitch - 'Enjoy Twitch on your GNU/Linux desktop'
+ *  Copyright © 2017 Vincent Szolnoky <vinszent@vinszent.com>
+ *
+ *  GNOME Twitch is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GNOME Twitch is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNOME Twitch. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "gt-json-scanner.h"
+#include "utils.h"
+
+/* NOTE: Only guards skipping unknown members against runaway nesting,
+ * nothing Twitch sends comes close */
+#define MAX_DEPTH 64
+
+/* NOTE: Longer than any 64 bit integer or double JSON would sensibly have */
+#define MAX_NUMBER_LENGTH 64
+
+static inline gchar
+peek(GtJsonScanner* scanner)
+{
+    if (scanner->error)
+        return 0;
+
+    while (scanner->pos < scanner->end &&
+        (*scanner->pos == ' ' || *scanner->pos == '\n' ||
+            *scanner->pos == '\r' || *scanner->pos == '\t'))
+        scanner->pos++;
+
+    return scanner->pos < scanner->end ? *scanner->pos : 0;
+}
+
+static void
+set_unexpected(GtJsonScanner* scanner)
+{
+    if (scanner->pos >= scanner->end)
+        gt_json_scanner_set_error(scanner, "Unexpected end of JSON");
+    else if (g_ascii_isprint(*scanner->pos))
+    {
+        gt_json_scanner_set_error(scanner, "Unexpected character '%c' at offset %" G_GSIZE_FORMAT,
+            *scanner->pos, (gsize) (scanner->pos - scanner->start));
+    }
+    else
+    {
+        gt_json_scanner_set_error(scanner, "Unexpected byte 0x%02x at offset %" G_GSIZE_FORMAT,
+            (guchar) *scanner->pos, (gsize) (scanner->pos - scanner->start));
+    }
+}
+
+static gboolean
+expect(GtJsonScanner* scanner, gchar c)
+{
+    if (peek(scanner) != c)
+    {
+        set_unexpected(scanner);
+        return FALSE;
+    }
+
+    scanner->pos++;
+
+    return TRUE;
+}
+
+static gboolean
+scan_literal(GtJsonScanner* scanner, const gchar* literal)
+{
+    gsize len = strlen(literal);
+
+    if ((gsize) (scanner->end - scanner->pos) < len ||
+        memcmp(scanner->pos, literal, len) != 0)
+    {
+        set_unexpected(scanner);
+        return FALSE;
+    }
+
+    scanner->pos += len;
+
+    return TRUE;
+}
+
+static gboolean
+scan_hex(GtJsonScanner* scanner, const gchar** p, gunichar* c)
+{
+    *c = 0;
+
+    if (scanner->end - *p < 4)
+    {
+        scanner->pos = scanner->end;
+        set_unexpected(scanner);
+        return FALSE;
+    }
+
+    for (gint i = 0; i < 4; i++, (*p)++)
+    {
+        gint digit = g_ascii_xdigit_value(**p);
+
+        if (digit < 0)
+        {
+            scanner->pos = *p;
+            set_unexpected(scanner);
+            return FALSE;
+        }
+
+        *c = (*c << 4) | digit;
+    }
+
+    return TRUE;
+}
+
+/* NOTE: Called with p just past a backslash */
+static gboolean
+scan_escape(GtJsonScanner* scanner, const gchar** p, GString* out)
+{
+    gunichar c;
+
+    if (*p >= scanner->end)
+    {
+        scanner->pos = scanner->end;
+        set_unexpected(scanner);
+        return FALSE;
+    }
+
+    switch (*(*p)++)
+    {
+        case '"': g_string_append_c(out, '"'); return TRUE;
+        case '\\': g_string_append_c(out, '\\'); return TRUE;
+        case '/': g_string_append_c(out, '/'); return TRUE;
+        case 'b': g_string_append_c(out, '\b'); return TRUE;
+        case 'f': g_string_append_c(out, '\f'); return TRUE;
+        case 'n': g_string_append_c(out, '\n'); return TRUE;
+        case 'r': g_string_append_c(out, '\r'); return TRUE;
+        case 't': g_string_append_c(out, '\t'); return TRUE;
+        case 'u': break;
+        default:
+            scanner->pos = *p - 1;
+            set_unexpected(scanner);
+            return FALSE;
+    }
+
+    if (!scan_hex(scanner, p, &c))
+        return FALSE;
+
+    /* NOTE: Characters outside the BMP come as a surrogate pair,
+     * a lone surrogate becomes the replacement character */
+    if (c >= 0xD800 && c <= 0xDBFF)
+    {
+        gunichar low;
+
+        if (scanner->end - *p >= 6 && (*p)[0] == '\\' && (*p)[1] == 'u')
+        {
+            const gchar* q = *p + 2;
+
+            if (!scan_hex(scanner, &q, &low))
+                return FALSE;
+
+            if (low >= 0xDC00 && low <= 0xDFFF)
+            {
+                c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                *p = q;
+            }
+            else
+                c = 0xFFFD;
+        }
+        else
+            c = 0xFFFD;
+    }
+    else if (c >= 0xDC00 && c <= 0xDFFF)
+        c = 0xFFFD;
+
+    g_string_append_unichar(out, c);
+
+    return TRUE;
+}
+
+/* NOTE: Called at the opening quote, leaves the unescaped string in out */
+static gboolean
+scan_string(GtJsonScanner* scanner, GString* out)
+{
+    const gchar* p = scanner->pos + 1;
+    const gchar* run = p;
+
+    g_string_truncate(out, 0);
+
+    while (p < scanner->end)
+    {
+        gchar c = *p;
+
+        if (c == '"')
+        {
+            g_string_append_len(out, run, p - run);
+            scanner->pos = p + 1;
+            return TRUE;
+        }
+        else if (c == '\\')
+        {
+            g_string_append_len(out, run, p - run);
+            p++;
+
+            if (!scan_escape(scanner, &p, out))
+                return FALSE;
+
+            run = p;
+        }
+        else if ((guchar) c < 0x20)
+        {
+            scanner->pos = p;
+            set_unexpected(scanner);
+            return FALSE;
+        }
+        else
+            p++;
+    }
+
+    scanner->pos = scanner->end;
+    set_unexpected(scanner);
+
+    return FALSE;
+}
+
+static gboolean
+skip_string(GtJsonScanner* scanner)
+{
+    for (const gchar* p = scanner->pos + 1; p < scanner->end; p++)
+    {
+        if (*p == '"')
+        {
+            scanner->pos = p + 1;
+            return TRUE;
+        }
+        else if (*p == '\\')
+            p++;
+    }
+
+    scanner->pos = scanner->end;
+    set_unexpected(scanner);
+
+    return FALSE;
+}
+
+static gboolean
+scan_number(GtJsonScanner* scanner, gint64* int_value, gdouble* double_value, gboolean* is_double)
+{
+    const gchar* p = scanner->pos;
+    gchar buf[MAX_NUMBER_LENGTH + 1];
+    gchar* end = NULL;
+
+    *is_double = FALSE;
+
+#define SCAN_DIGITS()                                                   \
+    G_STMT_START                                                        \
+    {                                                                   \
+        if (p >= scanner->end || !g_ascii_isdigit(*p))                  \
+        {                                                               \
+            scanner->pos = p;                                           \
+            set_unexpected(scanner);                                    \
+            return FALSE;                                               \
+        }                                                               \
+        while (p < scanner->end && g_ascii_isdigit(*p)) p++;            \
+    } G_STMT_END
+
+    if (p < scanner->end && *p == '-') p++;
+
+    SCAN_DIGITS();
+
+    if (p < scanner->end && *p == '.')
+    {
+        *is_double = TRUE;
+        p++;
+        SCAN_DIGITS();
+    }
+
+    if (p < scanner->end && (*p == 'e' || *p == 'E'))
+    {
+        *is_double = TRUE;
+        p++;
+        if (p < scanner->end && (*p == '+' || *p == '-')) p++;
+        SCAN_DIGITS();
+    }
+
+#undef SCAN_DIGITS
+
+    if (p - scanner->pos > MAX_NUMBER_LENGTH)
+    {
+        gt_json_scanner_set_error(scanner, "Number too long at offset %" G_GSIZE_FORMAT,
+            (gsize) (scanner->pos - scanner->start));
+        return FALSE;
+    }
+
+    /* NOTE: The data isn't necessarily nul terminated */
+    memcpy(buf, scanner->pos, p - scanner->pos);
+    buf[p - scanner->pos] = '\0';
+
+    if (*is_double)
+        *double_value = g_ascii_strtod(buf, &end);
+    else
+        *int_value = g_ascii_strtoll(buf, &end, 10);
+
+    scanner->pos = p;
+
+    return TRUE;
+}
+
+static void
+skip_value(GtJsonScanner* scanner, gint depth)
+{
+    gint64 int_value;
+    gdouble double_value;
+    gboolean is_double;
+
+    if (depth > MAX_DEPTH)
+    {
+        gt_json_scanner_set_error(scanner, "JSON nested too deeply at offset %" G_GSIZE_FORMAT,
+            (gsize) (scanner->pos - scanner->start));
+        return;
+    }
+
+    switch (peek(scanner))
+    {
+        case '{':
+            gt_json_scanner_begin_object(scanner);
+            while (gt_json_scanner_next_member(scanner))
+                skip_value(scanner, depth + 1);
+            break;
+        case '[':
+            gt_json_scanner_begin_array(scanner);
+            while (gt_json_scanner_next_element(scanner))
+                skip_value(scanner, depth + 1);
+            break;
+        case '"':
+            skip_string(scanner);
+            break;
+        case 't':
+            scan_literal(scanner, "true");
+            break;
+        case 'f':
+            scan_literal(scanner, "false");
+            break;
+        case 'n':
+            scan_literal(scanner, "null");
+            break;
+        case 0:
+            if (!scanner->error)
+                set_unexpected(scanner);
+            break;
+        default:
+            scan_number(scanner, &int_value, &double_value, &is_double);
+            break;
+    }
+}
+
+void
+gt_json_scanner_init(GtJsonScanner* scanner, const gchar* data, gsize length)
+{
+    g_assert_nonnull(scanner);
+    g_assert(data != NULL || length == 0);
+
+    scanner->start = data;
+    scanner->pos = data;
+    scanner->end = data + length;
+    scanner->first = TRUE;
+    scanner->name = g_string_sized_new(32);
+    scanner->error = NULL;
+}
+
+void
+gt_json_scanner_clear(GtJsonScanner* scanner)
+{
+    g_assert_nonnull(scanner);
+
+    if (scanner->name)
+        g_string_free(scanner->name, TRUE);
+    scanner->name = NULL;
+
+    g_clear_error(&scanner->error);
+}
+
+/* NOTE: Checks that nothing but whitespace is left and hands over the
+ * first error, if there was one */
+gboolean
+gt_json_scanner_finish(GtJsonScanner* scanner, GError** error)
+{
+    g_assert_nonnull(scanner);
+
+    if (peek(scanner) != 0)
+    {
+        gt_json_scanner_set_error(scanner, "Trailing data at offset %" G_GSIZE_FORMAT,
+            (gsize) (scanner->pos - scanner->start));
+    }
+
+    if (scanner->error)
+    {
+        g_propagate_error(error, g_steal_pointer(&scanner->error));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+gboolean
+gt_json_scanner_failed(GtJsonScanner* scanner)
+{
+    g_assert_nonnull(scanner);
+
+    return scanner->error != NULL;
+}
+
+void
+gt_json_scanner_set_error(GtJsonScanner* scanner, const gchar* format, ...)
+{
+    g_assert_nonnull(scanner);
+
+    va_list args;
+    g_autofree gchar* msg = NULL;
+
+    if (scanner->error)
+        return;
+
+    va_start(args, format);
+    msg = g_strdup_vprintf(format, args);
+    va_end(args);
+
+    scanner->error = g_error_new_literal(GT_UTILS_ERROR, GT_UTILS_ERROR_JSON, msg);
+}
+
+gboolean
+gt_json_scanner_begin_object(GtJsonScanner* scanner)
+{
+    if (!expect(scanner, '{'))
+        return FALSE;
+
+    scanner->first = TRUE;
+
+    return TRUE;
+}
+
+/* NOTE: Moves to the value of the next member and leaves its name in
+ * scanner->name, returns FALSE once the object ends or on error */
+gboolean
+gt_json_scanner_next_member(GtJsonScanner* scanner)
+{
+    gchar c = peek(scanner);
+
+    if (c == '}')
+    {
+        scanner->pos++;
+        scanner->first = FALSE;
+        return FALSE;
+    }
+
+    if (!scanner->first)
+    {
+        if (c != ',')
+        {
+            set_unexpected(scanner);
+            return FALSE;
+        }
+
+        scanner->pos++;
+        c = peek(scanner);
+    }
+
+    scanner->first = FALSE;
+
+    if (c != '"')
+    {
+        set_unexpected(scanner);
+        return FALSE;
+    }
+
+    if (!scan_string(scanner, scanner->name))
+        return FALSE;
+
+    return expect(scanner, ':');
+}
+
+gboolean
+gt_json_scanner_begin_array(GtJsonScanner* scanner)
+{
+    if (!expect(scanner, '['))
+        return FALSE;
+
+    scanner->first = TRUE;
+
+    return TRUE;
+}
+
+/* NOTE: Moves to the next element, returns FALSE once the array ends
+ * or on error */
+gboolean
+gt_json_scanner_next_element(GtJsonScanner* scanner)
+{
+    gchar c = peek(scanner);
+
+    if (c == ']')
+    {
+        scanner->pos++;
+        scanner->first = FALSE;
+        return FALSE;
+    }
+
+    if (scanner->error)
+        return FALSE;
+
+    if (!scanner->first)
+    {
+        if (c != ',')
+        {
+            set_unexpected(scanner);
+            return FALSE;
+        }
+
+        scanner->pos++;
+    }
+
+    scanner->first = FALSE;
+
+    return TRUE;
+}
+
+gboolean
+gt_json_scanner_read_null(GtJsonScanner* scanner)
+{
+    if (peek(scanner) != 'n')
+        return FALSE;
+
+    return scan_literal(scanner, "null");
+}
+
+gchar*
+gt_json_scanner_read_string(GtJsonScanner* scanner)
+{
+    const gchar* p;
+    g_autoptr(GString) str = NULL;
+
+    if (gt_json_scanner_read_null(scanner) || scanner->error)
+        return NULL;
+
+    if (peek(scanner) != '"')
+    {
+        gt_json_scanner_set_error(scanner, "Member '%s' wasn't a string", scanner->name->str);
+        return NULL;
+    }
+
+    /* NOTE: Most strings don't have any escapes and can be copied straight
+     * out of the data */
+    for (p = scanner->pos + 1; p < scanner->end; p++)
+    {
+        if (*p == '"')
+        {
+            const gchar* start = scanner->pos + 1;
+
+            if (!g_utf8_validate(start, p - start, NULL))
+                break;
+
+            scanner->pos = p + 1;
+
+            return g_strndup(start, p - start);
+        }
+        else if (*p == '\\' || (guchar) *p < 0x20)
+            break;
+    }
+
+    str = g_string_new(NULL);
+
+    if (!scan_string(scanner, str))
+        return NULL;
+
+    if (!g_utf8_validate(str->str, str->len, NULL))
+    {
+        gt_json_scanner_set_error(scanner, "Member '%s' wasn't valid UTF-8", scanner->name->str);
+        return NULL;
+    }
+
+    return g_string_free(g_steal_pointer(&str), FALSE);
+}
+
+/* NOTE: Twitch sends IDs as either integers or strings */
+gchar*
+gt_json_scanner_read_id(GtJsonScanner* scanner)
+{
+    gchar c = peek(scanner);
+
+    if (c == '"')
+        return gt_json_scanner_read_string(scanner);
+    else if (c == '-' || g_ascii_isdigit(c))
+    {
+        gint64 int_value;
+        gdouble double_value;
+        gboolean is_double;
+
+        if (scan_number(scanner, &int_value, &double_value, &is_double) && !is_double)
+            return g_strdup_printf("%" G_GINT64_FORMAT, int_value);
+    }
+
+    gt_json_scanner_set_error(scanner, "Member '%s' was of incorrect format", scanner->name->str);
+
+    return NULL;
+}
+
+gint64
+gt_json_scanner_read_int(GtJsonScanner* scanner)
+{
+    gint64 int_value = 0;
+    gdouble double_value = 0;
+    gboolean is_double = FALSE;
+    gchar c;
+
+    if (gt_json_scanner_read_null(scanner))
+        return 0;
+
+    c = peek(scanner);
+
+    if (c != '-' && !g_ascii_isdigit(c))
+    {
+        gt_json_scanner_set_error(scanner, "Member '%s' wasn't a number", scanner->name->str);
+        return 0;
+    }
+
+    if (!scan_number(scanner, &int_value, &double_value, &is_double))
+        return 0;
+
+    return is_double ? (gint64) double_value : int_value;
+}
+
+GDateTime*
+gt_json_scanner_read_time(GtJsonScanner* scanner)
+{
+    g_autofree gchar* str = gt_json_scanner_read_string(scanner);
+    g_autoptr(GError) err = NULL;
+    GDateTime* ret;
+
+    if (!str)
+        return NULL;
+
+    ret = utils_parse_time_iso_8601(str, &err);
+
+    if (err)
+        gt_json_scanner_set_error(scanner, "%s", err->message);
+
+    return ret;
+}
+
+GDateTime*
+gt_json_scanner_read_timeval(GtJsonScanner* scanner)
+{
+    g_autofree gchar* str = gt_json_scanner_read_string(scanner);
+    GTimeVal time;
+
+    if (!str)
+        return NULL;
+
+    if (!g_time_val_from_iso8601(str, &time))
+    {
+        gt_json_scanner_set_error(scanner, "Couldn't parse time from string %s", str);
+        return NULL;
+    }
+
+    return g_date_time_new_from_timeval_utc(&time);
+}
+
+void
+gt_json_scanner_skip(GtJsonScanner* scanner)
+{
+    skip_value(scanner, 0);
+}
+
+/* NOTE: Decodes the array in member of the top level object of a page
+ * of results, e.g. 'streams', into a list of items */
+GList*
+gt_json_decode_page(const gchar* data, gsize length, const gchar* member,
+    GtJsonDecodeFunc decode, GDestroyNotify free_func, GError** error)
+{
+    g_assert_nonnull(member);
+    g_assert_nonnull(decode);
+    g_assert_nonnull(free_func);
+
+    GtJsonScanner scanner;
+    GList* items = NULL;
+    gboolean found = FALSE;
+
+    gt_json_scanner_init(&scanner, data, length);
+
+    if (gt_json_scanner_begin_object(&scanner))
+    {
+        while (gt_json_scanner_next_member(&scanner))
+        {
+            if (found || !STRING_EQUALS(scanner.name->str, member))
+            {
+                gt_json_scanner_skip(&scanner);
+                continue;
+            }
+
+            found = TRUE;
+
+            if (!gt_json_scanner_begin_array(&scanner))
+                break;
+
+            while (gt_json_scanner_next_element(&scanner))
+            {
+                gpointer item = decode(&scanner);
+
+                if (!item)
+                    break;
+
+                items = g_list_prepend(items, item);
+            }
+        }
+    }
+
+    if (!found)
+        gt_json_scanner_set_error(&scanner, "Missing member '%s'", member);
+
+    if (!gt_json_scanner_finish(&scanner, error))
+    {
+        g_list_free_full(items, free_func);
+        items = NULL;
+    }
+
+    gt_json_scanner_clear(&scanner);
+
+    return g_list_reverse(items);
+}
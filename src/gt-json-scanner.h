@@ -0,0 +1,62 @@
+/*
+ *  This file is part of GNOME Twitch - 'Enjoy Twitch on your GNU/Linux desktop'
+ *  Copyright © 2017 Vincent Szolnoky <vinszent@vinszent.com>
+ *
+ *  GNOME Twitch is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GNOME Twitch is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNOME Twitch. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GT_JSON_SCANNER_H
+#define GT_JSON_SCANNER_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* NOTE: A pull scanner over a JSON document in memory, used by the
+ * decoders generated from gt-json-decoders.schema. The first error is
+ * kept in the scanner and makes every following call fail, so callers
+ * only need to check it once they are done */
+typedef struct
+{
+    const gchar* start;
+    const gchar* pos;
+    const gchar* end;
+    gboolean first; // Nothing read yet in the current object or array
+    GString* name; // Name of the last member
+    GError* error;
+} GtJsonScanner;
+
+typedef gpointer (*GtJsonDecodeFunc) (GtJsonScanner* scanner);
+
+void        gt_json_scanner_init(GtJsonScanner* scanner, const gchar* data, gsize length);
+void        gt_json_scanner_clear(GtJsonScanner* scanner);
+gboolean    gt_json_scanner_finish(GtJsonScanner* scanner, GError** error);
+gboolean    gt_json_scanner_failed(GtJsonScanner* scanner);
+void        gt_json_scanner_set_error(GtJsonScanner* scanner, const gchar* format, ...) G_GNUC_PRINTF(2, 3);
+gboolean    gt_json_scanner_begin_object(GtJsonScanner* scanner);
+gboolean    gt_json_scanner_next_member(GtJsonScanner* scanner);
+gboolean    gt_json_scanner_begin_array(GtJsonScanner* scanner);
+gboolean    gt_json_scanner_next_element(GtJsonScanner* scanner);
+gboolean    gt_json_scanner_read_null(GtJsonScanner* scanner);
+gchar*      gt_json_scanner_read_string(GtJsonScanner* scanner);
+gchar*      gt_json_scanner_read_id(GtJsonScanner* scanner);
+gint64      gt_json_scanner_read_int(GtJsonScanner* scanner);
+GDateTime*  gt_json_scanner_read_time(GtJsonScanner* scanner);
+GDateTime*  gt_json_scanner_read_timeval(GtJsonScanner* scanner);
+void        gt_json_scanner_skip(GtJsonScanner* scanner);
+GList*      gt_json_decode_page(const gchar* data, gsize length, const gchar* member, GtJsonDecodeFunc decode, GDestroyNotify free_func, GError** error);
+
+G_END_DECLS
+
+#endif
@@ -24,6 +24,7 @@
 #include "gt-win.h"
 #include "gt-channels-container-child.h"
 #include "gt-channel.h"
+#include "gt-json-decoders.h"
 #include "utils.h"
 #include <glib/gi18n.h>
 
@@ -39,7 +40,6 @@ typedef struct
 {
     gboolean search_offline;
     gchar* query;
-    JsonParser* json_parser;
     GCancellable* cancel;
 } GtSearchChannelContainerPrivate;
 
@@ -75,7 +75,7 @@ static void
 process_json_cb(GObject* source,
     GAsyncResult* res, gpointer udata)
 {
-    RETURN_IF_FAIL(JSON_IS_PARSER(source));
+    RETURN_IF_FAIL(G_IS_MEMORY_OUTPUT_STREAM(source));
     RETURN_IF_FAIL(G_IS_ASYNC_RESULT(res));
     RETURN_IF_FAIL(udata != NULL);
 
@@ -90,17 +90,16 @@ process_json_cb(GObject* source,
         return;
     }
 
-    GtSearchChannelContainerPrivate* priv = gt_search_channel_container_get_instance_private(self);
-    g_autoptr(JsonReader) reader = NULL;
+    g_autoptr(GBytes) bytes = NULL;
+    g_autoptr(GtChannelDataList) data = NULL;
     g_autoptr(GtChannelList) items = NULL;
     g_autoptr(GError) err = NULL;
     gint amount = GPOINTER_TO_INT(g_object_steal_data(G_OBJECT(self), "amount"));
     gint offset = GPOINTER_TO_INT(g_object_steal_data(G_OBJECT(self), "offset"));
     gboolean offline = GPOINTER_TO_INT(g_object_steal_data(G_OBJECT(self), "offline"));
-    gint total;
     gint page_amount = offline ? 100 : 90;
 
-    json_parser_load_from_stream_finish(priv->json_parser, res, &err);
+    g_output_stream_splice_finish(G_OUTPUT_STREAM(source), res, &err);
 
     if (g_error_matches(err, G_IO_ERROR, G_IO_ERROR_CANCELLED))
     {
@@ -114,51 +113,25 @@ process_json_cb(GObject* source,
         return;
     }
 
-    reader = json_reader_new(json_parser_get_root(priv->json_parser));
+    bytes = g_memory_output_stream_steal_as_bytes(G_MEMORY_OUTPUT_STREAM(source));
+
+    data = offline ?
+        gt_json_decode_channels_page(g_bytes_get_data(bytes, NULL), g_bytes_get_size(bytes), &err) :
+        gt_json_decode_streams_page(g_bytes_get_data(bytes, NULL), g_bytes_get_size(bytes), &err);
 
-    /* TODO: Handle error */
-    if (!json_reader_read_member(reader, offline ? "channels" : "streams"))
+    if (err)
     {
-        WARNING("Unable to process JSON because: %s",
-            json_reader_get_error(reader)->message);
-        gt_item_container_show_error(GT_ITEM_CONTAINER(self),
-            json_reader_get_error(reader));
+        WARNING("Unable to process JSON because: %s", err->message);
+        gt_item_container_show_error(GT_ITEM_CONTAINER(self), err);
         return;
     }
 
-    total = MIN(amount + offset % page_amount, json_reader_count_elements(reader));
+    /* NOTE: Twitch is asked for whole pages, only take the part that was requested */
+    GList* l = g_list_nth(data, offset % page_amount);
+    for (gint i = 0; l != NULL && i < amount; l = l->next, i++)
+        items = g_list_prepend(items, gt_channel_new(g_steal_pointer(&l->data)));
 
-    for (gint i = offset % page_amount; i < total; i++)
-    {
-        g_autoptr(GtChannelData) data = NULL;
-
-        /* TODO: Handle error */
-        if (!json_reader_read_element(reader, i))
-        {
-            WARNING("Unable to process JSON because: %s",
-                json_reader_get_error(reader)->message);
-            gt_item_container_show_error(GT_ITEM_CONTAINER(self),
-                json_reader_get_error(reader));
-            return;
-        }
-
-        data = offline ?
-            utils_parse_channel_from_json(reader, &err) :
-            utils_parse_stream_from_json(reader, &err);
-
-        if (err)
-        {
-            WARNING("Unable to process JSON because: %s", err->message);
-            gt_item_container_show_error(GT_ITEM_CONTAINER(self), err);
-            return;
-        }
-
-        items = g_list_append(items, gt_channel_new(g_steal_pointer(&data)));
-
-        json_reader_end_element(reader);
-    }
-
-    json_reader_end_member(reader);
+    items = g_list_reverse(items);
 
     gt_item_container_append_items(GT_ITEM_CONTAINER(self), g_steal_pointer(&items));
     gt_item_container_set_fetching_items(GT_ITEM_CONTAINER(self), FALSE);
@@ -177,6 +150,7 @@ handle_response_cb(GtHTTP* http,
     if (!self) {TRACE("Unreffed while waiting"); return;}
 
     GtSearchChannelContainerPrivate* priv = gt_search_channel_container_get_instance_private(self);
+    g_autoptr(GOutputStream) output = NULL;
     GInputStream* istream = res; /* NOTE: Owned by GtHTTP */
 
     if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
@@ -193,8 +167,11 @@ handle_response_cb(GtHTTP* http,
 
     RETURN_IF_FAIL(G_IS_INPUT_STREAM(res));
 
-    json_parser_load_from_stream_async(priv->json_parser, res,
-        priv->cancel, process_json_cb, g_steal_pointer(&ref));
+    output = g_memory_output_stream_new_resizable();
+
+    g_output_stream_splice_async(output, G_INPUT_STREAM(res),
+        G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE | G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+        G_PRIORITY_DEFAULT, priv->cancel, process_json_cb, g_steal_pointer(&ref));
 }
 
 #define SEARCH_AMOUNT 100
@@ -337,7 +314,6 @@ gt_search_channel_container_init(GtSearchChannelContainer* self)
 
     priv->query = NULL;
     priv->cancel = NULL;
-    priv->json_parser = json_parser_new();
 
     gt_item_container_set_items(GT_ITEM_CONTAINER(self), NULL);
 }
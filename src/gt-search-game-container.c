@@ -23,6 +23,7 @@
 #include "gt-http.h"
 #include "gt-win.h"
 #include "gt-game-container-view.h"
+#include "gt-json-decoders.h"
 #include "utils.h"
 #include <glib/gi18n.h>
 
@@ -38,7 +39,6 @@ typedef struct
 {
     gchar* query;
     GCancellable* cancel;
-    JsonParser* json_parser;
 } GtSearchGameContainerPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE(GtSearchGameContainer, gt_search_game_container, GT_TYPE_ITEM_CONTAINER);
@@ -72,7 +72,7 @@ static void
 process_json_cb(GObject* source,
     GAsyncResult* res, gpointer udata)
 {
-    RETURN_IF_FAIL(JSON_IS_PARSER(source));
+    RETURN_IF_FAIL(G_IS_MEMORY_OUTPUT_STREAM(source));
     RETURN_IF_FAIL(G_IS_ASYNC_RESULT(res));
     RETURN_IF_FAIL(udata != NULL);
 
@@ -85,12 +85,11 @@ process_json_cb(GObject* source,
         return;
     }
 
-    GtSearchGameContainerPrivate* priv = gt_search_game_container_get_instance_private(self);
-    g_autoptr(JsonReader) reader = NULL;
+    g_autoptr(GBytes) bytes = NULL;
     g_autoptr(GtGameList) items = NULL;
     g_autoptr(GError) err = NULL;
 
-    json_parser_load_from_stream_finish(priv->json_parser, res, &err);
+    g_output_stream_splice_finish(G_OUTPUT_STREAM(source), res, &err);
 
     if (g_error_matches(err, G_IO_ERROR, G_IO_ERROR_CANCELLED))
     {
@@ -104,45 +103,19 @@ process_json_cb(GObject* source,
         return;
     }
 
-    reader = json_reader_new(json_parser_get_root(priv->json_parser));
+    bytes = g_memory_output_stream_steal_as_bytes(G_MEMORY_OUTPUT_STREAM(source));
 
-    if (!json_reader_read_member(reader, "games"))
-    {
-        WARNING("Unable to process JSON because: %s",
-            json_reader_get_error(reader)->message);
-        gt_item_container_show_error(GT_ITEM_CONTAINER(self),
-            json_reader_get_error(reader));
-        return;
-    }
+    items = gt_json_decode_games_page(g_bytes_get_data(bytes, NULL), g_bytes_get_size(bytes), &err);
 
-    for (gint i = 0; i < json_reader_count_elements(reader); i++)
+    if (err)
     {
-        g_autoptr(GtGameData) data = NULL;
-
-        if (!json_reader_read_element(reader, i))
-        {
-            WARNING("Unable to process JSON because: %s",
-                json_reader_get_error(reader)->message);
-            gt_item_container_show_error(GT_ITEM_CONTAINER(self),
-                json_reader_get_error(reader));
-            return;
-        }
-
-        data = utils_parse_game_from_json(reader, &err);
-
-        if (err)
-        {
-            WARNING("Unable to process JSON because: %s", err->message);
-            gt_item_container_show_error(GT_ITEM_CONTAINER(self), err);
-            return;
-        }
-
-        items = g_list_append(items, gt_game_new(g_steal_pointer(&data)));
-
-        json_reader_end_element(reader);
+        WARNING("Unable to process JSON because: %s", err->message);
+        gt_item_container_show_error(GT_ITEM_CONTAINER(self), err);
+        return;
     }
 
-    json_reader_end_member(reader);
+    for (GList* l = items; l != NULL; l = l->next)
+        l->data = gt_game_new(l->data);
 
     gt_item_container_append_items(GT_ITEM_CONTAINER(self), g_steal_pointer(&items));
     gt_item_container_set_fetching_items(GT_ITEM_CONTAINER(self), FALSE);
@@ -162,6 +135,7 @@ handle_response_cb(GtHTTP* http,
     if (!self) {TRACE("Unreffed while waiting"); return;}
 
     GtSearchGameContainerPrivate* priv = gt_search_game_container_get_instance_private(self);
+    g_autoptr(GOutputStream) output = NULL;
 
     if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
     {
@@ -177,8 +151,11 @@ handle_response_cb(GtHTTP* http,
 
     RETURN_IF_FAIL(G_IS_INPUT_STREAM(res));
 
-    json_parser_load_from_stream_async(priv->json_parser, res, priv->cancel,
-        process_json_cb, g_steal_pointer(&ref));
+    output = g_memory_output_stream_new_resizable();
+
+    g_output_stream_splice_async(output, G_INPUT_STREAM(res),
+        G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE | G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+        G_PRIORITY_DEFAULT, priv->cancel, process_json_cb, g_steal_pointer(&ref));
 }
 
 static void
@@ -302,7 +279,6 @@ gt_search_game_container_init(GtSearchGameContainer* self)
 
     priv->query = NULL;
     priv->cancel = NULL;
-    priv->json_parser = json_parser_new();
 }
 
 GtSearchGameContainer*
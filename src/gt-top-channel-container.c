@@ -24,6 +24,7 @@
 #include "gt-channels-container-child.h"
 #include "gt-channel.h"
 #include "gt-http.h"
+#include "gt-json-decoders.h"
 #include "utils.h"
 
 #define TAG "GtTopChannelContainer"
@@ -35,7 +36,6 @@
 
 typedef struct
 {
-    JsonParser* json_parser;
     GCancellable* cancel;
 } GtTopChannelContainerPrivate;
 
@@ -64,12 +64,11 @@ process_json_cb(GObject* source,
     DEBUG("Processing json");
 
     g_autoptr(GtTopChannelContainer) self = udata;
-    GtTopChannelContainerPrivate* priv = gt_top_channel_container_get_instance_private(self);
-    g_autoptr(JsonReader) reader = NULL;
+    g_autoptr(GBytes) bytes = NULL;
     g_autoptr(GtChannelList) items = NULL;
     g_autoptr(GError) err = NULL;
 
-    json_parser_load_from_stream_finish(priv->json_parser, res, &err);
+    g_output_stream_splice_finish(G_OUTPUT_STREAM(source), res, &err);
 
     if (g_error_matches(err, G_IO_ERROR, G_IO_ERROR_CANCELLED))
     {
@@ -83,45 +82,19 @@ process_json_cb(GObject* source,
         return;
     }
 
-    reader = json_reader_new(json_parser_get_root(priv->json_parser));
+    bytes = g_memory_output_stream_steal_as_bytes(G_MEMORY_OUTPUT_STREAM(source));
 
-    if (!json_reader_read_member(reader, "streams"))
-    {
-        WARNING("Unable to process JSON because: %s",
-            json_reader_get_error(reader)->message);
-        gt_item_container_show_error(GT_ITEM_CONTAINER(self),
-            json_reader_get_error(reader));
-        return;
-    }
+    items = gt_json_decode_streams_page(g_bytes_get_data(bytes, NULL), g_bytes_get_size(bytes), &err);
 
-    for (gint i = 0; i < json_reader_count_elements(reader); i++)
+    if (err)
     {
-        g_autoptr(GtChannelData) data = NULL;
-
-        if (!json_reader_read_element(reader, i))
-        {
-            WARNING("Unable to process JSON because: %s",
-                json_reader_get_error(reader)->message);
-            gt_item_container_show_error(GT_ITEM_CONTAINER(self),
-                json_reader_get_error(reader));
-            return;
-        }
-
-        data = utils_parse_stream_from_json(reader, &err);
-
-        if (err)
-        {
-            WARNING("Unable to process JSON because: %s", err->message);
-            gt_item_container_show_error(GT_ITEM_CONTAINER(self), err);
-            return;
-        }
-
-        items = g_list_append(items, gt_channel_new(g_steal_pointer(&data)));
-
-        json_reader_end_element(reader);
+        WARNING("Unable to process JSON because: %s", err->message);
+        gt_item_container_show_error(GT_ITEM_CONTAINER(self), err);
+        return;
     }
 
-    json_reader_end_member(reader);
+    for (GList* l = items; l != NULL; l = l->next)
+        l->data = gt_channel_new(l->data);
 
     gt_item_container_append_items(GT_ITEM_CONTAINER(self), g_steal_pointer(&items));
     gt_item_container_set_fetching_items(GT_ITEM_CONTAINER(self), FALSE);
@@ -140,6 +113,7 @@ handle_response_cb(GtHTTP* http, gpointer ret,
     if (!self) {TRACE("Unreffed while waiting"); return;}
 
     GtTopChannelContainerPrivate* priv = gt_top_channel_container_get_instance_private(self);
+    g_autoptr(GOutputStream) output = NULL;
 
     if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
     {
@@ -155,8 +129,11 @@ handle_response_cb(GtHTTP* http, gpointer ret,
 
     RETURN_IF_FAIL(G_IS_INPUT_STREAM(ret));
 
-    json_parser_load_from_stream_async(priv->json_parser, G_INPUT_STREAM(ret), priv->cancel,
-        process_json_cb, g_object_ref(self));
+    output = g_memory_output_stream_new_resizable();
+
+    g_output_stream_splice_async(output, G_INPUT_STREAM(ret),
+        G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE | G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+        G_PRIORITY_DEFAULT, priv->cancel, process_json_cb, g_object_ref(self));
 }
 
 static void
@@ -211,9 +188,6 @@ gt_top_channel_container_class_init(GtTopChannelContainerClass* klass)
 static void
 gt_top_channel_container_init(GtTopChannelContainer* self)
 {
-    GtTopChannelContainerPrivate* priv = gt_top_channel_container_get_instance_private(self);
-
-    priv->json_parser = json_parser_new();
 }
 
 GtTopChannelContainer*
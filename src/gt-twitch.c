@@ -18,6 +18,7 @@
 
 #include "gt-twitch.h"
 #include "gt-resource-downloader.h"
+#include "gt-image-cache.h"
 #include "config.h"
 #include <libsoup/soup.h>
 #include <glib/gprintf.h>
@@ -60,6 +61,10 @@
 
 #define STREAM_INFO "#EXT-X-STREAM-INF"
 
+#define MAX_IMAGE_FETCHES 4
+#define DEFAULT_IMAGE_CACHE_SIZE 32 // In MiB
+#define IMAGE_STATS_INTERVAL 100 // In fetched images
+
 #define TWITCH_API_VERSION_3 "3"
 #define TWITCH_API_VERSION_4 "4"
 #define TWITCH_API_VERSION_5 "5"
@@ -186,14 +191,90 @@ typedef struct
 
     GThreadPool* image_download_pool;
 
-    GHashTable* emote_table;
+    /* NOTE: Emote and badge images are cached under the path they're
+     * saved at in the cache dir, like 'emotes/25@2x' */
+    GtImageCache* image_cache;
+    gint image_cache_size;
+    guint64 images_fetched;
+
+    /* NOTE: Badges keyed by '<set>-<name>-<version>' and the names of
+     * the sets that have been loaded, a set is only added once all of
+     * its badges are. Badges seen before their sets were loaded get a
+     * placeholder without uris that's filled in once they are */
     GHashTable* badge_table;
+    GPtrArray* badge_placeholders;
+    GHashTable* queued_badge_sets;
+    GMutex badge_set_mutex; // Held while loading sets
+    GHashTable* pending_emotes; // Keyed by emote_key
+
+    /* NOTE: Emote metadata keyed by emote set, the images are
+     * resolved separately */
+    GHashTable* emote_set_table;
+
+    GMutex image_mutex;
+    GMutex emote_set_mutex;
 } GtTwitchPrivate;
 
+typedef struct
+{
+    GtTwitch* self;
+    gint id;
+    GtChatBadge* badge;
+    gchar* badge_set; // Channel id whose badge sets are loaded instead of fetching an image
+    gint scale;
+    gchar* uri;
+    gchar* name;
+    gchar* key;
+    gchar* filename; // Where the image is on disk, NULL if it isn't
+    GdkPixbuf* pixbuf;
+} ImageFetchData;
+
+typedef gpointer (*ParseJsonFunc) (GtTwitch* self, JsonReader* reader, gpointer data, GError** error);
+
+typedef struct
+{
+    ParseJsonFunc parse;
+    gpointer data;
+    GDestroyNotify data_free;
+    GDestroyNotify ret_free;
+    GBytes* response;
+} JsonRequestData;
+
+static gchar* TWITCH_API_HEADERS[] =
+{
+    "Client-ID", CLIENT_ID,
+    "Accept", "application/vnd.twitchtv.v" TWITCH_API_VERSION_5 "+json",
+    NULL,
+};
+
+/* NOTE: Twitch serves emotes and badges at 1, 2 and 4 times their
+ * size, a scale of 3 is made from the largest once it's downloaded */
+static const gint source_scales[GT_CHAT_IMAGE_MAX_SCALE] = {1, 2, 4};
+
 G_DEFINE_TYPE_WITH_PRIVATE(GtTwitch, gt_twitch,  G_TYPE_OBJECT)
 
-static GtResourceDownloader* emote_downloader;
-static GtResourceDownloader* badge_downloader;
+enum
+{
+    SIG_EMOTE_RESOLVED,
+    SIG_BADGE_RESOLVED,
+    NUM_SIGS
+};
+
+static guint sigs[NUM_SIGS];
+
+enum
+{
+    PROP_0,
+    PROP_IMAGE_CACHE_SIZE,
+    NUM_PROPS
+};
+
+static GParamSpec* props[NUM_PROPS];
+
+/* NOTE: Each image fetch thread gets its own downloaders so that the
+ * requests don't serialise on a shared soup session */
+static GPrivate emote_fetch_downloader = G_PRIVATE_INIT(g_object_unref);
+static GPrivate badge_fetch_downloader = G_PRIVATE_INIT(g_object_unref);
 
 static GtTwitchStreamAccessToken*
 gt_twitch_stream_access_token_new()
@@ -224,9 +305,9 @@ void
 gt_chat_emote_free(GtChatEmote* emote)
 {
     g_assert_nonnull(emote);
-    g_assert(GDK_IS_PIXBUF(emote->pixbuf));
 
-    g_object_unref(emote->pixbuf);
+    /* NOTE: Emotes from GtIrc might still be unresolved */
+    g_clear_object(&emote->pixbuf);
     g_free(emote->code);
     g_free(emote);
 }
@@ -237,6 +318,19 @@ gt_chat_emote_list_free(GList* list)
     g_list_free_full(list, (GDestroyNotify) gt_chat_emote_free);
 }
 
+static GtChatEmote*
+chat_emote_copy(const GtChatEmote* emote)
+{
+    GtChatEmote* ret = gt_chat_emote_new();
+
+    ret->id = emote->id;
+    ret->code = g_strdup(emote->code);
+    ret->set = emote->set;
+    ret->pixbuf = emote->pixbuf ? g_object_ref(emote->pixbuf) : NULL;
+
+    return ret;
+}
+
 GQuark
 gt_spawn_twitch_error_quark()
 {
@@ -251,33 +345,88 @@ gt_twitch_new(void)
 }
 
 static void
-gt_twitch_class_init(GtTwitchClass* klass)
+get_property(GObject* obj,
+             guint prop,
+             GValue* val,
+             GParamSpec* pspec)
 {
+    GtTwitch* self = GT_TWITCH(obj);
+    GtTwitchPrivate* priv = gt_twitch_get_instance_private(self);
+
+    switch (prop)
+    {
+        case PROP_IMAGE_CACHE_SIZE:
+            g_value_set_int(val, priv->image_cache_size);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop, pspec);
+    }
 }
 
 static void
-gt_twitch_init(GtTwitch* self)
+set_property(GObject* obj,
+             guint prop,
+             const GValue* val,
+             GParamSpec* pspec)
 {
+    GtTwitch* self = GT_TWITCH(obj);
     GtTwitchPrivate* priv = gt_twitch_get_instance_private(self);
 
-    priv->soup = soup_session_new();
-    priv->emote_table = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) g_object_unref);
-    priv->badge_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify) gt_chat_badge_free);
+    switch (prop)
+    {
+        case PROP_IMAGE_CACHE_SIZE:
+            priv->image_cache_size = g_value_get_int(val);
+            gt_image_cache_set_budget(priv->image_cache, (gsize) priv->image_cache_size*1024*1024);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop, pspec);
+    }
+}
+
+static void
+gt_twitch_class_init(GtTwitchClass* klass)
+{
+    GObjectClass* obj_class = G_OBJECT_CLASS(klass);
+
+    obj_class->get_property = get_property;
+    obj_class->set_property = set_property;
 
-    g_autofree gchar* emotes_filepath = g_build_filename(g_get_user_cache_dir(),
-        "gnome-twitch", "emotes", NULL);
+    sigs[SIG_EMOTE_RESOLVED] = g_signal_new("emote-resolved",
+        GT_TYPE_TWITCH, G_SIGNAL_RUN_LAST, 0,
+        NULL, NULL, NULL, G_TYPE_NONE, 3, G_TYPE_INT, GDK_TYPE_PIXBUF, G_TYPE_INT);
+
+    sigs[SIG_BADGE_RESOLVED] = g_signal_new("badge-resolved",
+        GT_TYPE_TWITCH, G_SIGNAL_RUN_LAST, 0,
+        NULL, NULL, NULL, G_TYPE_NONE, 1, G_TYPE_POINTER);
+
+    props[PROP_IMAGE_CACHE_SIZE] = g_param_spec_int("image-cache-size", "Image cache size",
+        "Memory in MiB decoded emote and badge images may take up",
+        1, 1024, DEFAULT_IMAGE_CACHE_SIZE, G_PARAM_READWRITE);
+
+    g_object_class_install_properties(obj_class, NUM_PROPS, props);
+}
 
-    g_autofree gchar* badges_filepath = g_build_filename(g_get_user_cache_dir(),
-        "gnome-twitch", "badges", NULL);
+static void fetch_image_cb(ImageFetchData* data, gpointer udata);
 
-    emote_downloader = gt_resource_downloader_new_with_cache(emotes_filepath);
-    gt_resource_downloader_set_image_filetype(emote_downloader, GT_IMAGE_FILETYPE_PNG);
+static void
+gt_twitch_init(GtTwitch* self)
+{
+    GtTwitchPrivate* priv = gt_twitch_get_instance_private(self);
 
-    badge_downloader = gt_resource_downloader_new_with_cache(badges_filepath);
-    gt_resource_downloader_set_image_filetype(badge_downloader, GT_IMAGE_FILETYPE_PNG);
+    priv->soup = soup_session_new();
+    priv->image_cache_size = DEFAULT_IMAGE_CACHE_SIZE;
+    priv->image_cache = gt_image_cache_new((gsize) priv->image_cache_size*1024*1024);
+    priv->badge_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify) gt_chat_badge_free);
+    priv->badge_placeholders = g_ptr_array_new();
+    priv->queued_badge_sets = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    priv->pending_emotes = g_hash_table_new_full(g_int64_hash, g_int64_equal, g_free, NULL);
+    priv->emote_set_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
+    priv->image_download_pool = g_thread_pool_new((GFunc) fetch_image_cb, self,
+        MAX_IMAGE_FETCHES, FALSE, NULL);
 
-    g_signal_connect_swapped(main_app, "shutdown", G_CALLBACK(g_object_unref), emote_downloader);
-    g_signal_connect_swapped(main_app, "shutdown", G_CALLBACK(g_object_unref), badge_downloader);
+    g_mutex_init(&priv->image_mutex);
+    g_mutex_init(&priv->emote_set_mutex);
+    g_mutex_init(&priv->badge_set_mutex);
 }
 
 static gboolean
@@ -395,6 +544,151 @@ new_send_message_json(GtTwitch* self, SoupMessage* msg, GError** error)
     return new_send_message_json_with_version(self, msg, TWITCH_API_VERSION_5, error);
 }
 
+static void
+json_request_data_free(JsonRequestData* req)
+{
+    if (req->data_free)
+        req->data_free(req->data);
+
+    if (req->response)
+        g_bytes_unref(req->response);
+
+    g_slice_free(JsonRequestData, req);
+}
+
+static void
+parse_json_response_cb(GTask* task, gpointer source,
+    gpointer task_data, GCancellable* cancel)
+{
+    g_assert(GT_IS_TWITCH(source));
+    g_assert(G_IS_TASK(task));
+    g_assert_nonnull(task_data);
+
+    JsonRequestData* req = task_data;
+    g_autoptr(JsonParser) parser = NULL;
+    g_autoptr(JsonReader) reader = NULL;
+    gconstpointer body = NULL;
+    gsize length = 0;
+    gpointer ret = NULL;
+    GError* err = NULL;
+
+    if (g_task_return_error_if_cancelled(task))
+        return;
+
+    body = g_bytes_get_data(req->response, &length);
+
+    parser = json_parser_new();
+
+    json_parser_load_from_data(parser, body, length, &err);
+
+    if (err)
+    {
+        WARNINGF("Error parsing JSON response because: %s", err->message);
+
+        g_task_return_new_error(task, GT_TWITCH_ERROR, GT_TWITCH_ERROR_JSON,
+            "Error parsing JSON response because: %s", err->message);
+
+        g_error_free(err);
+
+        return;
+    }
+
+    reader = json_reader_new(json_parser_get_root(parser));
+
+    ret = req->parse(GT_TWITCH(source), reader, req->data, &err);
+
+    if (err)
+        g_task_return_error(task, err);
+    else
+        g_task_return_pointer(task, ret, req->ret_free);
+}
+
+static void
+read_json_response_cb(GObject* source,
+    GAsyncResult* res, gpointer udata)
+{
+    g_autoptr(GTask) task = udata;
+    JsonRequestData* req = g_task_get_task_data(task);
+    GError* err = NULL;
+
+    g_output_stream_splice_finish(G_OUTPUT_STREAM(source), res, &err);
+
+    if (err)
+    {
+        g_task_return_error(task, err);
+        return;
+    }
+
+    req->response = g_memory_output_stream_steal_as_bytes(G_MEMORY_OUTPUT_STREAM(source));
+
+    g_task_run_in_thread(task, parse_json_response_cb);
+}
+
+static void
+json_response_cb(GtHTTP* http,
+    GInputStream* stream, GError* error, gpointer udata)
+{
+    g_autoptr(GTask) task = udata;
+    g_autoptr(GOutputStream) output = NULL;
+
+    if (error)
+    {
+        if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+            g_task_return_error(task, error);
+        else
+        {
+            g_task_return_new_error(task, GT_TWITCH_ERROR,
+                g_error_matches(error, GT_HTTP_ERROR, GT_HTTP_ERROR_NOT_FOUND) ?
+                GT_TWITCH_ERROR_SOUP_NOT_FOUND : GT_TWITCH_ERROR_SOUP_GENERIC,
+                "%s", error->message);
+
+            g_error_free(error);
+        }
+
+        return;
+    }
+
+    output = g_memory_output_stream_new_resizable();
+
+    g_output_stream_splice_async(output, stream,
+        G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE | G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+        G_PRIORITY_DEFAULT, g_task_get_cancellable(task),
+        read_json_response_cb, g_steal_pointer(&task));
+}
+
+/* NOTE: Sends the request through the app's GtHTTP so no thread is
+ * held while it's in flight, only parse runs in a thread once the
+ * response has been read. Whatever parse returns is returned through
+ * the task, which is made with cb and udata */
+static void
+get_json_async(GtTwitch* self, const gchar* uri, ParseJsonFunc parse,
+    gpointer data, GDestroyNotify data_free, GDestroyNotify ret_free,
+    GCancellable* cancel, GAsyncReadyCallback cb, gpointer udata)
+{
+    g_assert(GT_IS_TWITCH(self));
+    g_assert_false(utils_str_empty(uri));
+    g_assert_nonnull(parse);
+
+    g_autoptr(GCancellable) req_cancel = cancel ? g_object_ref(cancel) : g_cancellable_new();
+    JsonRequestData* req = g_slice_new0(JsonRequestData);
+    GTask* task = NULL;
+
+    req->parse = parse;
+    req->data = data;
+    req->data_free = data_free;
+    req->ret_free = ret_free;
+
+    task = g_task_new(self, req_cancel, cb, udata);
+    g_task_set_return_on_cancel(task, FALSE);
+    g_task_set_task_data(task, req, (GDestroyNotify) json_request_data_free);
+
+    DEBUGF("Sending message to uri '%s'", uri);
+
+    /* NOTE: The task is unreffed by json_response_cb */
+    gt_http_get_with_category(main_app->http, uri, "gt-twitch", TWITCH_API_HEADERS,
+        req_cancel, G_CALLBACK(json_response_cb), task, GT_HTTP_FLAG_RETURN_STREAM);
+}
+
 static GDateTime*
 parse_time(const gchar* time)
 {
@@ -721,47 +1015,28 @@ gt_twitch_stream_list_filter_quality(GList* list,
     return ret;
 }
 
-GList*
-gt_twitch_top_channels(GtTwitch* self, gint n, gint offset,
-    const gchar* game, const gchar* language, GError** error)
+static GList*
+parse_top_channels(GtTwitch* self, JsonReader* reader,
+    GenericTaskData* data, GError** error)
 {
-    g_assert(GT_IS_TWITCH(self));
-    g_assert_cmpint(n, >=, 0);
-    g_assert_cmpint(n, <=, 100);
-    g_assert_cmpint(offset, >=, 0);
-    g_assert_nonnull(game);
-    g_assert_nonnull(language);
-
-    g_autoptr(SoupMessage) msg = NULL;
-    g_autoptr(JsonReader) reader = NULL;
-    g_autofree gchar* uri = NULL;
     GList* ret = NULL;
     GError* err = NULL;
 
-    uri = g_strdup_printf(TOP_CHANNELS_URI, n, offset, game, language);
-
-    msg = soup_message_new("GET", uri);
-
-    reader = new_send_message_json(self, msg, &err);
-
-    CHECK_AND_PROPAGATE_ERROR("Unable to fetch top channels with amount '%d', offset '%d' and game '%s'",
-        n, offset, game);
-
     READ_JSON_MEMBER("streams");
 
     for (gint i = 0; i < json_reader_count_elements(reader); i++)
     {
         GtChannel* channel = NULL;
-        GtChannelData* data = NULL;
+        GtChannelData* chan_data = NULL;
 
         READ_JSON_ELEMENT(i);
 
-        data = parse_stream(reader, &err);
+        chan_data = parse_stream(reader, &err);
 
         CHECK_AND_PROPAGATE_ERROR("Unable to fetch top channels with amount '%d', offset '%d' and game '%s'",
-            n, offset, game);
+            (gint) data->int_1, (gint) data->int_2, data->str_1);
 
-        channel = gt_channel_new(data);
+        channel = gt_channel_new(chan_data);
 
         END_JSON_ELEMENT();
 
@@ -777,31 +1052,6 @@ error:
 
     return NULL;
 }
-static void
-top_channels_async_cb(GTask* task,
-                      gpointer source,
-                      gpointer task_data,
-                      GCancellable* cancel)
-{
-    g_assert(GT_IS_TWITCH(source));
-    g_assert(G_IS_TASK(task));
-    g_assert_nonnull(task_data);
-
-    GenericTaskData* data = task_data;
-    GList* ret = NULL;
-    GError* err = NULL;
-
-    if (g_task_return_error_if_cancelled(task))
-        return;
-
-    ret = gt_twitch_top_channels(GT_TWITCH(source), data->int_1, data->int_2,
-        data->str_1, data->str_2, &err);
-
-    if (err)
-        g_task_return_error(task, err);
-    else
-        g_task_return_pointer(task, ret, (GDestroyNotify) gt_channel_list_free);
-}
 
 void
 gt_twitch_top_channels_async(GtTwitch* self, gint n, gint offset, const gchar* game,
@@ -814,23 +1064,20 @@ gt_twitch_top_channels_async(GtTwitch* self, gint n, gint offset, const gchar* g
     g_assert_nonnull(game);
     g_assert_nonnull(language);
 
-    GTask* task = NULL;
+    g_autofree gchar* uri = NULL;
     GenericTaskData* data = NULL;
 
-    task = g_task_new(self, cancel, cb, udata);
-    g_task_set_return_on_cancel(task, FALSE);
-
     data = generic_task_data_new();
     data->int_1 = n;
     data->int_2 = offset;
     data->str_1 = g_strdup(game);
     data->str_2 = g_strdup(language);
 
-    g_task_set_task_data(task, data, (GDestroyNotify) generic_task_data_free);
-
-    g_task_run_in_thread(task, top_channels_async_cb);
+    uri = g_strdup_printf(TOP_CHANNELS_URI, n, offset, game, language);
 
-    g_object_unref(task);
+    get_json_async(self, uri, (ParseJsonFunc) parse_top_channels,
+        data, (GDestroyNotify) generic_task_data_free, (GDestroyNotify) gt_channel_list_free,
+        cancel, cb, udata);
 }
 
 GList*
@@ -845,52 +1092,35 @@ gt_twitch_top_channels_finish(GtTwitch* self,
     return ret;
 }
 
-GList*
-gt_twitch_top_games(GtTwitch* self,
-    gint n, gint offset, GError** error)
+static GList*
+parse_top_games(GtTwitch* self, JsonReader* reader,
+    GenericTaskData* data, GError** error)
 {
-    g_assert(GT_IS_TWITCH(self));
-    g_assert_cmpint(n, >=, 0);
-    g_assert_cmpint(n, <=, 100);
-    g_assert_cmpint(offset, >=, 0);
-
-    g_autoptr(SoupMessage) msg = NULL;
-    g_autoptr(JsonReader) reader = NULL;
-    g_autofree gchar* uri = NULL;
     GList* ret = NULL;
     GError* err = NULL;
 
-    uri = g_strdup_printf(TOP_GAMES_URI, n, offset);
-
-    msg = soup_message_new("GET", uri);
-
-    reader = new_send_message_json(self, msg, &err);
-
-    CHECK_AND_PROPAGATE_ERROR("Unable to get top games with amount '%d' and offset '%d'",
-        n, offset);
-
     READ_JSON_MEMBER("top");
 
     for (gint i = 0; i < json_reader_count_elements(reader); i++)
     {
         GtGame* game = NULL;
-        GtGameData* data = NULL;
+        GtGameData* game_data = NULL;
 
         READ_JSON_ELEMENT(i);
 
         READ_JSON_MEMBER("game");
 
-        data = parse_game(reader, &err);
+        game_data = parse_game(reader, &err);
 
         CHECK_AND_PROPAGATE_ERROR("Unable to get top games with amount '%d' and offset '%d'",
-            n, offset);
+            (gint) data->int_1, (gint) data->int_2);
 
         END_JSON_MEMBER();
 
-        READ_JSON_VALUE("viewers", data->viewers);
-        READ_JSON_VALUE("channels", data->channels);
+        READ_JSON_VALUE("viewers", game_data->viewers);
+        READ_JSON_VALUE("channels", game_data->channels);
 
-        game = gt_game_new(data);
+        game = gt_game_new(game_data);
 
         END_JSON_ELEMENT();
 
@@ -907,32 +1137,6 @@ error:
     return NULL;
 }
 
-
-static void
-top_games_async_cb(GTask* task,
-                   gpointer source,
-                   gpointer task_data,
-                   GCancellable* cancel)
-{
-    g_assert(GT_IS_TWITCH(source));
-    g_assert(G_IS_TASK(task));
-    g_assert_nonnull(task_data);
-
-    GenericTaskData* data = task_data;
-    GList* ret = NULL;
-    GError* err = NULL;
-
-    if (g_task_return_error_if_cancelled(task))
-        return;
-
-    ret = gt_twitch_top_games(GT_TWITCH(source), data->int_1, data->int_2, &err);
-
-    if (err)
-        g_task_return_error(task, err);
-    else
-        g_task_return_pointer(task, ret, (GDestroyNotify) gt_game_list_free);
-}
-
 void
 gt_twitch_top_games_async(GtTwitch* self, gint n, gint offset,
                              GCancellable* cancel,
@@ -944,21 +1148,18 @@ gt_twitch_top_games_async(GtTwitch* self, gint n, gint offset,
     g_assert_cmpint(n, <=, 100);
     g_assert_cmpint(offset, >=, 0);
 
-    GTask* task = NULL;
+    g_autofree gchar* uri = NULL;
     GenericTaskData* data = NULL;
 
-    task = g_task_new(self, cancel, cb, udata);
-    g_task_set_return_on_cancel(task, FALSE);
-
     data = generic_task_data_new();
     data->int_1 = n;
     data->int_2 = offset;
 
-    g_task_set_task_data(task, data, (GDestroyNotify) generic_task_data_free);
-
-    g_task_run_in_thread(task, top_games_async_cb);
+    uri = g_strdup_printf(TOP_GAMES_URI, n, offset);
 
-    g_object_unref(task);
+    get_json_async(self, uri, (ParseJsonFunc) parse_top_games,
+        data, (GDestroyNotify) generic_task_data_free, (GDestroyNotify) gt_game_list_free,
+        cancel, cb, udata);
 }
 
 GList*
@@ -973,42 +1174,24 @@ gt_twitch_top_games_finish(GtTwitch* self,
     return ret;
 }
 
-//NOTE: Twitch's stream search API is retarted (see https://github.com/justintv/Twitch-API/issues/513)
-//so we need to do this hack to get anything remotely usable. It will return duplicates unless
-//amount=offset*k where k is some multiple, i.e. it works in 'pages'
-GList*
-gt_twitch_search_channels(GtTwitch* self, const gchar* query, gint n, gint offset, gboolean offline, GError** error)
-{
-    g_assert(GT_IS_TWITCH(self));
-    g_assert_cmpint(n, >=, 0);
-    g_assert_cmpint(n, <=, 100);
-    g_assert_cmpint(offset, >=, 0);
-    g_assert_false(utils_str_empty(query));
-
 #define SEARCH_AMOUNT 100
 
-    const gint PAGE_AMOUNT = offline ? 100 : 90;
+#define SEARCH_PAGE_AMOUNT(offline) ((offline) ? 100 : 90)
 
-    MESSAGEF("Searching for channels with query '%s', amount '%d' ('%d') and offset '%d' ('%d')",
-        query, 100, SEARCH_AMOUNT, (offset / PAGE_AMOUNT) * 100, offset);
+static GList*
+parse_search_channels(GtTwitch* self, JsonReader* reader,
+    GenericTaskData* data, GError** error)
+{
+    const gchar* query = data->str_1;
+    const gint n = data->int_1;
+    const gint offset = data->int_2;
+    const gboolean offline = data->bool_1;
+    const gint PAGE_AMOUNT = SEARCH_PAGE_AMOUNT(offline);
 
-    g_autoptr(SoupMessage) msg = NULL;
-    g_autoptr(JsonReader) reader = NULL;
-    g_autofree gchar* uri = NULL;
     gint total;
     GList* ret = NULL;
     GError* err = NULL;
 
-    uri = g_strdup_printf(offline ? SEARCH_CHANNELS_URI : SEARCH_STREAMS_URI,
-        query, SEARCH_AMOUNT, (offset / PAGE_AMOUNT) * SEARCH_AMOUNT);
-
-    msg = soup_message_new("GET", uri);
-
-    reader = new_send_message_json(self, msg, &err);
-
-    CHECK_AND_PROPAGATE_ERROR("Unable to search channels with query '%s', amount '%d' ('%d') and offset '%d' ('%d')",
-        query, PAGE_AMOUNT, SEARCH_AMOUNT, (offset / PAGE_AMOUNT) * PAGE_AMOUNT, offset);
-
     READ_JSON_MEMBER(offline ? "channels" : "streams");
 
     total = MIN(n + offset % PAGE_AMOUNT, json_reader_count_elements(reader));
@@ -1016,16 +1199,16 @@ gt_twitch_search_channels(GtTwitch* self, const gchar* query, gint n, gint offse
     for (gint i = offset % PAGE_AMOUNT; i < total; i++)
     {
         GtChannel* channel = NULL;
-        GtChannelData* data = NULL;
+        GtChannelData* chan_data = NULL;
 
         READ_JSON_ELEMENT(i);
 
-        data = offline ? parse_channel(reader, &err) : parse_stream(reader, &err);
+        chan_data = offline ? parse_channel(reader, &err) : parse_stream(reader, &err);
 
         CHECK_AND_PROPAGATE_ERROR("Unable to search channels with query '%s', amount '%d' ('%d') and offset '%d' ('%d')",
             query, PAGE_AMOUNT, SEARCH_AMOUNT, (offset / PAGE_AMOUNT) * PAGE_AMOUNT, offset);
 
-        channel = gt_channel_new(data);
+        channel = gt_channel_new(chan_data);
 
         END_JSON_ELEMENT();
 
@@ -1042,29 +1225,9 @@ error:
     return NULL;
 }
 
-static void
-search_channels_async_cb(GTask* task, gpointer source,
-    gpointer task_data, GCancellable* cancel)
-{
-    g_assert(GT_IS_TWITCH(source));
-    g_assert(G_IS_TASK(task));
-    g_assert_nonnull(task_data);
-
-    GenericTaskData* data = task_data;
-
-    if (g_task_return_error_if_cancelled(task))
-        return;
-
-    GError* err = NULL;
-    GList* ret = gt_twitch_search_channels(GT_TWITCH(source), data->str_1,
-        data->int_1, data->int_2, data->bool_1, &err);
-
-    if (err)
-        g_task_return_error(task, err);
-    else
-        g_task_return_pointer(task, ret, (GDestroyNotify) gt_channel_list_free);
-}
-
+//NOTE: Twitch's stream search API is retarted (see https://github.com/justintv/Twitch-API/issues/513)
+//so we need to do this hack to get anything remotely usable. It will return duplicates unless
+//amount=offset*k where k is some multiple, i.e. it works in 'pages'
 void
 gt_twitch_search_channels_async(GtTwitch* self,
     const gchar* query, gint n, gint offset, gboolean offline,
@@ -1076,11 +1239,13 @@ gt_twitch_search_channels_async(GtTwitch* self,
     g_assert_cmpint(offset, >=, 0);
     g_assert_false(utils_str_empty(query));
 
-    GTask* task = NULL;
+    const gint PAGE_AMOUNT = SEARCH_PAGE_AMOUNT(offline);
+
+    g_autofree gchar* uri = NULL;
     GenericTaskData* data = NULL;
 
-    task = g_task_new(self, cancel, cb, udata);
-    g_task_set_return_on_cancel(task, FALSE);
+    MESSAGEF("Searching for channels with query '%s', amount '%d' ('%d') and offset '%d' ('%d')",
+        query, 100, SEARCH_AMOUNT, (offset / PAGE_AMOUNT) * 100, offset);
 
     data = generic_task_data_new();
     data->int_1 = n;
@@ -1088,11 +1253,12 @@ gt_twitch_search_channels_async(GtTwitch* self,
     data->str_1 = g_strdup(query);
     data->bool_1 = offline;
 
-    g_task_set_task_data(task, data, (GDestroyNotify) generic_task_data_free);
-
-    g_task_run_in_thread(task, search_channels_async_cb);
+    uri = g_strdup_printf(offline ? SEARCH_CHANNELS_URI : SEARCH_STREAMS_URI,
+        query, SEARCH_AMOUNT, (offset / PAGE_AMOUNT) * SEARCH_AMOUNT);
 
-    g_object_unref(task);
+    get_json_async(self, uri, (ParseJsonFunc) parse_search_channels,
+        data, (GDestroyNotify) generic_task_data_free, (GDestroyNotify) gt_channel_list_free,
+        cancel, cb, udata);
 }
 
 GList*
@@ -1108,47 +1274,28 @@ gt_twitch_search_channels_finish(GtTwitch* self,
     return ret;
 }
 
-GList*
-gt_twitch_search_games(GtTwitch* self,
-    const gchar* query, gint n, gint offset,
-    GError** error)
+static GList*
+parse_search_games(GtTwitch* self, JsonReader* reader,
+    GenericTaskData* data, GError** error)
 {
-    g_assert(GT_IS_TWITCH(self));
-    g_assert_cmpint(n, >=, 0);
-    g_assert_cmpint(n, <=, 100);
-    g_assert_cmpint(offset, >=, 0);
-    g_assert_false(utils_str_empty(query));
-
-    g_autoptr(SoupMessage) msg = NULL;
-    g_autoptr(JsonReader) reader = NULL;
-    g_autofree gchar* uri = NULL;
     GList* ret = NULL;
     GError* err = NULL;
 
-    uri = g_strdup_printf(SEARCH_GAMES_URI, query);
-
-    msg = soup_message_new("GET", uri);
-
-    reader = new_send_message_json(self, msg, &err);
-
-    CHECK_AND_PROPAGATE_ERROR("Unable to search games with query '%s', amount '%d' and offset '%d'",
-        query, n, offset);
-
     READ_JSON_MEMBER("games");
 
     for (gint i = 0; i < json_reader_count_elements(reader); i++)
     {
         GtGame* game;
-        GtGameData* data = NULL;
+        GtGameData* game_data = NULL;
 
         READ_JSON_ELEMENT(i);
 
-        data = parse_game(reader, &err);
+        game_data = parse_game(reader, &err);
 
         CHECK_AND_PROPAGATE_ERROR("Unable to search games with query '%s', amount '%d' and offset '%d'",
-            query, n, offset);
+            data->str_1, (gint) data->int_1, (gint) data->int_2);
 
-        game = gt_game_new(data);
+        game = gt_game_new(game_data);
 
         END_JSON_ELEMENT();
 
@@ -1165,29 +1312,6 @@ error:
     return NULL;
 }
 
-
-static void
-search_games_async_cb(GTask* task, gpointer source,
-    gpointer task_data, GCancellable* cancel)
-{
-    g_assert(GT_IS_TWITCH(source));
-    g_assert(G_IS_TASK(task));
-    g_assert_nonnull(task_data);
-
-    GenericTaskData* data = task_data;
-
-    if (g_task_return_error_if_cancelled(task))
-        return;
-
-    GError* err = NULL;
-    GList* ret = gt_twitch_search_games(GT_TWITCH(source), data->str_1, data->int_1, data->int_2, &err);
-
-    if (err)
-        g_task_return_error(task, err);
-    else
-        g_task_return_pointer(task, ret, (GDestroyNotify) gt_game_list_free);
-}
-
 void
 gt_twitch_search_games_async(GtTwitch* self,
     const gchar* query, gint n, gint offset,
@@ -1200,22 +1324,19 @@ gt_twitch_search_games_async(GtTwitch* self,
     g_assert_cmpint(offset, >=, 0);
     g_assert_false(utils_str_empty(query));
 
-    GTask* task = NULL;
+    g_autofree gchar* uri = NULL;
     GenericTaskData* data = NULL;
 
-    task = g_task_new(self, cancel, cb, udata);
-    g_task_set_return_on_cancel(task, FALSE);
-
     data = generic_task_data_new();
     data->int_1 = n;
     data->int_2 = offset;
     data->str_1 = g_strdup(query);
 
-    g_task_set_task_data(task, data, (GDestroyNotify) generic_task_data_free);
-
-    g_task_run_in_thread(task, search_games_async_cb);
+    uri = g_strdup_printf(SEARCH_GAMES_URI, query);
 
-    g_object_unref(task);
+    get_json_async(self, uri, (ParseJsonFunc) parse_search_games,
+        data, (GDestroyNotify) generic_task_data_free, (GDestroyNotify) gt_game_list_free,
+        cancel, cb, udata);
 }
 
 GList*
@@ -1244,113 +1365,107 @@ gt_twitch_stream_data_list_free(GList* list)
     g_list_free_full(list, (GDestroyNotify) gt_twitch_stream_data_free);
 }
 
-GtChannelData*
-gt_twitch_fetch_channel_data(GtTwitch* self, const gchar* id, GError** error)
+/* NOTE: Returns NULL without an error if the channel is offline */
+static GtChannelData*
+parse_fetch_stream(GtTwitch* self, JsonReader* reader,
+    GenericTaskData* data, GError** error)
 {
-    g_assert(GT_IS_TWITCH(self));
-    g_assert_false(utils_str_empty(id));
-
-    g_autoptr(SoupMessage) msg = NULL;
-    g_autoptr(JsonReader) reader = NULL;
-    g_autofree gchar* uri = NULL;
-    GError* err = NULL;
     GtChannelData* ret = NULL;
-
-    uri = g_strdup_printf(FETCH_STREAM_URI, id);
-
-    msg = soup_message_new("GET", uri);
-
-    reader = new_send_message_json(self, msg, &err);
-
-    CHECK_AND_PROPAGATE_ERROR("Unable to fetch channel data with id '%s'",
-        id);
-
-    ret = gt_channel_data_new();
+    GError* err = NULL;
 
     READ_JSON_MEMBER("stream");
 
-    if (json_reader_get_null_value(reader))
-    {
-        //NOTE: Free these here as they will be used again
-        g_object_unref(msg);
-        g_object_unref(reader);
-        g_free(uri);
-
-        uri = g_strdup_printf(FETCH_CHANNEL_URI, id);
-
-        msg = soup_message_new("GET", uri);
-
-        reader = new_send_message_json(self, msg, &err);
-
-        CHECK_AND_PROPAGATE_ERROR("Unable to fetch channel data with id '%s'",
-            id);
-
-        ret = parse_channel(reader, &err);
-
-        CHECK_AND_PROPAGATE_ERROR("Unable to fetch channel data with id '%s'",
-            id);
-    }
-    else
+    if (!json_reader_get_null_value(reader))
     {
         ret = parse_stream(reader, &err);
 
         CHECK_AND_PROPAGATE_ERROR("Unable to fetch channel data with id '%s'",
-            id);
-
-        END_JSON_MEMBER();
+            data->str_1);
     }
 
+    END_JSON_MEMBER();
+
     return ret;
 
 error:
-
     gt_channel_data_free(ret);
 
     return NULL;
 }
 
-GtChannel*
-gt_twitch_fetch_channel(GtTwitch* self, const gchar* id, GError** error)
+static GtChannelData*
+parse_fetch_channel(GtTwitch* self, JsonReader* reader,
+    GenericTaskData* data, GError** error)
 {
-    g_assert(GT_IS_TWITCH(self));
-    g_assert_false(utils_str_empty(id));
+    GtChannelData* ret = NULL;
+    GError* err = NULL;
 
-    GtChannelData* data = NULL;
-    GtChannel* channel = NULL;
+    ret = parse_channel(reader, &err);
 
-    DEBUG("Fetching channel with id '%s'", id);
+    CHECK_AND_PROPAGATE_ERROR("Unable to fetch channel data with id '%s'",
+        data->str_1);
 
-    data = gt_twitch_fetch_channel_data(self, id, error);
+    return ret;
+
+error:
+    gt_channel_data_free(ret);
 
-    if (*error)
-        return NULL;
+    return NULL;
+}
 
-    channel = gt_channel_new(data);
+static void
+fetch_channel_return(GTask* task, GtChannelData* data)
+{
+    GtChannel* channel = gt_channel_new(data);
 
     g_assert(g_object_is_floating(channel));
 
     g_object_ref_sink(channel);
 
-    return channel;
+    g_task_return_pointer(task, channel, (GDestroyNotify) g_object_unref);
 }
 
 static void
-fetch_channel_async_cb(GTask* task, gpointer source,
-    gpointer task_data, GCancellable* cancel)
+fetch_channel_cb(GObject* source,
+    GAsyncResult* res, gpointer udata)
 {
-    g_assert(GT_IS_TWITCH(source));
-    g_assert(G_IS_TASK(task));
-    g_assert_nonnull(task_data);
+    g_autoptr(GTask) task = udata;
+    GtChannelData* data = NULL;
+    GError* err = NULL;
+
+    data = g_task_propagate_pointer(G_TASK(res), &err);
+
+    if (err)
+        g_task_return_error(task, err);
+    else
+        fetch_channel_return(task, data);
+}
 
+static void
+fetch_stream_cb(GObject* source,
+    GAsyncResult* res, gpointer udata)
+{
+    g_autoptr(GTask) task = udata;
+    GenericTaskData* data = g_task_get_task_data(task);
+    GtChannelData* chan_data = NULL;
+    g_autofree gchar* uri = NULL;
     GError* err = NULL;
-    GenericTaskData* data = task_data;
 
-    GtChannel* ret = gt_twitch_fetch_channel(GT_TWITCH(source), data->str_1, &err);
+    chan_data = g_task_propagate_pointer(G_TASK(res), &err);
 
     if (err)
         g_task_return_error(task, err);
+    else if (chan_data)
+        fetch_channel_return(task, chan_data);
     else
-        g_task_return_pointer(task, ret, (GDestroyNotify) g_object_unref);
+    {
+        /* NOTE: The channel is offline, fetch it as a channel instead */
+        uri = g_strdup_printf(FETCH_CHANNEL_URI, data->str_1);
+
+        get_json_async(GT_TWITCH(source), uri, (ParseJsonFunc) parse_fetch_channel,
+            data, NULL, (GDestroyNotify) gt_channel_data_free,
+            g_task_get_cancellable(task), fetch_channel_cb, g_steal_pointer(&task));
+    }
 }
 
 void
@@ -1361,8 +1476,11 @@ gt_twitch_fetch_channel_async(GtTwitch* self,
     g_assert(GT_IS_TWITCH(self));
     g_assert_false(utils_str_empty(id));
 
-    GTask* task = NULL;
+    g_autofree gchar* uri = NULL;
     GenericTaskData* data = generic_task_data_new();
+    GTask* task = NULL;
+
+    DEBUG("Fetching channel with id '%s'", id);
 
     task = g_task_new(self, cancel, cb, udata);
 
@@ -1370,9 +1488,12 @@ gt_twitch_fetch_channel_async(GtTwitch* self,
 
     g_task_set_task_data(task, data, (GDestroyNotify) generic_task_data_free);
 
-    g_task_run_in_thread(task, fetch_channel_async_cb);
+    uri = g_strdup_printf(FETCH_STREAM_URI, id);
 
-    g_object_unref(task);
+    /* NOTE: The task keeps the data alive for both requests */
+    get_json_async(self, uri, (ParseJsonFunc) parse_fetch_stream,
+        data, NULL, (GDestroyNotify) gt_channel_data_free,
+        cancel, fetch_stream_cb, task);
 }
 
 GtChannel*
@@ -1543,59 +1664,336 @@ gt_twitch_download_picture_async(GtTwitch* self,
     g_object_unref(task);
 }
 
-GdkPixbuf*
-gt_twitch_download_emote(GtTwitch* self, gint id)
+static GdkPixbuf*
+load_error_image()
+{
+    g_autoptr(GtkIconInfo) icon_info = NULL;
+
+    icon_info = gtk_icon_theme_lookup_icon(gtk_icon_theme_get_default(),
+        "software-update-urgent-symbolic", 1, 0);
+
+    return gtk_icon_info_load_icon(icon_info, NULL);
+}
+
+static GtResourceDownloader*
+get_thread_downloader(GPrivate* key, const gchar* dir)
+{
+    GtResourceDownloader* ret = g_private_get(key);
+
+    if (!ret)
+    {
+        g_autofree gchar* filepath = g_build_filename(g_get_user_cache_dir(),
+            "gnome-twitch", dir, NULL);
+
+        ret = gt_resource_downloader_new_with_cache(filepath);
+        gt_resource_downloader_set_image_filetype(ret, GT_IMAGE_FILETYPE_PNG);
+
+        g_private_set(key, ret);
+    }
+
+    return ret;
+}
+
+static void
+image_fetch_data_free(ImageFetchData* data)
+{
+    g_object_unref(data->self);
+    g_free(data->badge_set);
+    g_free(data->uri);
+    g_free(data->name);
+    g_free(data->key);
+    g_free(data->filename);
+    g_clear_object(&data->pixbuf);
+    g_slice_free(ImageFetchData, data);
+}
+
+static inline gint64
+emote_key(gint id, gint scale)
+{
+    return ((gint64) id << 2) | scale;
+}
+
+static gboolean
+image_fetched_cb(ImageFetchData* data)
 {
+    GtTwitch* self = data->self;
     GtTwitchPrivate* priv = gt_twitch_get_instance_private(self);
-    GdkPixbuf* ret = NULL;
 
-    if (!g_hash_table_contains(priv->emote_table, GINT_TO_POINTER(id)))
+    g_mutex_lock(&priv->image_mutex);
+
+    if (data->pixbuf)
+        gt_image_cache_insert(priv->image_cache, data->key, data->pixbuf, data->filename);
+
+    if (data->badge)
+        data->badge->pending[data->scale - 1] = FALSE;
+    else
+    {
+        gint64 key = emote_key(data->id, data->scale);
+
+        g_hash_table_remove(priv->pending_emotes, &key);
+    }
+
+    g_mutex_unlock(&priv->image_mutex);
+
+    if (++priv->images_fetched % IMAGE_STATS_INTERVAL == 0)
+    {
+        GtImageCacheStats stats;
+
+        gt_image_cache_get_stats(priv->image_cache, &stats);
+
+        DEBUGF("Image cache has '%u' images taking up '%" G_GSIZE_FORMAT "' of '%" G_GSIZE_FORMAT "' bytes, "
+            "'%" G_GUINT64_FORMAT "' hits, '%" G_GUINT64_FORMAT "' disk hits, '%" G_GUINT64_FORMAT "' misses "
+            "and '%" G_GUINT64_FORMAT "' evictions",
+            stats.n_images, stats.resident_bytes, stats.budget,
+            stats.hits, stats.disk_hits, stats.misses, stats.evictions);
+    }
+
+    if (data->badge)
+        g_signal_emit(self, sigs[SIG_BADGE_RESOLVED], 0, data->badge);
+    else if (data->pixbuf)
+        g_signal_emit(self, sigs[SIG_EMOTE_RESOLVED], 0, data->id, data->pixbuf, data->scale);
+
+    image_fetch_data_free(data);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void load_chat_badge_sets(GtTwitch* self, const gchar* chan_id, GError** error);
+
+static void
+fetch_image_cb(ImageFetchData* data, gpointer udata)
+{
+    GtResourceDownloader* downloader = NULL;
+    g_autoptr(GError) err = NULL;
+
+    /* NOTE: Placeholders are filled in and 'badge-resolved' emitted
+     * for them by loading the sets, failures were already logged */
+    if (data->badge_set)
     {
-        g_autofree gchar* uri = NULL;
-        g_autoptr(GError) err = NULL;
-        g_autoptr(GdkPixbuf) emote = NULL;
-        gchar id_str[15];
+        load_chat_badge_sets(data->self, data->badge_set, NULL);
+        image_fetch_data_free(data);
 
-        uri = g_strdup_printf(TWITCH_EMOTE_URI, id, 1);
-        g_sprintf(id_str, "%d", id);
+        return;
+    }
 
-        DEBUGF("Downloading emote form url='%s'", uri);
+    /* NOTE: Images evicted from the image cache were already fetched
+     * this session, so they're loaded from disk without asking Twitch
+     * if they changed */
+    if (data->filename)
+    {
+        DEBUG("Loading image from file '%s'", data->filename);
 
-        emote = gt_resource_downloader_download_image(emote_downloader, uri, id_str, &err);
+        data->pixbuf = gdk_pixbuf_new_from_file(data->filename, &err);
 
-        /* NOTE: If we encountered an error here we'll just insert a generic error emote */
         if (err)
         {
-            g_autoptr(GtkIconInfo) icon_info;
-
-            WARNING("Unable to download emote with id '%d' because: %s", id, err->message);
+            DEBUG("Unable to load image from file '%s' because: %s",
+                data->filename, err->message);
 
             g_clear_error(&err);
+            g_clear_object(&data->pixbuf);
+        }
+    }
+
+    if (!data->pixbuf)
+    {
+        downloader = data->badge ?
+            get_thread_downloader(&badge_fetch_downloader, "badges") :
+            get_thread_downloader(&emote_fetch_downloader, "emotes");
+
+        DEBUGF("Fetching image from uri='%s'", data->uri);
 
-            icon_info = gtk_icon_theme_lookup_icon(gtk_icon_theme_get_default(),
-                "software-update-urgent-symbolic", 1, 0);
+        data->pixbuf = gt_resource_downloader_download_image(downloader,
+            data->uri, data->name, &err);
 
-            emote = gtk_icon_info_load_icon(icon_info, &err);
+        /* NOTE: If we encountered an error here we'll just insert a generic error image */
+        if (err)
+        {
+            WARNING("Unable to fetch image from uri '%s' because: %s",
+                data->uri, err->message);
 
-            RETURN_VAL_IF_FAIL(err == NULL, NULL);
+            g_clear_object(&data->pixbuf);
         }
+    }
 
-        g_hash_table_insert(priv->emote_table, GINT_TO_POINTER(id),
-            g_steal_pointer(&emote));
+    g_clear_pointer(&data->filename, g_free);
+
+    if (!data->pixbuf)
+        data->pixbuf = load_error_image();
+    else
+    {
+        /* NOTE: The key is also where the downloader saved the image */
+        data->filename = g_build_filename(g_get_user_cache_dir(), "gnome-twitch", data->key, NULL);
 
-        //TODO: Propagate this error further
-        RETURN_VAL_IF_FAIL(err == NULL, NULL);
+        if (source_scales[data->scale - 1] != data->scale)
+        {
+            GdkPixbuf* scaled = gdk_pixbuf_scale_simple(data->pixbuf,
+                MAX(gdk_pixbuf_get_width(data->pixbuf)*data->scale/source_scales[data->scale - 1], 1),
+                MAX(gdk_pixbuf_get_height(data->pixbuf)*data->scale/source_scales[data->scale - 1], 1),
+                GDK_INTERP_BILINEAR);
+
+            g_object_unref(data->pixbuf);
+            data->pixbuf = scaled;
+        }
     }
 
-    ret = GDK_PIXBUF(g_hash_table_lookup(priv->emote_table, GINT_TO_POINTER(id)));
+    g_idle_add((GSourceFunc) image_fetched_cb, data);
+}
+
+static void
+queue_image_fetch(GtTwitch* self, gint id, GtChatBadge* badge, gint scale,
+    const gchar* uri, const gchar* name, const gchar* key, gchar* filename)
+{
+    GtTwitchPrivate* priv = gt_twitch_get_instance_private(self);
+    ImageFetchData* data = g_slice_new0(ImageFetchData);
+
+    data->self = g_object_ref(self);
+    data->id = id;
+    data->badge = badge;
+    data->scale = scale;
+    data->uri = g_strdup(uri);
+    data->name = g_strdup(name);
+    data->key = g_strdup(key);
+    data->filename = filename;
+
+    g_thread_pool_push(priv->image_download_pool, data, NULL);
+}
+
+/* NOTE: Never blocks on the network. If the emote isn't in the image
+ * cache at this scale NULL is returned and it's fetched in the
+ * background, 'emote-resolved' is emitted on the main thread once
+ * it's ready. The image is scale times the emote's size, scales past
+ * GT_CHAT_IMAGE_MAX_SCALE are clamped */
+GdkPixbuf*
+gt_twitch_resolve_emote(GtTwitch* self, gint id, gint scale)
+{
+    g_assert(GT_IS_TWITCH(self));
+
+    GtTwitchPrivate* priv = gt_twitch_get_instance_private(self);
+    g_autofree gchar* name = NULL;
+    g_autofree gchar* cache_key = NULL;
+    gchar* filename = NULL;
+    GdkPixbuf* ret = NULL;
+    gboolean fetch = FALSE;
+    gint64 key;
 
-    g_object_ref(ret);
+    scale = CLAMP(scale, 1, GT_CHAT_IMAGE_MAX_SCALE);
+    key = emote_key(id, scale);
+
+    /* NOTE: Scale 1 keeps the name emotes were cached under before */
+    name = scale == 1 ? g_strdup_printf("%d", id) : g_strdup_printf("%d@%dx", id, scale);
+    cache_key = g_strconcat("emotes/", name, NULL);
+
+    g_mutex_lock(&priv->image_mutex);
+
+    if (!g_hash_table_contains(priv->pending_emotes, &key))
+    {
+        ret = gt_image_cache_lookup(priv->image_cache, cache_key, &filename);
+
+        if (!ret)
+        {
+            g_hash_table_add(priv->pending_emotes, g_memdup(&key, sizeof(key)));
+            fetch = TRUE;
+        }
+    }
+
+    g_mutex_unlock(&priv->image_mutex);
+
+    if (fetch)
+    {
+        g_autofree gchar* uri = g_strdup_printf(TWITCH_EMOTE_URI, id, scale);
+
+        queue_image_fetch(self, id, NULL, scale, uri, name, cache_key, filename);
+    }
+
+    return ret;
+}
+
+/* NOTE: Works like gt_twitch_resolve_emote, 'badge-resolved' is
+ * emitted once a badge image is ready */
+GdkPixbuf*
+gt_twitch_resolve_badge(GtTwitch* self, GtChatBadge* badge, gint scale)
+{
+    g_assert(GT_IS_TWITCH(self));
+    g_assert_nonnull(badge);
+
+    GtTwitchPrivate* priv = gt_twitch_get_instance_private(self);
+    g_autofree gchar* name = NULL;
+    g_autofree gchar* cache_key = NULL;
+    gchar* filename = NULL;
+    GdkPixbuf* ret = NULL;
+    gboolean fetch = FALSE;
+    gint i;
+
+    scale = CLAMP(scale, 1, GT_CHAT_IMAGE_MAX_SCALE);
+    i = scale - 1;
+
+    g_mutex_lock(&priv->image_mutex);
+
+    /* NOTE: Placeholders get their uris once the badge set is loaded,
+     * they don't change after that */
+    if (badge->uri[i])
+    {
+        name = scale == 1 ? g_strdup(badge->key) :
+            g_strdup_printf("%s@%dx", badge->key, scale);
+        cache_key = g_strconcat("badges/", name, NULL);
+    }
+
+    if (badge->pixbuf[i])
+        ret = g_object_ref(badge->pixbuf[i]);
+    else if (cache_key && !badge->pending[i])
+    {
+        ret = gt_image_cache_lookup(priv->image_cache, cache_key, &filename);
+
+        if (!ret)
+        {
+            badge->pending[i] = TRUE;
+            fetch = TRUE;
+        }
+    }
+
+    g_mutex_unlock(&priv->image_mutex);
+
+    if (fetch)
+        queue_image_fetch(self, 0, badge, scale, badge->uri[i], name, cache_key, filename);
 
     return ret;
 }
 
+/* NOTE: Must be called with the image mutex held. Takes the uris of
+ * from, a placeholder keeps its key unless it's filled from another
+ * set */
+static void
+fill_chat_badge(GtChatBadge* badge, GtChatBadge* from, gboolean steal)
+{
+    for (gint i = 0; i < GT_CHAT_IMAGE_MAX_SCALE; i++)
+    {
+        g_free(badge->uri[i]);
+        badge->uri[i] = steal ? g_steal_pointer(&from->uri[i]) : g_strdup(from->uri[i]);
+    }
+
+    if (!steal)
+    {
+        g_free(badge->key);
+        badge->key = g_strdup(from->key);
+    }
+}
+
+static gboolean
+badges_resolved_cb(GPtrArray* badges)
+{
+    for (guint i = 0; i < badges->len; i++)
+        g_signal_emit(main_app->twitch, sigs[SIG_BADGE_RESOLVED], 0, badges->pdata[i]);
+
+    g_ptr_array_unref(badges);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* NOTE: Placeholders that are in the set are filled in and added to
+ * resolved */
 static void
-fetch_chat_badge_set(GtTwitch* self, const gchar* set_name, GError** error)
+fetch_chat_badge_set(GtTwitch* self, const gchar* set_name, GPtrArray* resolved, GError** error)
 {
     g_assert(GT_IS_TWITCH(self));
     g_assert_false(utils_str_empty(set_name));
@@ -1606,10 +2004,6 @@ fetch_chat_badge_set(GtTwitch* self, const gchar* set_name, GError** error)
     g_autofree gchar* uri = NULL;
     GError* err = NULL;
 
-    g_assert_false(g_hash_table_contains(priv->badge_table, set_name));
-
-    g_hash_table_add(priv->badge_table, g_strdup(set_name)); //NOTE: This will be freed by the hash table when it's destroyed
-
     INFOF("Fetching chat badge set with name '%s'", set_name);
 
     uri = g_strcmp0(set_name, "global") == 0 ? g_strdup_printf(GLOBAL_CHAT_BADGES_URI) :
@@ -1634,9 +2028,9 @@ fetch_chat_badge_set(GtTwitch* self, const gchar* set_name, GError** error)
         for (gint j = 0; j < json_reader_count_members(reader); j++)
         {
             GtChatBadge* badge = gt_chat_badge_new();
+            GtChatBadge* placeholder;
             /* NOTE: Don't need to free this as it's freed by the hash table when it's destroyed. */
             gchar* key = NULL;
-            g_autofree gchar* uri = NULL;
 
             READ_JSON_ELEMENT(j);
 
@@ -1644,52 +2038,118 @@ fetch_chat_badge_set(GtTwitch* self, const gchar* set_name, GError** error)
             badge->version = g_strdup(json_reader_get_member_name(reader));
 
             key = g_strdup_printf("%s-%s-%s", set_name, badge->name, badge->version);
+            badge->key = g_strdup(key);
 
-            READ_JSON_VALUE("image_url_1x", uri);
-            badge->pixbuf = gt_resource_downloader_download_image(badge_downloader,
-                uri, key, &err);
+            READ_JSON_VALUE("image_url_1x", badge->uri[0]);
+            READ_JSON_VALUE("image_url_2x", badge->uri[1]);
+            READ_JSON_VALUE("image_url_4x", badge->uri[2]);
 
-            if (err)
+            END_JSON_ELEMENT();
+
+            /* NOTE: The images are only fetched once they're shown,
+             * at the scale they're shown at */
+            DEBUGF("Queued badge for set '%s' with name '%s' and version '%s'", set_name,
+                badge->name, badge->version);
+
+            g_mutex_lock(&priv->image_mutex);
+
+            if ((placeholder = g_hash_table_lookup(priv->badge_table, key)) != NULL)
             {
-                g_autoptr(GtkIconInfo) icon_info;
+                fill_chat_badge(placeholder, badge, TRUE);
+                g_ptr_array_remove_fast(priv->badge_placeholders, placeholder);
+                g_ptr_array_add(resolved, placeholder);
 
-                WARNING("Unable to fetch chat badge set with name '%s' because: %s",
-                    set_name, err->message);
+                gt_chat_badge_free(badge);
+                g_free(key);
+            }
+            else
+                g_hash_table_insert(priv->badge_table, key, badge);
 
-                g_clear_error(&err);
+            g_mutex_unlock(&priv->image_mutex);
+        }
 
-                /* NOTE: If we encountered an error here we'll just insert a generic error emote */
+        END_JSON_MEMBER();
+        END_JSON_ELEMENT();
+    }
 
-                g_clear_error(&err);
+    END_JSON_MEMBER();
 
-                icon_info = gtk_icon_theme_lookup_icon(gtk_icon_theme_get_default(),
-                    "software-update-urgent-symbolic", 1, 0);
+error:
+    return;
+}
 
-                badge->pixbuf = gtk_icon_info_load_icon(icon_info, &err);
+/* NOTE: Placeholders of the channel that weren't in its set are
+ * global badges, or badges Twitch doesn't have which stay empty. Sets
+ * that failed to load are marked loaded as well so they aren't
+ * fetched for every message */
+static void
+load_chat_badge_sets(GtTwitch* self, const gchar* chan_id, GError** error)
+{
+    GtTwitchPrivate* priv = gt_twitch_get_instance_private(self);
+    g_autofree gchar* prefix = g_strdup_printf("%s-", chan_id);
+    GPtrArray* resolved = g_ptr_array_new();
+    const gchar* sets[] = {"global", chan_id};
+    GError* err = NULL;
 
-                RETURN_IF_FAIL(err == NULL);
+    g_mutex_lock(&priv->badge_set_mutex);
 
-            }
+    for (guint i = 0; i < G_N_ELEMENTS(sets); i++)
+    {
+        gboolean loaded;
 
-            END_JSON_ELEMENT();
+        g_mutex_lock(&priv->image_mutex);
+        loaded = g_hash_table_contains(priv->badge_table, sets[i]);
+        g_mutex_unlock(&priv->image_mutex);
+
+        if (loaded)
+            continue;
 
+        /* NOTE: Only the first error is kept */
+        fetch_chat_badge_set(self, sets[i], resolved, err ? NULL : &err);
 
-            g_assert_false(g_hash_table_contains(priv->badge_table, key));
+        g_mutex_lock(&priv->image_mutex);
+        g_hash_table_add(priv->badge_table, g_strdup(sets[i])); //NOTE: This will be freed by the hash table when it's destroyed
+        g_mutex_unlock(&priv->image_mutex);
+    }
 
-            g_hash_table_insert(priv->badge_table, key, badge);
+    g_mutex_lock(&priv->image_mutex);
 
-            DEBUGF("Downloaded emote for set '%s' with name '%s' and version '%s'", set_name,
-                badge->name, badge->version);
+    for (guint i = priv->badge_placeholders->len; i > 0; i--)
+    {
+        GtChatBadge* placeholder = priv->badge_placeholders->pdata[i - 1];
+        g_autofree gchar* global_key = NULL;
+        GtChatBadge* global;
+
+        if (!g_str_has_prefix(placeholder->key, prefix))
+            continue;
+
+        global_key = g_strdup_printf("global-%s-%s", placeholder->name, placeholder->version);
+
+        if ((global = g_hash_table_lookup(priv->badge_table, global_key)) != NULL)
+        {
+            fill_chat_badge(placeholder, global, FALSE);
+            g_ptr_array_add(resolved, placeholder);
         }
 
-        END_JSON_MEMBER();
-        END_JSON_ELEMENT();
+        g_ptr_array_remove_index_fast(priv->badge_placeholders, i - 1);
     }
 
-    END_JSON_MEMBER();
+    g_mutex_unlock(&priv->image_mutex);
 
-error:
-    return;
+    g_mutex_unlock(&priv->badge_set_mutex);
+
+    if (resolved->len > 0)
+        g_idle_add((GSourceFunc) badges_resolved_cb, resolved);
+    else
+        g_ptr_array_unref(resolved);
+
+    if (err)
+    {
+        WARNINGF("Unable to load chat badge sets for channel '%s'", chan_id);
+
+        g_propagate_prefixed_error(error, err,
+            "Unable to load chat badge sets for channel '%s' because: ", chan_id);
+    }
 }
 
 void
@@ -1697,35 +2157,75 @@ gt_twitch_load_chat_badge_sets_for_channel(GtTwitch* self, const gchar* chan_id,
 {
     g_assert(GT_IS_TWITCH(self));
 
+    load_chat_badge_sets(self, chan_id, error);
+}
+
+/* NOTE: Never blocks on the network, for the IRC thread. If the badge
+ * sets of the channel aren't loaded yet a placeholder is returned and
+ * the sets are loaded in the background, 'badge-resolved' is emitted
+ * once it's filled in. Placeholders for badges that turn out not to
+ * exist stay empty, once the sets are loaded those are NULL */
+GtChatBadge*
+gt_twitch_lookup_chat_badge(GtTwitch* self,
+    const gchar* chan_id, const gchar* badge_name, const gchar* version)
+{
+    g_assert(GT_IS_TWITCH(self));
+    g_assert_false(utils_str_empty(chan_id));
+    g_assert_false(utils_str_empty(badge_name));
+    g_assert_false(utils_str_empty(version));
+
     GtTwitchPrivate* priv = gt_twitch_get_instance_private(self);
+    g_autofree gchar* chan_key = g_strdup_printf("%s-%s-%s", chan_id, badge_name, version);
+    GtChatBadge* ret = NULL;
+    gboolean queue = FALSE;
+    gboolean loaded;
 
-#define FETCH_BADGE_SET(s)                                              \
-    if (!g_hash_table_contains(priv->badge_table, s))                   \
-    {                                                                   \
-        GError* err = NULL;                                             \
-                                                                        \
-        fetch_chat_badge_set(self, s, &err);                            \
-                                                                        \
-        if (err)                                                        \
-        {                                                               \
-            WARNINGF("Unable to load chat badge sets for channel '%s'", \
-                chan_id);                                               \
-                                                                        \
-            g_propagate_prefixed_error(error, err,                      \
-                "Unable to load chat badge sets for channel '%s' because: ", chan_id); \
-                                                                        \
-            return;                                                     \
-        }                                                               \
-    }                                                                   \
+    g_mutex_lock(&priv->image_mutex);
+
+    loaded = g_hash_table_contains(priv->badge_table, chan_id) &&
+        g_hash_table_contains(priv->badge_table, "global");
+
+    if ((ret = g_hash_table_lookup(priv->badge_table, chan_key)) != NULL)
+    {
+        if (loaded && !ret->uri[0])
+            ret = NULL;
+    }
+    else if (loaded)
+    {
+        g_autofree gchar* global_key = g_strdup_printf("global-%s-%s", badge_name, version);
+
+        ret = g_hash_table_lookup(priv->badge_table, global_key);
+    }
+    else
+    {
+        ret = gt_chat_badge_new();
+        ret->name = g_strdup(badge_name);
+        ret->version = g_strdup(version);
+        ret->key = g_strdup(chan_key);
+
+        g_hash_table_insert(priv->badge_table, g_steal_pointer(&chan_key), ret);
+        g_ptr_array_add(priv->badge_placeholders, ret);
+
+        queue = g_hash_table_add(priv->queued_badge_sets, g_strdup(chan_id));
+    }
+
+    g_mutex_unlock(&priv->image_mutex);
+
+    if (queue)
+    {
+        ImageFetchData* data = g_slice_new0(ImageFetchData);
+
+        data->self = g_object_ref(self);
+        data->badge_set = g_strdup(chan_id);
 
-    FETCH_BADGE_SET("global");
-    FETCH_BADGE_SET(chan_id);
+        g_thread_pool_push(priv->image_download_pool, data, NULL);
+    }
 
-#undef FETCH_BADGE_SET
+    return ret;
 }
 
 // NOTE: This will automatically download any badge sets if they
-// aren't already
+// aren't already. Returns NULL for badges Twitch doesn't have
 GtChatBadge*
 gt_twitch_fetch_chat_badge(GtTwitch* self,
     const gchar* chan_id, const gchar* badge_name,
@@ -1741,7 +2241,7 @@ gt_twitch_fetch_chat_badge(GtTwitch* self,
     GtChatBadge* ret = NULL;
     GError* err = NULL;
 
-    gt_twitch_load_chat_badge_sets_for_channel(self, chan_id, &err);
+    load_chat_badge_sets(self, chan_id, &err);
 
     CHECK_AND_PROPAGATE_ERROR("Unable to fetch chat badge for channel '%s with badge name '%s' and version '%s'",
         chan_id, badge_name, version);
@@ -1749,12 +2249,13 @@ gt_twitch_fetch_chat_badge(GtTwitch* self,
     global_key = g_strdup_printf("global-%s-%s", badge_name, version);
     chan_key = g_strdup_printf("%s-%s-%s", chan_id, badge_name, version);
 
-    if (g_hash_table_contains(priv->badge_table, chan_key))
-        ret = g_hash_table_lookup(priv->badge_table, chan_key);
-    else if (g_hash_table_contains(priv->badge_table, global_key))
+    g_mutex_lock(&priv->image_mutex);
+
+    /* NOTE: Placeholders that weren't filled in are left empty */
+    if ((ret = g_hash_table_lookup(priv->badge_table, chan_key)) == NULL || !ret->uri[0])
         ret = g_hash_table_lookup(priv->badge_table, global_key);
-    else
-        g_assert_not_reached(); //NOTE: We might as well crash here as the badge being null would lead to many problems
+
+    g_mutex_unlock(&priv->image_mutex);
 
 error:
     return ret;
@@ -2030,54 +2531,73 @@ error:
     return NULL;
 }
 
-static GList*
-fetch_followed_streams(GtTwitch* self, const gchar* oauth_token,
-    gint limit, gint offset, gint64* total, GError** error)
-{
-    g_assert(GT_IS_TWITCH(self));
-    g_assert_cmpint(limit, >, 0);
-    g_assert_cmpint(offset, >=, 0);
-    g_assert_false(utils_str_empty(oauth_token));
+#define FOLLOWED_LIMIT 100
+#define FOLLOWED_WINDOW 4
 
-    g_autoptr(SoupMessage) msg;
-    g_autoptr(JsonReader) reader;
-    g_autofree gchar* uri;
-    GList* ret = NULL;
-    GError* err = NULL;
+/* NOTE: Pages are kept by index so they can arrive in any order. The
+ * totals are in pages and stay at 1 until the first page of their
+ * list has said how many there are */
+typedef struct
+{
+    gchar* id;
+    gchar* oauth_token;
+    GPtrArray* stream_pages;
+    GPtrArray* chan_pages;
+    gint stream_total;
+    gint chan_total;
+    gint next_stream;
+    gint next_chan;
+    guint inflight;
+    gboolean failed;
+} FollowedChannelsData;
 
-    uri = g_strdup_printf(FOLLOWED_STREAMS_URI, limit, offset, oauth_token);
+typedef struct
+{
+    GTask* task;
+    gboolean live; // A page of followed streams rather than channels
+    gint index;
+    gint64 total; // Written while the page is parsed
+} FollowedPage;
 
-    msg = soup_message_new(SOUP_METHOD_GET, uri);
+static void
+followed_channels_data_free(FollowedChannelsData* data)
+{
+    g_free(data->id);
+    g_free(data->oauth_token);
+    g_ptr_array_unref(data->stream_pages);
+    g_ptr_array_unref(data->chan_pages);
 
-    reader = new_send_message_json(self, msg, &err);
+    g_slice_free(FollowedChannelsData, data);
+}
 
-    CHECK_AND_PROPAGATE_ERROR("Unable to fetch followed streams with oauth token '%s', limit '%d' and offset '%d'",
-        oauth_token, limit, offset);
+static GList*
+parse_followed_streams(GtTwitch* self, JsonReader* reader,
+    FollowedPage* page, GError** error)
+{
+    GList* ret = NULL;
+    GError* err = NULL;
 
-    if (total)
-    {
-        READ_JSON_VALUE("_total", *total);
-    }
+    READ_JSON_VALUE("_total", page->total);
 
     READ_JSON_MEMBER("streams");
 
     for (gint i = 0; i < json_reader_count_elements(reader); i++)
     {
-        GtChannelData* data = NULL;
+        GtChannelData* chan_data = NULL;
 
         READ_JSON_ELEMENT(i);
 
-        data = parse_stream(reader, &err);
+        chan_data = parse_stream(reader, &err);
 
-        CHECK_AND_PROPAGATE_ERROR("Unable to fetch followed streams with oauth token '%s', limit '%d' and offset '%d'",
-            oauth_token, limit, offset);
+        CHECK_AND_PROPAGATE_ERROR("Unable to fetch followed streams with limit '%d' and offset '%d'",
+            FOLLOWED_LIMIT, page->index*FOLLOWED_LIMIT);
 
-        ret = g_list_append(ret, data);
+        ret = g_list_prepend(ret, chan_data);
 
         END_JSON_ELEMENT();
     }
 
-    return ret;
+    return g_list_reverse(ret);
 
 error:
     gt_channel_data_list_free(ret);
@@ -2086,54 +2606,35 @@ error:
 }
 
 static GList*
-fetch_followed_channels(GtTwitch* self, const gchar* id,
-    gint limit, gint offset, gint64* total, GError** error)
+parse_followed_channels(GtTwitch* self, JsonReader* reader,
+    FollowedPage* page, GError** error)
 {
-    g_assert(GT_IS_TWITCH(self));
-    g_assert_cmpint(limit, >, 0);
-    g_assert_cmpint(offset, >=, 0);
-
-    g_autoptr(SoupMessage) msg;
-    g_autoptr(JsonReader) reader;
-    g_autofree gchar* uri;
     GList* ret = NULL;
     GError* err = NULL;
 
-    uri = g_strdup_printf(FOLLOWED_CHANNELS_URI, id, limit, offset);
-
-    msg = soup_message_new(SOUP_METHOD_GET, uri);
-
-    reader = new_send_message_json(self, msg, &err);
-
-    CHECK_AND_PROPAGATE_ERROR("Unable to fetch followed channels with name '%s', limit '%d' and offset '%d'",
-        id, limit, offset);
-
-    if (total)
-    {
-        READ_JSON_VALUE("_total", *total);
-    }
+    READ_JSON_VALUE("_total", page->total);
 
     READ_JSON_MEMBER("follows");
 
     for (gint i = 0; i < json_reader_count_elements(reader); i++)
     {
-        GtChannelData* data = NULL;
+        GtChannelData* chan_data = NULL;
 
         READ_JSON_ELEMENT(i);
         READ_JSON_MEMBER("channel");
 
-        data = parse_channel(reader, &err);
+        chan_data = parse_channel(reader, &err);
 
-        CHECK_AND_PROPAGATE_ERROR("Unable to fetch followed channels with name '%s', limit '%d' and offset '%d'",
-            id, limit, offset);
+        CHECK_AND_PROPAGATE_ERROR("Unable to fetch followed channels with limit '%d' and offset '%d'",
+            FOLLOWED_LIMIT, page->index*FOLLOWED_LIMIT);
 
-        ret = g_list_append(ret, data);
+        ret = g_list_prepend(ret, chan_data);
 
         END_JSON_MEMBER();
         END_JSON_ELEMENT();
     }
 
-    return ret;
+    return g_list_reverse(ret);
 
 error:
     gt_channel_data_list_free(ret);
@@ -2141,122 +2642,187 @@ error:
     return NULL;
 }
 
-GList*
-gt_twitch_fetch_all_followed_channels(GtTwitch* self,
-    const gchar* id, const gchar* oauth_token, GError** error)
-{
-    g_assert(GT_IS_TWITCH(self));
-
-#define LIMIT 100
-
-    gint64 total = 0;
-    GList* chans = NULL;
+/* NOTE: Followed streams are also returned as followed channels, the
+ * stream takes the place of the channel. Takes the channel data out
+ * of the pages */
+static GList*
+merge_followed_channels(FollowedChannelsData* data)
+{
+    /* NOTE: Ids of the channels added, mapped to the name of live ones
+     * until they're found among the follows. Pages can overlap when
+     * follows change while they're fetched, so the same id can come up
+     * more than once */
+    g_autoptr(GHashTable) seen = g_hash_table_new(g_str_hash, g_str_equal);
+    GHashTableIter iter;
+    const gchar* name;
     GList* streams = NULL;
     GList* ret = NULL;
-    GError* err = NULL;
-
-    streams = g_list_concat(streams,
-        fetch_followed_streams(self, oauth_token, LIMIT, 0, &total, &err));
 
-    CHECK_AND_PROPAGATE_ERROR("Unable to fetch all followed channels");
-
-    if (total > LIMIT)
+    for (guint i = 0; i < data->stream_pages->len; i++)
     {
-        for (gint i = LIMIT; i < total; i += LIMIT)
-        {
-            streams = g_list_concat(streams,
-                fetch_followed_streams(self, oauth_token, LIMIT, i, NULL, &err));
+        GList* page = data->stream_pages->pdata[i];
 
-            CHECK_AND_PROPAGATE_ERROR("Unable to fetch all followed channels");
-        }
-    }
-
-    chans = g_list_concat(chans,
-        fetch_followed_channels(self, id, LIMIT, 0, &total, &err));
+        for (GList* l = page; l != NULL; l = l->next)
+        {
+            GtChannelData* chan_data = l->data;
 
-    CHECK_AND_PROPAGATE_ERROR("Unable to fetch all followed channels");
+            if (g_hash_table_contains(seen, chan_data->id))
+            {
+                gt_channel_data_free(chan_data);
+                continue;
+            }
 
-    if (total > LIMIT)
-    {
-        for (gint i = LIMIT; i < total; i += LIMIT)
-        {
-            chans = g_list_concat(chans,
-                fetch_followed_channels(self, id, LIMIT, i, NULL, &err));
+            g_hash_table_insert(seen, chan_data->id, chan_data->name);
 
-            CHECK_AND_PROPAGATE_ERROR("Unable to fetch all followed channels");
+            streams = g_list_prepend(streams, gt_channel_new(chan_data)); //NOTE: gt_channel_new takes ownership of the data
         }
+
+        g_list_free(page);
+        data->stream_pages->pdata[i] = NULL;
     }
 
-    //NOTE: Remove duplicates
-    for (GList* l = streams; l != NULL; l = l->next)
+    for (guint i = 0; i < data->chan_pages->len; i++)
     {
-        GList* found = g_list_find_custom(chans, l->data, (GCompareFunc) gt_channel_data_compare);
+        GList* page = data->chan_pages->pdata[i];
 
-        if (!found)
+        for (GList* l = page; l != NULL; l = l->next)
         {
-            WARNINGF("Unable to fetch all followed channels with id '%s' and oauth token '%s' because: "
-                "The followed stream '%s' did not exist as a followed channel", id, oauth_token, ((GtChannelData*) l->data)->name);
+            GtChannelData* chan_data = l->data;
+
+            if (g_hash_table_contains(seen, chan_data->id))
+            {
+                g_assert_false(chan_data->online);
+
+                g_hash_table_insert(seen, chan_data->id, NULL);
+                gt_channel_data_free(chan_data);
+                continue;
+            }
 
-            /* NOTE: This is commented out because we won't treat it
-             * as a hard error and try to load follows anyways */
-            /* g_set_error(error, GT_TWITCH_ERROR, GT_TWITCH_ERROR_MISC, "Unable to fetch all followed channels with id '%s' and oauth token '%s' because: " */
-            /*     "A followed stream did not exist as a followed channel", id, oauth_token); */
+            g_hash_table_insert(seen, chan_data->id, NULL);
 
-            /* goto error; */
+            ret = g_list_prepend(ret, gt_channel_new(chan_data));
         }
-        else
-        {
-            g_assert_nonnull(found->data);
-            g_assert_false(((GtChannelData*) found->data)->online);
 
-            gt_channel_data_free(found->data);
+        g_list_free(page);
+        data->chan_pages->pdata[i] = NULL;
+    }
 
-            chans = g_list_delete_link(chans, found);
+    /* NOTE: This isn't treated as a hard error, follows are loaded
+     * anyways */
+    g_hash_table_iter_init(&iter, seen);
+    while (g_hash_table_iter_next(&iter, NULL, (gpointer*) &name))
+    {
+        if (name)
+        {
+            WARNINGF("Unable to fetch all followed channels with id '%s' because: "
+                "The followed stream '%s' did not exist as a followed channel", data->id, name);
         }
     }
 
-    chans = g_list_concat(chans, streams);
+    return g_list_concat(g_list_reverse(ret), g_list_reverse(streams));
+}
 
-    for (GList* l = chans; l != NULL; l = l->next)
-    {
-        GtChannelData* data = l->data;
-        GtChannel* chan = gt_channel_new(data);
+static void followed_page_cb(GObject* source, GAsyncResult* res, gpointer udata);
 
-        ret = g_list_append(ret, chan);
-    }
+static void
+fetch_followed_page(GTask* task, gboolean live, gint index)
+{
+    FollowedChannelsData* data = g_task_get_task_data(task);
+    FollowedPage* page = g_slice_new0(FollowedPage);
+    g_autofree gchar* uri = NULL;
 
-    g_list_free(chans); //NOTE: Don't need to free entire list because gt_channel_new takes ownership of the data
+    page->task = g_object_ref(task);
+    page->live = live;
+    page->index = index;
 
-    return ret;
+    if (live)
+        uri = g_strdup_printf(FOLLOWED_STREAMS_URI, FOLLOWED_LIMIT, index*FOLLOWED_LIMIT, data->oauth_token);
+    else
+        uri = g_strdup_printf(FOLLOWED_CHANNELS_URI, data->id, FOLLOWED_LIMIT, index*FOLLOWED_LIMIT);
 
-error:
-    gt_channel_data_list_free(chans);
-    gt_channel_data_list_free(streams);
+    data->inflight++;
 
-    return NULL;
+    get_json_async(g_task_get_source_object(task), uri, live ?
+        (ParseJsonFunc) parse_followed_streams : (ParseJsonFunc) parse_followed_channels,
+        page, NULL, (GDestroyNotify) gt_channel_data_list_free,
+        g_task_get_cancellable(task), followed_page_cb, page);
 }
 
+/* NOTE: Keeps up to FOLLOWED_WINDOW pages in flight, the rest of a
+ * list is only requested once its first page has said how long it is.
+ * Returns the followed channels once every page is in */
 static void
-fetch_all_followed_channels_async_cb(GTask* task, gpointer source,
-    gpointer task_data, GCancellable* cancel)
+fetch_followed_pages(GTask* task)
 {
-    g_assert(GT_IS_TWITCH(source));
-    g_assert(G_IS_TASK(task));
-    g_assert_nonnull(task_data);
+    FollowedChannelsData* data = g_task_get_task_data(task);
 
-    GenericTaskData* data = task_data;
-    GList* ret = NULL;
+    while (data->inflight < FOLLOWED_WINDOW)
+    {
+        if (data->next_stream < data->stream_total)
+            fetch_followed_page(task, TRUE, data->next_stream++);
+        else if (data->next_chan < data->chan_total)
+            fetch_followed_page(task, FALSE, data->next_chan++);
+        else
+            break;
+    }
+
+    if (data->inflight == 0)
+    {
+        g_task_return_pointer(task, merge_followed_channels(data),
+            (GDestroyNotify) gt_channel_list_free);
+    }
+}
+
+static void
+followed_page_cb(GObject* source,
+    GAsyncResult* res, gpointer udata)
+{
+    FollowedPage* page = udata;
+    g_autoptr(GTask) task = page->task;
+    FollowedChannelsData* data = g_task_get_task_data(task);
+    GPtrArray* pages = page->live ? data->stream_pages : data->chan_pages;
+    GList* list = NULL;
     GError* err = NULL;
 
-    if (g_task_return_error_if_cancelled(task))
-        return;
+    list = g_task_propagate_pointer(G_TASK(res), &err);
 
-    ret = gt_twitch_fetch_all_followed_channels(GT_TWITCH(source), data->str_1, data->str_2, &err);
+    data->inflight--;
+
+    if (data->failed)
+    {
+        g_clear_error(&err);
+        gt_channel_data_list_free(list);
+    }
+    else if (err)
+    {
+        data->failed = TRUE;
+
+        g_prefix_error(&err, "Unable to fetch all followed channels because: ");
 
-    if (err)
         g_task_return_error(task, err);
+    }
     else
-        g_task_return_pointer(task, ret, (GDestroyNotify) gt_channel_list_free);
+    {
+        if (page->index == 0)
+        {
+            gint total = MAX((page->total + FOLLOWED_LIMIT - 1) / FOLLOWED_LIMIT, 1);
+
+            if (page->live)
+                data->stream_total = total;
+            else
+                data->chan_total = total;
+
+            g_ptr_array_set_size(pages, total);
+        }
+
+        g_assert_cmpint(page->index, <, pages->len);
+
+        pages->pdata[page->index] = list;
+
+        fetch_followed_pages(task);
+    }
+
+    g_slice_free(FollowedPage, page);
 }
 
 void
@@ -2268,18 +2834,26 @@ gt_twitch_fetch_all_followed_channels_async(GtTwitch* self,
     g_assert_false(utils_str_empty(oauth_token));
 
     GTask* task = NULL;
-    GenericTaskData* data = NULL;
+    FollowedChannelsData* data = NULL;
 
     task = g_task_new(self, cancel, cb, udata);
     g_task_set_return_on_cancel(task, FALSE);
 
-    data = generic_task_data_new();
-    data->str_1 = g_strdup(id);
-    data->str_2 = g_strdup(oauth_token);
+    data = g_slice_new0(FollowedChannelsData);
+    data->id = g_strdup(id);
+    data->oauth_token = g_strdup(oauth_token);
+    data->stream_pages = g_ptr_array_new_with_free_func((GDestroyNotify) gt_channel_data_list_free);
+    data->chan_pages = g_ptr_array_new_with_free_func((GDestroyNotify) gt_channel_data_list_free);
+    /* NOTE: The first page of each list is fetched straight away */
+    data->stream_total = 1;
+    data->chan_total = 1;
 
-    g_task_set_task_data(task, data, (GDestroyNotify) generic_task_data_free);
+    g_task_set_task_data(task, data, (GDestroyNotify) followed_channels_data_free);
+
+    g_ptr_array_set_size(data->stream_pages, 1);
+    g_ptr_array_set_size(data->chan_pages, 1);
 
-    g_task_run_in_thread(task, fetch_all_followed_channels_async_cb);
+    fetch_followed_pages(task);
 
     g_object_unref(task);
 }
@@ -2456,43 +3030,78 @@ gt_twitch_unfollow_channel_finish(GtTwitch* self,
     g_task_propagate_pointer(G_TASK(result), error);
 }
 
-GList*
-gt_twitch_emoticons(GtTwitch* self,
-    const gchar* emotesets, GError** error)
+/* NOTE: Returns the sets in emotesets that haven't been fetched yet
+ * or NULL if they all have */
+static gchar*
+missing_emote_sets(GtTwitch* self, const gchar* emotesets)
 {
-    g_assert(GT_IS_TWITCH(self));
-    g_assert_false(utils_str_empty(emotesets));
+    GtTwitchPrivate* priv = gt_twitch_get_instance_private(self);
+    g_auto(GStrv) sets = g_strsplit(emotesets, ",", 0);
+    GString* missing = g_string_new(NULL);
 
-    g_autoptr(SoupMessage) msg = NULL;
-    g_autoptr(JsonReader) reader = NULL;
-    g_autofree gchar* uri = NULL;
-    g_auto(GStrv) sets = NULL;
+    g_mutex_lock(&priv->emote_set_mutex);
+
+    for (gchar** c = sets; *c != NULL; c++)
+    {
+        if (g_hash_table_contains(priv->emote_set_table, *c))
+            continue;
+
+        if (missing->len > 0)
+            g_string_append_c(missing, ',');
+
+        g_string_append(missing, *c);
+    }
+
+    g_mutex_unlock(&priv->emote_set_mutex);
+
+    return g_string_free(missing, missing->len == 0);
+}
+
+static GList*
+copy_emote_sets(GtTwitch* self, const gchar* emotesets)
+{
+    GtTwitchPrivate* priv = gt_twitch_get_instance_private(self);
+    g_auto(GStrv) sets = g_strsplit(emotesets, ",", 0);
     GList* ret = NULL;
-    GError* err = NULL;
 
-    uri = g_strdup_printf(EMOTICON_IMAGES_URI,
-        emotesets);
+    g_mutex_lock(&priv->emote_set_mutex);
+
+    for (gchar** c = sets; *c != NULL; c++)
+    {
+        GPtrArray* set_emotes = g_hash_table_lookup(priv->emote_set_table, *c);
+
+        if (!set_emotes)
+            continue;
 
-    msg = soup_message_new(SOUP_METHOD_GET, uri);
+        for (guint i = 0; i < set_emotes->len; i++)
+            ret = g_list_prepend(ret, chat_emote_copy(set_emotes->pdata[i]));
+    }
 
-    reader = new_send_message_json(self, msg, &err);
+    g_mutex_unlock(&priv->emote_set_mutex);
 
-    CHECK_AND_PROPAGATE_ERROR("Unable to get emoticons for emote sets '%s'",
-        emotesets);
+    return g_list_reverse(ret);
+}
 
-    sets = g_strsplit(emotesets, ",", 0);
+static GList*
+parse_emoticons(GtTwitch* self, JsonReader* reader,
+    GenericTaskData* data, GError** error)
+{
+    GtTwitchPrivate* priv = gt_twitch_get_instance_private(self);
+    g_auto(GStrv) missing_sets = g_strsplit(data->str_2, ",", 0);
 
     READ_JSON_MEMBER("emoticon_sets");
 
-    for (gchar** c = sets; *c != NULL; c++)
+    for (gchar** c = missing_sets; *c != NULL; c++)
     {
+        g_autoptr(GPtrArray) set_emotes = g_ptr_array_new_with_free_func((GDestroyNotify) gt_chat_emote_free);
+
         READ_JSON_MEMBER(*c);
 
         for (gint i = 0; i < json_reader_count_elements(reader); i++)
         {
             GtChatEmote* emote = gt_chat_emote_new();
 
-            ret = g_list_append(ret, emote);
+            g_ptr_array_add(set_emotes, emote);
 
             READ_JSON_ELEMENT(i);
             READ_JSON_VALUE("id", emote->id);
@@ -2500,43 +3109,27 @@ gt_twitch_emoticons(GtTwitch* self,
             END_JSON_ELEMENT();
 
             emote->set = atoi(*c);
-
-            emote->pixbuf = gt_twitch_download_emote(self, emote->id);
         }
 
         END_JSON_MEMBER();
+
+        g_mutex_lock(&priv->emote_set_mutex);
+        g_hash_table_insert(priv->emote_set_table, g_strdup(*c), g_steal_pointer(&set_emotes));
+        g_mutex_unlock(&priv->emote_set_mutex);
     }
 
     END_JSON_MEMBER();
 
-    return ret;
+    return copy_emote_sets(self, data->str_1);
 
 error:
-    gt_chat_emote_list_free(ret);
-
     return NULL;
 }
 
-static void
-emoticon_images_async_cb(GTask* task, gpointer source,
-    gpointer task_data, GCancellable* cancel)
-{
-    g_assert(GT_IS_TWITCH(source));
-    g_assert(G_IS_TASK(task));
-    g_assert_nonnull(task_data);
-
-    GenericTaskData* data = task_data;
-    GList* ret = NULL;
-    GError* err = NULL;
-
-    ret = gt_twitch_emoticons(GT_TWITCH(source), data->str_1, &err);
-
-    if (err)
-        g_task_return_error(task, err);
-    else
-        g_task_return_pointer(task, ret, (GDestroyNotify) gt_chat_emote_list_free);
-}
-
+/* NOTE: Only returns the metadata, the images are resolved with
+ * gt_twitch_resolve_emote when they are shown. Sets that have been
+ * fetched before are served from the emote set table so only new sets
+ * hit the API */
 void
 gt_twitch_emoticons_async(GtTwitch* self, const char* emotesets,
     GAsyncReadyCallback cb, GCancellable* cancel, gpointer udata)
@@ -2544,45 +3137,38 @@ gt_twitch_emoticons_async(GtTwitch* self, const char* emotesets,
     g_assert(GT_IS_TWITCH(self));
     g_assert_false(utils_str_empty(emotesets));
 
-    GTask* task = NULL;
+    g_autofree gchar* missing = missing_emote_sets(self, emotesets);
+    g_autofree gchar* uri = NULL;
     GenericTaskData* data = NULL;
 
-    task = g_task_new(self, cancel, cb, udata);
+    if (!missing)
+    {
+        g_autoptr(GTask) task = g_task_new(self, cancel, cb, udata);
+
+        g_task_return_pointer(task, copy_emote_sets(self, emotesets),
+            (GDestroyNotify) gt_chat_emote_list_free);
+
+        return;
+    }
 
     data = generic_task_data_new();
     data->str_1 = g_strdup(emotesets);
+    data->str_2 = g_strdup(missing);
 
-    g_task_set_task_data(task, data, (GDestroyNotify) generic_task_data_free);
-
-    g_task_run_in_thread(task, emoticon_images_async_cb);
+    uri = g_strdup_printf(EMOTICON_IMAGES_URI, missing);
 
-    g_object_unref(task);
+    get_json_async(self, uri, (ParseJsonFunc) parse_emoticons,
+        data, (GDestroyNotify) generic_task_data_free, (GDestroyNotify) gt_chat_emote_list_free,
+        cancel, cb, udata);
 }
 
-GtUserInfo*
-gt_twitch_fetch_user_info(GtTwitch* self,
-    const gchar* oauth_token, GError** error)
+static GtUserInfo*
+parse_user_info(GtTwitch* self, JsonReader* reader,
+    GenericTaskData* data, GError** error)
 {
-    g_assert(GT_IS_TWITCH(self));
-    g_assert_false(utils_str_empty(oauth_token));
-
-    g_autoptr(SoupMessage) msg = NULL;
-    g_autoptr(JsonReader) reader;
-    g_autofree gchar* uri = NULL;
-    GtUserInfo* ret = NULL;
-    GError* err = NULL;
-
-    uri = g_strdup_printf(USER_INFO_URI, oauth_token);
-
-    msg = soup_message_new(SOUP_METHOD_GET, uri);
-
-    reader = new_send_message_json(self, msg, &err);
+    GtUserInfo* ret = gt_user_info_new();
 
-    CHECK_AND_PROPAGATE_ERROR("Unable to fetch user info");
-
-    ret = gt_user_info_new();
-
-    ret->oauth_token = g_strdup(oauth_token);
+    ret->oauth_token = g_strdup(data->str_1);
 
     READ_JSON_VALUE("_id", ret->id);
     READ_JSON_VALUE("name", ret->name);
@@ -2604,30 +3190,13 @@ gt_twitch_fetch_user_info(GtTwitch* self,
     return ret;
 
 error:
+    g_prefix_error(error, "Unable to fetch user info because: ");
+
     gt_user_info_free(ret);
 
     return NULL;
 }
 
-static void
-fetch_user_info_async_cb(GTask* task, gpointer source,
-    gpointer task_data, GCancellable* cancel)
-{
-    g_assert(GT_IS_TWITCH(source));
-    g_assert(G_IS_TASK(task));
-    g_assert_nonnull(task_data);
-
-    GError* err = NULL;
-    GenericTaskData* data = task_data;
-
-    GtUserInfo* ret = gt_twitch_fetch_user_info(GT_TWITCH(source), data->str_1, &err);
-
-    if (err)
-        g_task_return_error(task, err);
-    else
-        g_task_return_pointer(task, ret, (GDestroyNotify) gt_user_info_free);
-}
-
 void
 gt_twitch_fetch_user_info_async(GtTwitch* self,
     const gchar* oauth_token, GAsyncReadyCallback cb,
@@ -2635,18 +3204,16 @@ gt_twitch_fetch_user_info_async(GtTwitch* self,
 {
     g_assert(GT_IS_TWITCH(self));
 
-    GTask* task = NULL;
+    g_autofree gchar* uri = NULL;
     GenericTaskData* data = generic_task_data_new();
 
-    task = g_task_new(self, cancel, cb, udata);
-
     data->str_1 = g_strdup(oauth_token);
 
-    g_task_set_task_data(task, data, (GDestroyNotify) generic_task_data_free);
-
-    g_task_run_in_thread(task, fetch_user_info_async_cb);
+    uri = g_strdup_printf(USER_INFO_URI, oauth_token);
 
-    g_object_unref(task);
+    get_json_async(self, uri, (ParseJsonFunc) parse_user_info,
+        data, (GDestroyNotify) generic_task_data_free, (GDestroyNotify) gt_user_info_free,
+        cancel, cb, udata);
 }
 
 GtUserInfo*
@@ -2661,32 +3228,14 @@ gt_twitch_fetch_user_info_finish(GtTwitch* self,
     return ret;
 }
 
-GtOAuthInfo*
-gt_twitch_fetch_oauth_info(GtTwitch* self,
-    const gchar* oauth_token, GError** error)
-
+static GtOAuthInfo*
+parse_oauth_info(GtTwitch* self, JsonReader* reader,
+    GenericTaskData* data, GError** error)
 {
-    g_assert(GT_IS_TWITCH(self));
-    g_assert_false(utils_str_empty(oauth_token));
-
-    g_autoptr(SoupMessage) msg = NULL;
-    g_autoptr(JsonReader) reader;
-    g_autofree gchar* uri = NULL;
-    GtOAuthInfo* ret = NULL;
-    GError* err = NULL;
+    GtOAuthInfo* ret = gt_oauth_info_new();
     gint num_scopes;
 
-    uri = g_strdup_printf(OAUTH_INFO_URI, oauth_token);
-
-    msg = soup_message_new(SOUP_METHOD_GET, uri);
-
-    reader = new_send_message_json(self, msg, &err);
-
-    CHECK_AND_PROPAGATE_ERROR("Unable to fetch oauth info");
-
-    ret = gt_oauth_info_new();
-
-    ret->oauth_token = g_strdup(oauth_token);
+    ret->oauth_token = g_strdup(data->str_1);
 
     READ_JSON_MEMBER("token");
     READ_JSON_VALUE("user_id", ret->user_id);
@@ -2711,30 +3260,13 @@ gt_twitch_fetch_oauth_info(GtTwitch* self,
     return ret;
 
 error:
+    g_prefix_error(error, "Unable to fetch oauth info because: ");
+
     gt_oauth_info_free(ret);
 
     return NULL;
 }
 
-static void
-fetch_oauth_info_async_cb(GTask* task, gpointer source,
-    gpointer task_data, GCancellable* cancel)
-{
-    g_assert(GT_IS_TWITCH(source));
-    g_assert(G_IS_TASK(task));
-    g_assert_nonnull(task_data);
-
-    GError* err = NULL;
-    GenericTaskData* data = task_data;
-
-    GtOAuthInfo* ret = gt_twitch_fetch_oauth_info(GT_TWITCH(source), data->str_1, &err);
-
-    if (err)
-        g_task_return_error(task, err);
-    else
-        g_task_return_pointer(task, ret, (GDestroyNotify) gt_oauth_info_free);
-}
-
 void
 gt_twitch_fetch_oauth_info_async(GtTwitch* self,
     const gchar* oauth_token, GAsyncReadyCallback cb,
@@ -2742,18 +3274,16 @@ gt_twitch_fetch_oauth_info_async(GtTwitch* self,
 {
     g_assert(GT_IS_TWITCH(self));
 
-    GTask* task = NULL;
+    g_autofree gchar* uri = NULL;
     GenericTaskData* data = generic_task_data_new();
 
-    task = g_task_new(self, cancel, cb, udata);
-
     data->str_1 = g_strdup(oauth_token);
 
-    g_task_set_task_data(task, data, (GDestroyNotify) generic_task_data_free);
-
-    g_task_run_in_thread(task, fetch_oauth_info_async_cb);
+    uri = g_strdup_printf(OAUTH_INFO_URI, oauth_token);
 
-    g_object_unref(task);
+    get_json_async(self, uri, (ParseJsonFunc) parse_oauth_info,
+        data, (GDestroyNotify) generic_task_data_free, (GDestroyNotify) gt_oauth_info_free,
+        cancel, cb, udata);
 }
 
 GtOAuthInfo*
@@ -2781,7 +3311,14 @@ gt_chat_badge_free(GtChatBadge* badge)
 
     g_free(badge->name);
     g_free(badge->version);
-    g_object_unref(badge->pixbuf);
+    g_free(badge->key);
+
+    for (gint i = 0; i < GT_CHAT_IMAGE_MAX_SCALE; i++)
+    {
+        g_free(badge->uri[i]);
+        g_clear_object(&badge->pixbuf[i]);
+    }
+
     g_slice_free(GtChatBadge, badge);
 }
 
@@ -78,11 +78,19 @@ typedef struct _GtTwitchStreamData
 } GtTwitchStreamData;
 
 
+#define GT_CHAT_IMAGE_MAX_SCALE 3
+
+/* NOTE: Images are indexed by scale - 1. Fetched images are kept in
+ * GtTwitch's image cache and handed out by gt_twitch_resolve_badge,
+ * pixbuf is only set for badges that aren't fetched */
 typedef struct
 {
     gchar* name;
     gchar* version;
-    GdkPixbuf* pixbuf;
+    gchar* key;
+    gchar* uri[GT_CHAT_IMAGE_MAX_SCALE];
+    GdkPixbuf* pixbuf[GT_CHAT_IMAGE_MAX_SCALE];
+    gboolean pending[GT_CHAT_IMAGE_MAX_SCALE];
 } GtChatBadge;
 
 typedef struct
@@ -122,33 +130,27 @@ const GtTwitchStreamData*  gt_twitch_stream_list_filter_quality(GList* list, con
 GList*                     gt_twitch_all_streams(GtTwitch* self, const gchar* channel, GError** error);
 void                       gt_twitch_all_streams_async(GtTwitch* self, const gchar* channel, GCancellable* cancel, GAsyncReadyCallback cb, gpointer udata);
 GList*                     gt_twitch_all_streams_finish(GtTwitch* self, GAsyncResult* result, GError** error);
-GList*                     gt_twitch_top_channels(GtTwitch* self, gint n, gint offset, const gchar* game, const gchar* language, GError** error);
 void                       gt_twitch_top_channels_async(GtTwitch* self, gint n, gint offset, const gchar* game, const gchar* language, GCancellable* cancel, GAsyncReadyCallback cb, gpointer udata);
-GList*                     gt_twitch_top_games(GtTwitch* self, gint n, gint offset, GError** error);
 void                       gt_twitch_top_games_async(GtTwitch* self, gint n, gint offset, GCancellable* cancel, GAsyncReadyCallback cb, gpointer udata);
 GList*                     gt_twitch_top_games_finish(GtTwitch* self, GAsyncResult* result, GError** error);
-GList*                     gt_twitch_search_channels(GtTwitch* self, const gchar* query, gint n, gint offset, gboolean offline, GError** error);
 void                       gt_twitch_search_channels_async(GtTwitch* self, const gchar* query, gint n, gint offset, gboolean offline, GCancellable* cancel, GAsyncReadyCallback cb, gpointer udata);
 GList*                     gt_twitch_search_channels_finish(GtTwitch* self, GAsyncResult* result, GError** error);
-GList*                     gt_twitch_search_games(GtTwitch* self, const gchar* query, gint n, gint offset, GError** error);
 void                       gt_twitch_search_games_async(GtTwitch* self, const gchar* query, gint n, gint offset, GCancellable* cancel, GAsyncReadyCallback cb, gpointer udata);
 GList*                     gt_twitch_search_games_finish(GtTwitch* self, GAsyncResult* result, GError** error);
 void                       gt_twitch_stream_data_free(GtTwitchStreamData* data);
 void                       gt_twitch_stream_data_list_free(GList* list);
-GtChannelData*             gt_twitch_fetch_channel_data(GtTwitch* self, const gchar* id, GError** error);
-GtChannel*                 gt_twitch_fetch_channel(GtTwitch* self, const gchar* id, GError** error);
 void                       gt_twitch_fetch_channel_async(GtTwitch* self, const gchar* id, GAsyncReadyCallback cb, GCancellable* cancel, gpointer udata);
 GtChannel*                 gt_twitch_fetch_channel_finish(GtTwitch* self, GAsyncResult* result, GError** error);
 void                       gt_twitch_channel_raw_data_async(GtTwitch* self, const gchar* name, GCancellable* cancel, GAsyncReadyCallback cb, gpointer udata);
 GtGameData*                gt_twitch_game_raw_data(GtTwitch* self, const gchar* name);
 GdkPixbuf*                 gt_twitch_download_picture(GtTwitch* self, const gchar* url, gint64 timestamp, GError** error);
 void                       gt_twitch_download_picture_async(GtTwitch* self, const gchar* url, gint64 timestamp, GCancellable* cancel, GAsyncReadyCallback cb, gpointer udata);
-GdkPixbuf*                 gt_twitch_download_emote(GtTwitch* self, gint id);
+GdkPixbuf*                 gt_twitch_resolve_emote(GtTwitch* self, gint id, gint scale);
+GdkPixbuf*                 gt_twitch_resolve_badge(GtTwitch* self, GtChatBadge* badge, gint scale);
 GList*                     gt_twitch_channel_info(GtTwitch* self, const gchar* chan);
 void                       gt_twitch_channel_info_panel_free(GtTwitchChannelInfoPanel* panel);
 void                       gt_twitch_channel_info_async(GtTwitch* self, const gchar* chan, GCancellable* cancel, GAsyncReadyCallback cb, gpointer udata);
 GList*                     gt_twitch_chat_servers(GtTwitch* self, const gchar* chan, GError** error);
-GList*                     gt_twitch_fetch_all_followed_channels(GtTwitch* self, const gchar* id, const gchar* oauth_token, GError** error);
 void                       gt_twitch_fetch_all_followed_channels_async(GtTwitch* self, const gchar* id, const gchar* oauth_token, GCancellable* cancel, GAsyncReadyCallback cb, gpointer udata);
 GList*                     gt_twitch_fetch_all_followed_channels_finish(GtTwitch* self, GAsyncResult* result, GError** error);
 void                       gt_twitch_follow_channel(GtTwitch* self, const gchar* chan_name, GError** error);
@@ -157,8 +159,8 @@ void                       gt_twitch_follow_channel_finish(GtTwitch* self, GAsyn
 void                       gt_twitch_unfollow_channel(GtTwitch* self, const gchar* chan_name, GError** error);
 void                       gt_twitch_unfollow_channel_async(GtTwitch* self, const gchar* chan_name, GAsyncReadyCallback cb, gpointer udata);
 void                       gt_twitch_unfollow_channel_finish(GtTwitch* self, GAsyncResult* result, GError** error);
-GList*                     gt_twitch_emoticons(GtTwitch* self, const gchar* emotesets, GError** error);
 void                       gt_twitch_emoticons_async(GtTwitch* self, const char* emotesets, GAsyncReadyCallback cb, GCancellable* cancel, gpointer udata);
+GtChatBadge*               gt_twitch_lookup_chat_badge(GtTwitch* self, const gchar* chan_id, const gchar* badge_name, const gchar* version);
 GtChatBadge*               gt_twitch_fetch_chat_badge(GtTwitch* self, const gchar* chan_id, const gchar* badge_name, const gchar* version, GError** err);
 void                       gt_twitch_fetch_chat_badge_async(GtTwitch* self, const gchar* chan_id, const gchar* badge_name, const gchar* version, GCancellable* cancel, GAsyncReadyCallback cb, gpointer udata);
 GtChatBadge*               gt_twitch_fetch_chat_badge_finish(GtTwitch* self, GAsyncResult* result, GError** err);
@@ -169,10 +171,8 @@ void                       gt_chat_badge_list_free(GList* list);
 GtChatEmote*               gt_chat_emote_new();
 void                       gt_chat_emote_free(GtChatEmote* emote);
 void                       gt_chat_emote_list_free(GList* list);
-GtUserInfo*                gt_twitch_fetch_user_info(GtTwitch* self, const gchar* oauth_token, GError** error);
 void                       gt_twitch_fetch_user_info_async(GtTwitch* self, const gchar* oauth_token, GAsyncReadyCallback cb, GCancellable* cancel, gpointer udata);
 GtUserInfo*                gt_twitch_fetch_user_info_finish(GtTwitch* self, GAsyncResult* result, GError** error);
-GtOAuthInfo*               gt_twitch_fetch_oauth_info(GtTwitch* self, const gchar* oauth_token, GError** error);
 void                       gt_twitch_fetch_oauth_info_async(GtTwitch* self, const gchar* oauth_token, GAsyncReadyCallback cb, GCancellable* cancel, gpointer udata);
 GtOAuthInfo*               gt_twitch_fetch_oauth_info_finish(GtTwitch* self, GAsyncResult* result, GError** error);
 